@@ -0,0 +1,31 @@
+# Turns a SPIR-V binary into a header with a constexpr uint32_t array so the
+# shader can be handed to vkCreateShaderModule straight from .rodata.
+#
+# cmake -DSPIRV_FILE=<in.spv> -DOUTPUT_HEADER=<out.h> -DSYMBOL=<name> -P embed_spirv.cmake
+
+file(READ ${SPIRV_FILE} SPIRV_HEX HEX)
+string(LENGTH "${SPIRV_HEX}" SPIRV_HEX_LENGTH)
+math(EXPR SPIRV_REMAINDER "${SPIRV_HEX_LENGTH} % 8")
+if(NOT SPIRV_REMAINDER EQUAL 0)
+    message(FATAL_ERROR "${SPIRV_FILE} is not a whole number of 32-bit words")
+endif()
+
+# SPIR-V words are little-endian on disk
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u," SPIRV_WORDS "${SPIRV_HEX}")
+# Eight words per line (CMake regexes have no {n} repetition)
+string(REPEAT "0x[0-9a-f]+u," 8 SPIRV_LINE_PATTERN)
+string(REGEX REPLACE "(${SPIRV_LINE_PATTERN})" "\\1\n    " SPIRV_WORDS "${SPIRV_WORDS}")
+
+file(WRITE ${OUTPUT_HEADER}.tmp
+"// Generated from ${SPIRV_FILE}, do not edit
+#pragma once
+#include <cstdint>
+
+inline constexpr uint32_t ${SYMBOL}[] = {
+    ${SPIRV_WORDS}
+};
+")
+
+# Only touch the header when the contents change, to avoid needless rebuilds
+configure_file(${OUTPUT_HEADER}.tmp ${OUTPUT_HEADER} COPYONLY)
+file(REMOVE ${OUTPUT_HEADER}.tmp)
@@ -1,37 +1,133 @@
 #include "stdafx.h"
 #include "app.hpp"
 
-App::App()
-    : m_Window(1024, 1024, "Vulkan Renderer"),
-      m_Renderer(m_Window)
+#include <algorithm>
+
+App::App(const AppConfig& config)
+    : m_Config(config), m_FrameLimiter(config.fpsLimit)
 {
+    Profiler::Get().SetEnabled(m_Config.profile || !m_Config.tracePath.empty());
+    if (!m_Config.tracePath.empty()) {
+        m_TraceWriter = std::make_unique<TraceWriter>(m_Config.tracePath);
+    }
+
+    if (m_Config.headless) {
+        m_Renderer = std::make_unique<Renderer>(m_Config.width, m_Config.height, m_Config.renderer);
+    } else {
+        m_Window = std::make_unique<Window>(m_Config.width, m_Config.height, "Vulkan Renderer");
+        m_Renderer = std::make_unique<Renderer>(*m_Window, m_Config.renderer);
+    }
+    m_Renderer->GetContext().GetPipelineCache().PrintStats(std::cout);
+    if (m_Window) {
+        std::cout << "Present mode: " << SwapChain::GetPresentModeName(m_Renderer->GetPresentMode())
+                  << ", " << m_Renderer->GetImageCount() << " images"
+                  << (m_Renderer->IsLowLatency() ? ", low latency" : "") << std::endl;
+    }
+
     m_Camera.type = Camera::CameraType::lookat;
     m_Camera.setPosition(glm::vec3(0.0f, 0.0f, -2.5f));
     m_Camera.setRotation(glm::vec3(0.0f));
-    m_Camera.setPerspective(60.0f, (float)m_Window.GetWidth() / (float)m_Window.GetHeight(), 1.0f, 256.0f);
+    m_Camera.setPerspective(60.0f, (float)m_Config.width / (float)m_Config.height, 1.0f, 256.0f);
 }
 
 App::~App() {
     // Cleanup happens in destructors
 }
 
+bool App::ShouldClose() const {
+    if (m_Config.frameCount != 0 && frameCounter >= m_Config.frameCount) {
+        return true;
+    }
+    return m_Window && m_Window->ShouldClose();
+}
+
 int App::Run() {
-    while (!m_Window.ShouldClose()) {
-        m_Window.PollEvents();
+    lastTimestamp = std::chrono::high_resolution_clock::now();
+    tPrevEnd = lastTimestamp;
+
+    while (!ShouldClose()) {
+        Profiler::Get().BeginFrame();
+        JB_PROFILE_ZONE("Frame");
+
+        // Sleep first, so that input is polled right before it is rendered
+        m_FrameLimiter.Wait();
+        m_Renderer->PaceFrame();
+
+        if (m_Window) {
+            JB_PROFILE_ZONE("PollEvents");
+            m_Window->PollEvents();
+        }
+        // Latency is only reported with --profile; unstamped frames cost
+        // nothing to track
+        if (m_Config.profile) {
+            m_Renderer->MarkInput();
+        }
+        {
+            // GLFW and other main-thread-only work queued by jobs
+            JB_PROFILE_ZONE("MainThreadJobs");
+            m_Renderer->GetJobs().RunMainThreadJobs();
+        }
         
         try {
             auto tStart = std::chrono::high_resolution_clock::now();
-            m_Renderer.DrawFrame();
+            {
+                JB_PROFILE_ZONE("DrawFrame");
+                m_Renderer->UpdateCamera(m_Camera);
+                m_Renderer->DrawFrame();
+            }
             auto tEnd = std::chrono::high_resolution_clock::now();
             auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
             frameTimer = (float)tDiff / 1000.0f;
             m_Camera.update(frameTimer);
+            frameCounter++;
+
+            if (m_Config.profile) {
+                UpdateProfileReport();
+            }
         } catch (const std::exception& e) {
-            // Log error
+            std::cerr << "Frame failed: " << e.what() << std::endl;
             return -1;
         }
     }
     
-    m_Renderer.WaitIdle();
+    m_Renderer->WaitIdle();
+    m_Renderer->GetStaging().PrintStats(std::cout);
+    m_Renderer->GetUploads().PrintStats(std::cout);
+    m_Renderer->GetTextures().PrintStats(std::cout);
+
+    if (m_Config.headless) {
+        auto elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - lastTimestamp).count();
+        std::cout << "Rendered " << frameCounter << " frames in " << elapsed << " s ("
+                  << (elapsed > 0.0 ? frameCounter / elapsed : 0.0) << " fps)" << std::endl;
+    }
     return 0;
 }
+
+void App::UpdateProfileReport() {
+    // GPU results arrive a few frames late, so this only ever reads what is ready
+    m_ProfileEvents.clear();
+    Profiler::Get().Drain(m_ProfileEvents);
+    m_ProfileStats.Add(m_ProfileEvents);
+    m_Renderer->DrainLatencySamples(m_LatencySamples);
+    m_ProfileFrames++;
+
+    auto now = std::chrono::high_resolution_clock::now();
+    if (std::chrono::duration<double>(now - tPrevEnd).count() >= 1.0) {
+        m_ProfileStats.Print(std::cout, m_ProfileFrames);
+        if (!m_LatencySamples.empty()) {
+            double total = 0.0;
+            double worst = 0.0;
+            for (double sample : m_LatencySamples) {
+                total += sample;
+                worst = std::max(worst, sample);
+            }
+            std::cout << "Input latency (to " << (m_Renderer->IsLatencyToPresent() ? "present" : "GPU done") << "): "
+                      << total / static_cast<double>(m_LatencySamples.size()) << " ms avg, "
+                      << worst << " ms max" << std::endl;
+        }
+        m_ProfileStats.Reset();
+        m_LatencySamples.clear();
+        m_ProfileFrames = 0;
+        tPrevEnd = now;
+    }
+}
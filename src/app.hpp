@@ -3,10 +3,31 @@
 #include "core/window.hpp"
 #include "renderer/renderer.hpp"
 #include "scene/camera.hpp"
+#include "core/profiler.hpp"
+#include "core/trace_writer.hpp"
+#include "core/frame_limiter.hpp"
+
+struct AppConfig {
+    uint32_t width = 1024;
+    uint32_t height = 1024;
+
+    // Render offscreen without creating a window or swapchain
+    bool headless = false;
+    // Number of frames to render before exiting, 0 runs until the window closes
+    uint32_t frameCount = 0;
+    // Print CPU/GPU zone timings once per second
+    bool profile = false;
+    // Stream profiler events to this Chrome trace JSON file if non-empty
+    std::string tracePath;
+    // Cap the frame rate, 0 for no limit
+    double fpsLimit = 0.0;
+
+    RendererConfig renderer;
+};
 
 class App {
 public:
-    App();
+    App(const AppConfig& config = AppConfig{});
     ~App();
 
     int Run();
@@ -21,7 +42,18 @@ protected:
     std::chrono::time_point<std::chrono::high_resolution_clock> lastTimestamp, tPrevEnd;
 
 private:
-    Window m_Window;
-    Renderer m_Renderer;
+    AppConfig m_Config;
+    std::unique_ptr<TraceWriter> m_TraceWriter;
+    std::unique_ptr<Window> m_Window;   // Null when headless
+    std::unique_ptr<Renderer> m_Renderer;
     Camera m_Camera;
-};
\ No newline at end of file
+    FrameLimiter m_FrameLimiter;
+
+    std::vector<ProfileEvent> m_ProfileEvents;
+    ProfileStats m_ProfileStats;
+    uint32_t m_ProfileFrames = 0;
+    std::vector<double> m_LatencySamples;
+
+    bool ShouldClose() const;
+    void UpdateProfileReport();
+};
@@ -0,0 +1,700 @@
+#include "stdafx.h"
+#include "renderer/renderer.hpp"
+#include "renderer/memory_allocator.hpp"
+#include "renderer/deletion_queue.hpp"
+#include "scene/camera.hpp"
+#include "core/profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Scripted scene. Update is called once per frame before DrawFrame and
+// submits the frame's draws; finish, if set, after the last frame with the
+// device idle.
+struct BenchScene {
+    const char* name;
+    const char* description;
+    void (*update)(Renderer& renderer, Camera& camera, uint32_t frame);
+    void (*finish)(Renderer& renderer) = nullptr;
+};
+
+// side x side triangles on the z = 0 plane, filling roughly [-1, 1]
+static void SubmitGrid(Renderer& renderer, uint32_t side)
+{
+    float spacing = 2.0f / static_cast<float>(side);
+    glm::mat4 scale = glm::scale(glm::mat4(1.0f), glm::vec3(spacing));
+    for (uint32_t y = 0; y < side; y++) {
+        for (uint32_t x = 0; x < side; x++) {
+            glm::vec3 position(-1.0f + (x + 0.5f) * spacing, -1.0f + (y + 0.5f) * spacing, 0.0f);
+            renderer.SubmitDraw(renderer.GetDefaultMesh(), glm::translate(glm::mat4(1.0f), position) * scale);
+        }
+    }
+}
+
+// count fixed pseudo-random spots in a 200-unit cube around the origin, so
+// most triangles placed there fall outside the camera frustum
+template <typename Fn>
+static void Scatter(uint32_t count, Fn&& place)
+{
+    uint32_t state = 0x12345678u;
+    auto next = [&]() {
+        state = state * 1664525u + 1013904223u;
+        return static_cast<float>(state >> 8) / static_cast<float>(1u << 24) * 200.0f - 100.0f;
+    };
+    for (uint32_t i = 0; i < count; i++) {
+        glm::vec3 position(next(), next(), next());
+        place(glm::translate(glm::mat4(1.0f), position));
+    }
+}
+
+static void SubmitScatter(Renderer& renderer, uint32_t count)
+{
+    Scatter(count, [&](const glm::mat4& model) { renderer.SubmitDraw(renderer.GetDefaultMesh(), model); });
+}
+
+// Same layout as SubmitScatter, added once to the GPU scene
+static void AddScatter(Renderer& renderer, uint32_t count)
+{
+    GpuScene* gpuScene = renderer.GetGpuScene();
+    if (!gpuScene) {
+        throw std::runtime_error("GPU-driven rendering is not supported by this device or build");
+    }
+    Scatter(count, [&](const glm::mat4& model) { gpuScene->AddObject(renderer.GetDefaultMesh(), model); });
+}
+
+// Every STREAM_INTERVAL frames a burst of new 1 MiB vertex buffers is queued
+// on the upload service, which spreads it over the following frames. Buffers
+// are released once their upload has landed.
+static constexpr uint32_t STREAM_INTERVAL = 64;
+static constexpr uint32_t STREAM_BURST_MB = 64;
+
+struct StreamedBuffer {
+    AllocatedBuffer buffer;
+    UploadService::Ticket ticket;
+};
+static std::vector<StreamedBuffer> s_Streamed;
+
+static void UpdateStream(Renderer& renderer, uint32_t frame)
+{
+    auto& uploads = renderer.GetUploads();
+    auto& allocator = renderer.GetContext().GetAllocator();
+
+    // This frame acquires whatever completed, so the buffers are destroyed
+    // once it is done with them
+    for (size_t i = 0; i < s_Streamed.size();) {
+        if (!uploads.IsComplete(s_Streamed[i].ticket)) {
+            i++;
+            continue;
+        }
+        AllocatedBuffer buffer = s_Streamed[i].buffer;
+        renderer.GetContext().GetDeletionQueue().Push([&allocator, buffer]() mutable { allocator.DestroyBuffer(buffer); });
+        s_Streamed[i] = s_Streamed.back();
+        s_Streamed.pop_back();
+    }
+
+    if (frame % STREAM_INTERVAL != 0) {
+        return;
+    }
+
+    // Same contents for every buffer, so generating it stays out of the numbers
+    static const auto data = std::make_shared<const std::vector<uint8_t>>(1u << 20, uint8_t{0x5a});
+    for (uint32_t i = 0; i < STREAM_BURST_MB; i++) {
+        AllocatedBuffer buffer = allocator.CreateBuffer(data->size(),
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        s_Streamed.push_back({buffer, uploads.Upload(buffer.buffer, 0, data)});
+    }
+}
+
+static void FinishStream(Renderer& renderer)
+{
+    renderer.GetUploads().WaitIdle();
+    for (auto& streamed : s_Streamed) {
+        renderer.GetContext().GetAllocator().DestroyBuffer(streamed.buffer);
+    }
+    s_Streamed.clear();
+}
+
+// TEXTURE_COUNT RGBA8 textures with full mip chains, spaced along the z
+// axis while the camera flies up and down it. They do not fit in
+// TEXTURE_BUDGET_MB, so levels stream in ahead of the camera and are
+// evicted behind it.
+static constexpr uint32_t TEXTURE_COUNT = 96;
+static constexpr uint32_t TEXTURE_SIZE = 512;
+static constexpr uint32_t TEXTURE_BUDGET_MB = 32;
+static constexpr float TEXTURE_SPACING = 2.0f;
+static constexpr uint32_t TEXTURE_PATH_FRAMES = 400;
+
+static std::vector<TextureStreamer::TextureId> s_Textures;
+static std::filesystem::path s_TextureDir;       // Removed once the renderer is gone
+
+// Minimal uncompressed KTX2 file with a basic data format descriptor
+static void WriteKtx2(const std::string& path, uint32_t size, uint8_t seed)
+{
+    uint32_t levelCount = 1;
+    while ((size >> levelCount) > 0) {
+        levelCount++;
+    }
+
+    // Basic descriptor block: four 8-bit samples, R G B A
+    std::vector<uint32_t> dfd = {
+        92,                             // dfdTotalSize
+        0,                              // vendorId, descriptorType
+        2u | (88u << 16),               // versionNumber, descriptorBlockSize
+        1u | (1u << 8) | (1u << 16),    // RGBSDA, BT.709, linear
+        0,                              // texelBlockDimension
+        4, 0,                           // bytesPlane0-7
+    };
+    const uint32_t channels[] = {0, 1, 2, 15};
+    for (uint32_t i = 0; i < 4; i++) {
+        dfd.insert(dfd.end(), {i * 8 | (7u << 16) | (channels[i] << 24), 0, 0, 255});
+    }
+
+    uint64_t dfdOffset = 80 + levelCount * 24;
+    uint64_t dataOffset = dfdOffset + dfd.size() * sizeof(uint32_t);
+    // Level data is stored smallest first
+    std::vector<uint64_t> index(levelCount * 3);
+    for (uint32_t i = levelCount; i-- > 0;) {
+        uint64_t bytes = uint64_t(std::max(size >> i, 1u)) * std::max(size >> i, 1u) * 4;
+        index[i * 3] = dataOffset;
+        index[i * 3 + 1] = bytes;
+        index[i * 3 + 2] = bytes;
+        dataOffset += bytes;
+    }
+
+    const uint8_t identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    uint32_t header[13] = {VK_FORMAT_R8G8B8A8_UNORM, 1, size, size, 0, 0, 1, levelCount, 0,
+                           static_cast<uint32_t>(dfdOffset), static_cast<uint32_t>(dfd.size() * sizeof(uint32_t)), 0, 0};
+    uint64_t sgd[2] = {0, 0};
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(identifier), sizeof(identifier));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(sgd), sizeof(sgd));
+    file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(uint64_t));
+    file.write(reinterpret_cast<const char*>(dfd.data()), dfd.size() * sizeof(uint32_t));
+    for (uint32_t i = levelCount; i-- > 0;) {
+        std::vector<uint8_t> level(index[i * 3 + 1], static_cast<uint8_t>(seed + i * 16));
+        file.write(reinterpret_cast<const char*>(level.data()), level.size());
+    }
+    if (!file) {
+        throw std::runtime_error("Failed to write texture: " + path);
+    }
+}
+
+static glm::vec3 GetTexturePosition(uint32_t index)
+{
+    return glm::vec3(index % 2 == 0 ? -2.0f : 2.0f, 0.0f, static_cast<float>(index) * TEXTURE_SPACING);
+}
+
+static void UpdateTextures(Renderer& renderer, Camera& camera, uint32_t frame)
+{
+    auto& textures = renderer.GetTextures();
+    if (frame == 0) {
+        // Written once per run, during warmup
+        s_TextureDir = std::filesystem::temp_directory_path() / "jb_textures";
+        std::filesystem::create_directories(s_TextureDir);
+        textures.SetBudget(VkDeviceSize(TEXTURE_BUDGET_MB) << 20);
+        for (uint32_t i = 0; i < TEXTURE_COUNT; i++) {
+            std::string path = (s_TextureDir / ("texture" + std::to_string(i) + ".ktx2")).string();
+            WriteKtx2(path, TEXTURE_SIZE, static_cast<uint8_t>(i));
+            s_Textures.push_back(textures.Load(path));
+        }
+    }
+
+    // Eye from one end of the row to the other and back
+    float length = (TEXTURE_COUNT - 1) * TEXTURE_SPACING;
+    float phase = static_cast<float>(frame % TEXTURE_PATH_FRAMES) / TEXTURE_PATH_FRAMES * 2.0f * glm::pi<float>();
+    camera.setPosition(glm::vec3(0.0f, 0.0f, -0.5f * length * (1.0f - std::cos(phase))));
+    textures.SetView(camera, renderer.GetExtent().height);
+
+    for (uint32_t i = 0; i < TEXTURE_COUNT; i++) {
+        glm::vec3 position = GetTexturePosition(i);
+        textures.Touch(s_Textures[i], position, 1.0f);
+        renderer.SubmitDraw(renderer.GetDefaultMesh(), glm::translate(glm::mat4(1.0f), position), glm::vec4(1.0f),
+                            glm::vec4(0.0f), textures.GetHandle(s_Textures[i]));
+    }
+}
+
+static void FinishTextures(Renderer& renderer)
+{
+    for (auto id : s_Textures) {
+        renderer.GetTextures().Release(id);
+    }
+    s_Textures.clear();
+}
+
+static const BenchScene s_Scenes[] = {
+    { "triangle", "Single triangle, static camera",
+      [](Renderer&, Camera&, uint32_t) {} },
+    { "orbit", "Single triangle, camera orbiting the origin",
+      [](Renderer&, Camera& camera, uint32_t frame) { camera.setRotation(glm::vec3(0.0f, static_cast<float>(frame % 360), 0.0f)); } },
+    { "grid10k", "10,000 triangles, one draw each, static camera",
+      [](Renderer& renderer, Camera&, uint32_t) { SubmitGrid(renderer, 100); } },
+    { "cull100k", "100,000 triangles scattered around the camera, most of them frustum culled",
+      [](Renderer& renderer, Camera& camera, uint32_t frame) {
+          camera.setRotation(glm::vec3(0.0f, static_cast<float>(frame % 360), 0.0f));
+          SubmitScatter(renderer, 100000);
+      } },
+    { "gpu100k", "cull100k as persistent GPU scene objects, culled by a compute pass and drawn indirect",
+      [](Renderer& renderer, Camera& camera, uint32_t frame) {
+          camera.setRotation(glm::vec3(0.0f, static_cast<float>(frame % 360), 0.0f));
+          if (frame == 0) {
+              AddScatter(renderer, 100000);
+          }
+      } },
+    { "stream", "Single triangle while 64 MiB bursts of new buffers stream in on the transfer queue",
+      [](Renderer& renderer, Camera&, uint32_t frame) { UpdateStream(renderer, frame); },
+      FinishStream },
+    { "textures", "96 512x512 KTX2 textures streaming mips under a 32 MiB budget as the camera flies past",
+      UpdateTextures, FinishTextures },
+};
+
+struct BenchConfig {
+    std::string scene = "triangle";
+    uint32_t width = 1280;
+    uint32_t height = 720;
+    uint32_t warmupFrames = 100;
+    uint32_t measuredFrames = 1000;
+    std::string outPath;
+    std::string baselinePath;
+    double tolerance = 0.10;
+    // Validation is opt-in (--validation): it would be part of every timing
+    RendererConfig renderer{.validation = false};
+};
+
+struct Percentiles {
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double mean = 0.0;
+    size_t count = 0;
+};
+
+static Percentiles ComputePercentiles(std::vector<double> samples)
+{
+    Percentiles result;
+    if (samples.empty()) {
+        return result;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto rank = [&](double p) {
+        size_t index = static_cast<size_t>(p * static_cast<double>(samples.size() - 1) + 0.5);
+        return samples[std::min(index, samples.size() - 1)];
+    };
+
+    result.p50 = rank(0.50);
+    result.p95 = rank(0.95);
+    result.p99 = rank(0.99);
+    double total = 0.0;
+    for (double s : samples) {
+        total += s;
+    }
+    result.mean = total / static_cast<double>(samples.size());
+    result.count = samples.size();
+    return result;
+}
+
+static double GetPeakMemoryMB()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<double>(counters.PeakWorkingSetSize) / (1024.0 * 1024.0);
+    }
+    return 0.0;
+#else
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<double>(usage.ru_maxrss) / (1024.0 * 1024.0);   // bytes
+#else
+    return static_cast<double>(usage.ru_maxrss) / 1024.0;              // kilobytes
+#endif
+#endif
+}
+
+static void WritePercentiles(std::ostream& os, const char* key, const Percentiles& p)
+{
+    os << "  \"" << key << "\": {\"p50\": " << p.p50 << ", \"p95\": " << p.p95
+       << ", \"p99\": " << p.p99 << ", \"mean\": " << p.mean << ", \"samples\": " << p.count << "}";
+}
+
+// Finds "section": { ... "key": <number> in a report written by this tool
+static bool FindNumber(const std::string& json, const std::string& section, const std::string& key, double& out)
+{
+    size_t pos = json.find("\"" + section + "\"");
+    if (pos == std::string::npos) {
+        return false;
+    }
+    size_t end = json.find('}', pos);
+    pos = json.find("\"" + key + "\"", pos);
+    if (pos == std::string::npos || pos > end) {
+        return false;
+    }
+    pos = json.find(':', pos);
+    out = std::strtod(json.c_str() + pos + 1, nullptr);
+    return true;
+}
+
+static bool CompareBaseline(const std::string& report, const BenchConfig& config)
+{
+    std::ifstream file(config.baselinePath);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open baseline: " + config.baselinePath);
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string baseline = buffer.str();
+
+    bool passed = true;
+    for (const char* section : { "cpu_ms", "gpu_ms" }) {
+        for (const char* key : { "p50", "p95" }) {
+            double base = 0.0;
+            double current = 0.0;
+            if (!FindNumber(baseline, section, key, base) || !FindNumber(report, section, key, current) || base <= 0.0) {
+                continue;
+            }
+
+            double delta = (current - base) / base;
+            bool regressed = delta > config.tolerance;
+            std::cerr << (regressed ? "REGRESSION " : "ok         ") << section << "." << key << ": "
+                      << base << " -> " << current << " (" << (delta >= 0.0 ? "+" : "") << delta * 100.0 << "%)\n";
+            passed = passed && !regressed;
+        }
+    }
+    return passed;
+}
+
+static void PrintUsage(const char* program)
+{
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --scene <name>      Scene to run (default: triangle)\n"
+              << "  --warmup <n>        Frames rendered before measuring (default: 100)\n"
+              << "  --frames <n>        Measured frames (default: 1000)\n"
+              << "  --size <w>x<h>      Render target size (default: 1280x720)\n"
+              << "  --out <file>        Write the JSON report here instead of stdout\n"
+              << "  --baseline <file>   Compare against a previous report, exit 2 on regression\n"
+              << "  --tolerance <pct>   Allowed p50/p95 slowdown vs. baseline (default: 10)\n"
+              << "  --pipeline-cache <file>  Pipeline cache location (default: pipeline_cache.bin)\n"
+              << "  --no-pipeline-cache      Measure a cold start\n"
+              << "  --no-dynamic-rendering   Use VkRenderPass/VkFramebuffer even if dynamic rendering is available\n"
+              << "  --no-async-compute       Cull the GPU scene on the graphics queue\n"
+              << "  --no-bindless            Do not use descriptor indexing; instanced draws are untextured\n"
+              << "  --texture-budget <mb>    Device memory for streamed texture mips (default: 256)\n"
+              << "  --validation             Enable the Khronos validation layers (off, so they do not skew timings)\n"
+              << "  --threads <n>       Job system threads (default: one per core)\n"
+              << "  --frames-in-flight <n>   Frames recorded ahead of the GPU, 1-4 (default: 2)\n"
+              << "  --list              List scenes\n";
+}
+
+static BenchConfig ParseArgs(int argc, char** argv)
+{
+    BenchConfig config;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--scene" && hasValue) {
+            config.scene = argv[++i];
+        } else if (arg == "--warmup" && hasValue) {
+            config.warmupFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--frames" && hasValue) {
+            config.measuredFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--size" && hasValue) {
+            std::string size = argv[++i];
+            auto x = size.find('x');
+            if (x == std::string::npos) {
+                throw std::runtime_error("Invalid --size, expected <w>x<h>: " + size);
+            }
+            config.width = static_cast<uint32_t>(std::stoul(size.substr(0, x)));
+            config.height = static_cast<uint32_t>(std::stoul(size.substr(x + 1)));
+            if (config.width == 0 || config.height == 0) {
+                throw std::runtime_error("Invalid --size, width and height must be non-zero: " + size);
+            }
+        } else if (arg == "--out" && hasValue) {
+            config.outPath = argv[++i];
+        } else if (arg == "--baseline" && hasValue) {
+            config.baselinePath = argv[++i];
+        } else if (arg == "--tolerance" && hasValue) {
+            config.tolerance = std::stod(argv[++i]) / 100.0;
+        } else if (arg == "--pipeline-cache" && hasValue) {
+            config.renderer.pipelineCachePath = argv[++i];
+        } else if (arg == "--no-pipeline-cache") {
+            config.renderer.pipelineCachePath.clear();
+        } else if (arg == "--no-dynamic-rendering") {
+            config.renderer.dynamicRendering = false;
+        } else if (arg == "--no-async-compute") {
+            config.renderer.asyncCompute = false;
+        } else if (arg == "--no-bindless") {
+            config.renderer.bindless = false;
+        } else if (arg == "--validation") {
+            config.renderer.validation = true;
+        } else if (arg == "--texture-budget" && hasValue) {
+            config.renderer.textureBudgetMB = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--frames-in-flight" && hasValue) {
+            config.renderer.framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--threads" && hasValue) {
+            config.renderer.workerThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--list") {
+            for (const auto& scene : s_Scenes) {
+                std::cout << scene.name << "\t" << scene.description << "\n";
+            }
+            std::exit(0);
+        } else if (arg == "--help" || arg == "-h") {
+            PrintUsage(argv[0]);
+            std::exit(0);
+        } else {
+            PrintUsage(argv[0]);
+            throw std::runtime_error("Unknown argument: " + arg);
+        }
+    }
+    return config;
+}
+
+static int RunBench(const BenchConfig& config)
+{
+    const BenchScene* scene = nullptr;
+    for (const auto& s : s_Scenes) {
+        if (config.scene == s.name) {
+            scene = &s;
+        }
+    }
+    if (!scene) {
+        throw std::runtime_error("Unknown scene: " + config.scene);
+    }
+
+    auto& profiler = Profiler::Get();
+    profiler.SetEnabled(true);
+
+    // Declared before the renderer: its decode threads read the files until
+    // it is destroyed
+    struct TextureDirCleanup {
+        ~TextureDirCleanup() {
+            if (!s_TextureDir.empty()) {
+                std::error_code ec;
+                std::filesystem::remove_all(s_TextureDir, ec);
+            }
+        }
+    } textureDirCleanup;
+
+    auto startupBegin = std::chrono::high_resolution_clock::now();
+    Renderer renderer(config.width, config.height, config.renderer);
+    double startupMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startupBegin).count();
+    const auto& cacheStats = renderer.GetContext().GetPipelineCache().GetStats();
+
+    Camera camera;
+    camera.type = Camera::CameraType::lookat;
+    camera.setPosition(glm::vec3(0.0f, 0.0f, -2.5f));
+    camera.setRotation(glm::vec3(0.0f));
+    camera.setPerspective(60.0f, (float)config.width / (float)config.height, 1.0f, 256.0f);
+
+    std::vector<double> cpuSamples;
+    std::vector<double> gpuSamples;
+    std::vector<double> recordSamples;
+    std::vector<double> cullSamples;
+    std::vector<double> gpuCullSamples;
+    std::vector<double> latencySamples;
+    std::vector<ProfileEvent> events;
+    cpuSamples.reserve(config.measuredFrames);
+    gpuSamples.reserve(config.measuredFrames);
+    recordSamples.reserve(config.measuredFrames);
+    cullSamples.reserve(config.measuredFrames);
+    gpuCullSamples.reserve(config.measuredFrames);
+    latencySamples.reserve(config.measuredFrames);
+
+    uint64_t firstMeasured = UINT64_MAX;
+    uint64_t lastMeasured = 0;
+    auto collectEvents = [&]() {
+        events.clear();
+        profiler.Drain(events);
+        for (const auto& event : events) {
+            if (event.frame < firstMeasured || event.frame > lastMeasured) {
+                continue;
+            }
+            double ms = static_cast<double>(event.endNs - event.startNs) / 1e6;
+            if (event.track == ProfileTrack::Gpu && std::strcmp(event.name, "Frame") == 0) {
+                gpuSamples.push_back(ms);
+            } else if (event.track == ProfileTrack::Cpu && std::strcmp(event.name, "Record") == 0) {
+                recordSamples.push_back(ms);
+            } else if (event.track == ProfileTrack::Cpu && std::strcmp(event.name, "Cull") == 0) {
+                cullSamples.push_back(ms);
+            } else if (event.track != ProfileTrack::Cpu && std::strcmp(event.name, "GpuCull") == 0) {
+                gpuCullSamples.push_back(ms);
+            }
+        }
+    };
+
+    uint32_t totalFrames = config.warmupFrames + config.measuredFrames;
+    uint32_t visibleDraws = 0;
+    uint32_t drawCalls = 0;
+    std::chrono::high_resolution_clock::time_point measureStart;
+    TextureStreamer::Stats texturesAtStart;
+
+    for (uint32_t frame = 0; frame < totalFrames; frame++) {
+        if (frame == config.warmupFrames) {
+            renderer.WaitIdle();
+            // Warmup frames still pending complete here; their latency
+            // includes the idle wait, so it is discarded
+            renderer.DrainLatencySamples(latencySamples);
+            latencySamples.clear();
+            texturesAtStart = renderer.GetTextures().GetStats();
+            measureStart = std::chrono::high_resolution_clock::now();
+        }
+
+        profiler.BeginFrame();
+        if (frame == config.warmupFrames) {
+            firstMeasured = profiler.GetFrameIndex();
+        }
+        lastMeasured = frame >= config.warmupFrames ? profiler.GetFrameIndex() : 0;
+
+        auto tStart = std::chrono::high_resolution_clock::now();
+        renderer.MarkInput();
+        scene->update(renderer, camera, frame);
+        camera.update(0.0f);
+        renderer.UpdateCamera(camera);
+        renderer.DrawFrame();
+        auto tEnd = std::chrono::high_resolution_clock::now();
+
+        visibleDraws = renderer.GetVisibleDrawCount();
+        drawCalls = renderer.GetDrawCallCount();
+        if (frame >= config.warmupFrames) {
+            cpuSamples.push_back(std::chrono::duration<double, std::milli>(tEnd - tStart).count());
+        }
+        renderer.DrainLatencySamples(latencySamples);
+        collectEvents();
+    }
+
+    renderer.WaitIdle();
+    double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - measureStart).count();
+    renderer.DrainLatencySamples(latencySamples);
+
+    // GPU timestamps resolve when their frame slot is reused, so draw a few
+    // more frames to read back the last measured ones
+    for (uint32_t i = 0; i < std::max(renderer.GetImageCount(), renderer.GetFramesInFlight()); i++) {
+        profiler.BeginFrame();
+        renderer.DrawFrame();
+        collectEvents();
+    }
+    renderer.WaitIdle();
+    if (scene->finish) {
+        scene->finish(renderer);
+    }
+
+    Percentiles cpu = ComputePercentiles(cpuSamples);
+    Percentiles gpu = ComputePercentiles(gpuSamples);
+    Percentiles record = ComputePercentiles(recordSamples);
+    Percentiles cull = ComputePercentiles(cullSamples);
+    Percentiles gpuCull = ComputePercentiles(gpuCullSamples);
+    Percentiles latency = ComputePercentiles(latencySamples);
+    const auto& properties = renderer.GetContext().GetDevice().physical_device.properties;
+    MemoryAllocator::Stats memStats = renderer.GetContext().GetAllocator().GetStats();
+    StagingRing::Stats uploadStats = renderer.GetStaging().GetStats();
+    UploadService::Stats streamStats = renderer.GetUploads().GetStats();
+    TextureStreamer::Stats textureStats = renderer.GetTextures().GetStats();
+    uint64_t measuredTextureBytes = textureStats.bytesStreamedIn - texturesAtStart.bytesStreamedIn;
+    const RenderGraph::Stats& graphStats = renderer.GetRenderGraphStats();
+    DescriptorAllocator::Stats descriptorStats = renderer.GetDescriptors().GetStats();
+
+    std::ostringstream report;
+    report << "{\n"
+           << "  \"scene\": \"" << scene->name << "\",\n"
+           << "  \"device\": \"" << properties.deviceName << "\",\n"
+           << "  \"width\": " << config.width << ",\n"
+           << "  \"height\": " << config.height << ",\n"
+           << "  \"warmup_frames\": " << config.warmupFrames << ",\n"
+           << "  \"measured_frames\": " << config.measuredFrames << ",\n"
+           << "  \"worker_threads\": " << renderer.GetWorkerThreadCount() << ",\n"
+           << "  \"frames_in_flight\": " << renderer.GetFramesInFlight() << ",\n"
+           << "  \"latency_to\": \"" << (renderer.IsLatencyToPresent() ? "present" : "gpu_complete") << "\",\n"
+           << "  \"cull_path\": \"" << FrustumCuller::GetPathName(renderer.GetCuller().GetPath()) << "\",\n"
+           << "  \"visible_draws\": " << visibleDraws << ",\n"
+           << "  \"instancing\": " << (renderer.IsInstancing() ? "true" : "false") << ",\n"
+           << "  \"draw_calls\": " << drawCalls << ",\n"
+           << "  \"dynamic_rendering\": " << (renderer.GetContext().IsDynamicRenderingEnabled() ? "true" : "false") << ",\n"
+           << "  \"gpu_objects\": " << (renderer.GetGpuScene() ? renderer.GetGpuScene()->GetObjectCount() : 0) << ",\n"
+           << "  \"gpu_draw_count\": " << (renderer.GetGpuScene() && renderer.GetGpuScene()->HasDrawCount() ? "true" : "false") << ",\n"
+           << "  \"async_compute\": " << (renderer.IsAsyncCompute() ? "true" : "false") << ",\n"
+           << "  \"bindless\": " << (renderer.IsBindless() ? "true" : "false") << ",\n"
+           << "  \"validation\": " << (config.renderer.validation ? "true" : "false") << ",\n"
+           << "  \"startup_ms\": " << startupMs << ",\n"
+           << "  \"pipeline_cache\": {\"loaded\": " << (cacheStats.loaded ? "true" : "false")
+           << ", \"pipelines\": " << cacheStats.pipelinesCreated << ", \"hits\": " << cacheStats.cacheHits
+           << ", \"misses\": " << cacheStats.cacheMisses << ", \"create_ms\": " << cacheStats.createMs << "},\n"
+           << "  \"uploads\": {\"mb\": " << uploadStats.bytesUploaded / (1024.0 * 1024.0)
+           << ", \"submits\": " << uploadStats.submitCount << ", \"mb_per_s\": " << uploadStats.GetMBps() << "},\n"
+           << "  \"streaming\": {\"mb\": " << streamStats.bytesUploaded / (1024.0 * 1024.0)
+           << ", \"submits\": " << streamStats.submitCount << ", \"mb_per_s\": " << streamStats.GetMBps()
+           << ", \"transfer_queue\": " << (renderer.GetContext().HasSeparateTransferQueue() ? "true" : "false") << "},\n"
+           << "  \"textures\": {\"count\": " << textureStats.textureCount
+           << ", \"resident_mb\": " << textureStats.residentBytes / (1024.0 * 1024.0)
+           << ", \"budget_mb\": " << textureStats.budgetBytes / (1024.0 * 1024.0)
+           << ", \"in_mb\": " << textureStats.bytesStreamedIn / (1024.0 * 1024.0)
+           << ", \"out_mb\": " << textureStats.bytesEvicted / (1024.0 * 1024.0)
+           << ", \"levels_in\": " << textureStats.levelsStreamedIn << ", \"levels_out\": " << textureStats.levelsEvicted
+           << ", \"mb_per_s\": " << (elapsed > 0.0 ? measuredTextureBytes / (1024.0 * 1024.0) / elapsed : 0.0)
+           << ", \"decode_ms\": " << textureStats.decodeMs << "},\n"
+           << "  \"render_graph\": {\"passes\": " << graphStats.passCount << ", \"culled\": " << graphStats.culledPassCount
+           << ", \"barriers\": " << graphStats.barrierCount << ", \"image_barriers\": " << graphStats.imageBarrierCount
+           << ", \"transient_mb\": " << graphStats.transientBytes / (1024.0 * 1024.0)
+           << ", \"allocated_mb\": " << graphStats.allocatedBytes / (1024.0 * 1024.0) << "},\n"
+           << "  \"descriptors\": {\"pools\": " << descriptorStats.poolCount << ", \"sets_per_frame\": "
+           << descriptorStats.setCount << ", \"pool_resets\": " << descriptorStats.resetCount << "},\n"
+           << "  \"fps\": " << (elapsed > 0.0 ? config.measuredFrames / elapsed : 0.0) << ",\n";
+    WritePercentiles(report, "cpu_ms", cpu);
+    report << ",\n";
+    WritePercentiles(report, "gpu_ms", gpu);
+    report << ",\n";
+    WritePercentiles(report, "record_ms", record);
+    report << ",\n";
+    WritePercentiles(report, "cull_ms", cull);
+    report << ",\n";
+    WritePercentiles(report, "gpu_cull_ms", gpuCull);
+    report << ",\n";
+    WritePercentiles(report, "latency_ms", latency);
+    report << ",\n"
+           << "  \"peak_memory_mb\": " << GetPeakMemoryMB() << ",\n"
+           << "  \"gpu_memory\": {\"used_mb\": " << memStats.bytesUsed / (1024.0 * 1024.0)
+           << ", \"reserved_mb\": " << memStats.bytesReserved / (1024.0 * 1024.0)
+           << ", \"blocks\": " << memStats.blockCount << ", \"dedicated\": " << memStats.dedicatedCount
+           << ", \"allocations\": " << memStats.allocationCount
+           << ", \"fragmentation\": " << memStats.fragmentation << "},\n"
+           << "  \"dropped_profile_events\": " << profiler.GetDroppedCount() << "\n"
+           << "}\n";
+
+    if (config.outPath.empty()) {
+        std::cout << report.str();
+    } else {
+        std::ofstream out(config.outPath);
+        if (!out.is_open()) {
+            throw std::runtime_error("Failed to open output file: " + config.outPath);
+        }
+        out << report.str();
+    }
+
+    if (!config.baselinePath.empty() && !CompareBaseline(report.str(), config)) {
+        return 2;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    try {
+        return RunBench(ParseArgs(argc, argv));
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,170 @@
+#include "stdafx.h"
+#include "core/job_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <thread>
+
+// Job system microbenchmark. Measures what one job costs end to end (spawn,
+// schedule, run, count down) and how a CPU-bound ParallelFor scales from one
+// thread up to --max-threads. Report is JSON, like JBRendererBench.
+
+struct JobsBenchConfig {
+    uint32_t spawnJobs = 1000000;
+    uint32_t items = 1 << 20;
+    uint32_t batchSize = 1024;
+    uint32_t maxThreads = 0;
+    uint32_t repeats = 5;
+    std::string outPath;
+};
+
+static void PrintUsage(const char* program)
+{
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --jobs <n>          Empty jobs for the spawn test (default: 1000000)\n"
+              << "  --items <n>         ParallelFor iterations (default: 1048576)\n"
+              << "  --batch <n>         ParallelFor batch size (default: 1024)\n"
+              << "  --max-threads <n>   Largest thread count tried (default: one per core)\n"
+              << "  --repeats <n>       Runs per measurement, the fastest is kept (default: 5)\n"
+              << "  --out <file>        Write the JSON report here instead of stdout\n";
+}
+
+static JobsBenchConfig ParseArgs(int argc, char** argv)
+{
+    JobsBenchConfig config;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--jobs" && hasValue) {
+            config.spawnJobs = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--items" && hasValue) {
+            config.items = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--batch" && hasValue) {
+            config.batchSize = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--max-threads" && hasValue) {
+            config.maxThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--repeats" && hasValue) {
+            config.repeats = std::max(1u, static_cast<uint32_t>(std::stoul(argv[++i])));
+        } else if (arg == "--out" && hasValue) {
+            config.outPath = argv[++i];
+        } else if (arg == "--help" || arg == "-h") {
+            PrintUsage(argv[0]);
+            std::exit(0);
+        } else {
+            PrintUsage(argv[0]);
+            throw std::runtime_error("Unknown argument: " + arg);
+        }
+    }
+    if (config.maxThreads == 0) {
+        config.maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return config;
+}
+
+template <typename F>
+static double MeasureBestMs(uint32_t repeats, const F& fn)
+{
+    double best = 1e300;
+    for (uint32_t i = 0; i < repeats; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+    }
+    return best;
+}
+
+// Spawns empty jobs in waves that fit the per-thread job ring, so the number
+// reflects the pooled fast path rather than the heap fallback
+static double MeasureSpawnNs(JobSystem& jobs, const JobsBenchConfig& config)
+{
+    const uint32_t wave = JobSystem::MAX_JOBS_PER_THREAD / 2;
+    double ms = MeasureBestMs(config.repeats, [&]() {
+        for (uint32_t spawned = 0; spawned < config.spawnJobs; spawned += wave) {
+            JobCounter counter;
+            uint32_t count = std::min(wave, config.spawnJobs - spawned);
+            for (uint32_t i = 0; i < count; i++) {
+                jobs.Spawn([]() {}, &counter);
+            }
+            jobs.Wait(counter);
+        }
+    });
+    return ms * 1e6 / std::max(config.spawnJobs, 1u);
+}
+
+// Enough arithmetic per item that the loop is compute bound
+static float Work(uint32_t i)
+{
+    float x = static_cast<float>(i) * 0.001f;
+    for (int k = 0; k < 64; k++) {
+        x = std::sin(x) * 0.5f + std::cos(x * 1.3f);
+    }
+    return x;
+}
+
+static double MeasureParallelForMs(JobSystem& jobs, const JobsBenchConfig& config, std::vector<float>& out)
+{
+    return MeasureBestMs(config.repeats, [&]() {
+        jobs.ParallelFor(config.items, config.batchSize, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                out[i] = Work(i);
+            }
+        });
+    });
+}
+
+static int RunBench(const JobsBenchConfig& config)
+{
+    std::vector<float> results(config.items);
+
+    std::ostringstream report;
+    report << "{\n"
+           << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+           << "  \"items\": " << config.items << ",\n"
+           << "  \"batch_size\": " << config.batchSize << ",\n"
+           << "  \"scaling\": [\n";
+
+    double singleMs = 0.0;
+    double spawnNs = 0.0;
+    for (uint32_t threads = 1; threads <= config.maxThreads; threads++) {
+        JobSystem jobs(threads);
+        double ms = MeasureParallelForMs(jobs, config, results);
+        if (threads == 1) {
+            singleMs = ms;
+        }
+        if (threads == config.maxThreads) {
+            spawnNs = MeasureSpawnNs(jobs, config);
+        }
+
+        report << "    {\"threads\": " << threads << ", \"ms\": " << ms
+               << ", \"speedup\": " << (ms > 0.0 ? singleMs / ms : 0.0) << "}"
+               << (threads < config.maxThreads ? ",\n" : "\n");
+    }
+
+    report << "  ],\n"
+           << "  \"spawn\": {\"jobs\": " << config.spawnJobs << ", \"threads\": " << config.maxThreads
+           << ", \"ns_per_job\": " << spawnNs << "}\n"
+           << "}\n";
+
+    if (config.outPath.empty()) {
+        std::cout << report.str();
+    } else {
+        std::ofstream out(config.outPath);
+        if (!out.is_open()) {
+            throw std::runtime_error("Failed to open output file: " + config.outPath);
+        }
+        out << report.str();
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    try {
+        return RunBench(ParseArgs(argc, argv));
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return 1;
+    }
+}
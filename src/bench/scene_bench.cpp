@@ -0,0 +1,145 @@
+#include "stdafx.h"
+#include "scene/transform_hierarchy.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+// Scene system microbenchmark: a large transform hierarchy where a small
+// fraction of the nodes move every frame. Reports the per-frame Update cost,
+// which should track the moving nodes' subtrees rather than the node count.
+
+struct SceneBenchConfig {
+    uint32_t nodes = 1000000;
+    double movingPercent = 1.0;
+    uint32_t frames = 100;
+    std::string outPath;
+};
+
+static void PrintUsage(const char* program)
+{
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --nodes <n>         Transform nodes (default: 1000000)\n"
+              << "  --moving <pct>      Nodes given a new position each frame (default: 1)\n"
+              << "  --frames <n>        Measured frames (default: 100)\n"
+              << "  --out <file>        Write the JSON report here instead of stdout\n";
+}
+
+static SceneBenchConfig ParseArgs(int argc, char** argv)
+{
+    SceneBenchConfig config;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--nodes" && hasValue) {
+            config.nodes = static_cast<uint32_t>(std::stoul(argv[++i]));
+            if (config.nodes == 0) {
+                throw std::runtime_error("Invalid --nodes, expected at least 1");
+            }
+        } else if (arg == "--moving" && hasValue) {
+            config.movingPercent = std::stod(argv[++i]);
+            if (!(config.movingPercent >= 0.0 && config.movingPercent <= 100.0)) {
+                throw std::runtime_error("Invalid --moving, expected a percentage from 0 to 100");
+            }
+        } else if (arg == "--frames" && hasValue) {
+            config.frames = std::max(1u, static_cast<uint32_t>(std::stoul(argv[++i])));
+        } else if (arg == "--out" && hasValue) {
+            config.outPath = argv[++i];
+        } else if (arg == "--help" || arg == "-h") {
+            PrintUsage(argv[0]);
+            std::exit(0);
+        } else {
+            PrintUsage(argv[0]);
+            throw std::runtime_error("Unknown argument: " + arg);
+        }
+    }
+    return config;
+}
+
+// Depth-first, so the hierarchy never needs reordering: each root gets a
+// 4-ary tree four levels deep (341 nodes)
+static void BuildTree(TransformHierarchy& hierarchy, TransformHierarchy::NodeId parent, uint32_t depth, uint32_t& remaining)
+{
+    for (uint32_t child = 0; child < 4 && remaining > 0; child++) {
+        TransformHierarchy::NodeId node = hierarchy.CreateNode(parent);
+        hierarchy.SetPosition(node, glm::vec3(static_cast<float>(child), 1.0f, 0.0f));
+        remaining--;
+        if (depth > 1) {
+            BuildTree(hierarchy, node, depth - 1, remaining);
+        }
+    }
+}
+
+static double ElapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static int RunBench(const SceneBenchConfig& config)
+{
+    TransformHierarchy hierarchy;
+    hierarchy.Reserve(config.nodes);
+
+    uint32_t remaining = config.nodes;
+    while (remaining > 0) {
+        TransformHierarchy::NodeId root = hierarchy.CreateNode();
+        remaining--;
+        BuildTree(hierarchy, root, 4, remaining);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    hierarchy.Update();
+    double fullMs = ElapsedMs(start);
+
+    uint32_t moving = static_cast<uint32_t>(config.nodes * config.movingPercent / 100.0);
+    uint32_t state = 0x9e3779b9u;
+    std::vector<double> samples;
+    samples.reserve(config.frames);
+    uint64_t updatedTotal = 0;
+
+    for (uint32_t frame = 0; frame < config.frames; frame++) {
+        for (uint32_t i = 0; i < moving; i++) {
+            state = state * 1664525u + 1013904223u;
+            hierarchy.SetPosition(state % config.nodes, glm::vec3(static_cast<float>(frame), 1.0f, 0.0f));
+        }
+
+        start = std::chrono::high_resolution_clock::now();
+        hierarchy.Update();
+        samples.push_back(ElapsedMs(start));
+        updatedTotal += hierarchy.GetStats().updatedCount;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto rank = [&](double p) { return samples[static_cast<size_t>(p * static_cast<double>(samples.size() - 1) + 0.5)]; };
+
+    std::ostringstream report;
+    report << "{\n"
+           << "  \"nodes\": " << config.nodes << ",\n"
+           << "  \"moving_per_frame\": " << moving << ",\n"
+           << "  \"full_update_ms\": " << fullMs << ",\n"
+           << "  \"updated_per_frame\": " << updatedTotal / config.frames << ",\n"
+           << "  \"update_ms\": {\"p50\": " << rank(0.50) << ", \"p95\": " << rank(0.95)
+           << ", \"p99\": " << rank(0.99) << ", \"samples\": " << samples.size() << "}\n"
+           << "}\n";
+
+    if (config.outPath.empty()) {
+        std::cout << report.str();
+    } else {
+        std::ofstream out(config.outPath);
+        if (!out.is_open()) {
+            throw std::runtime_error("Failed to open output file: " + config.outPath);
+        }
+        out << report.str();
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    try {
+        return RunBench(ParseArgs(argc, argv));
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return 1;
+    }
+}
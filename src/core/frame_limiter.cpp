@@ -0,0 +1,84 @@
+#include "../stdafx.h"
+#include "frame_limiter.hpp"
+#include "profiler.hpp"
+
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#include <cerrno>
+#endif
+
+FrameLimiter::FrameLimiter(double targetFps) {
+#ifdef _WIN32
+    // Plain waitable timers round to the scheduler tick (up to 15.6 ms)
+    m_Timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+    SetTargetFps(targetFps);
+}
+
+FrameLimiter::~FrameLimiter() {
+#ifdef _WIN32
+    if (m_Timer) {
+        CloseHandle(m_Timer);
+    }
+#endif
+}
+
+void FrameLimiter::SetTargetFps(double targetFps) {
+    m_TargetFps = targetFps > 0.0 ? targetFps : 0.0;
+    m_Period = m_TargetFps > 0.0
+        ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_TargetFps))
+        : Clock::duration{};
+    m_Deadline = Clock::now();
+}
+
+void FrameLimiter::Wait() {
+    if (m_TargetFps <= 0.0) {
+        return;
+    }
+
+    JB_PROFILE_ZONE("FrameLimiter");
+    m_Deadline += m_Period;
+    Clock::time_point now = Clock::now();
+    if (m_Deadline <= now) {
+        // Behind schedule: start a new one from here
+        m_Deadline = now;
+        return;
+    }
+    SleepUntil(m_Deadline);
+}
+
+void FrameLimiter::SleepUntil(Clock::time_point deadline) {
+#ifdef _WIN32
+    if (m_Timer) {
+        // Relative due time in 100 ns units, negative for relative
+        auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now()).count();
+        if (remaining <= 0) {
+            return;
+        }
+        LARGE_INTEGER dueTime;
+        dueTime.QuadPart = -static_cast<LONGLONG>(remaining / 100);
+        if (SetWaitableTimerEx(m_Timer, &dueTime, 0, nullptr, nullptr, nullptr, 0)) {
+            WaitForSingleObject(m_Timer, INFINITE);
+            return;
+        }
+    }
+    std::this_thread::sleep_until(deadline);
+#elif defined(__APPLE__)
+    std::this_thread::sleep_until(deadline);
+#else
+    // steady_clock is CLOCK_MONOTONIC on Linux, so the deadline can be handed
+    // to the kernel as an absolute time
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+    timespec target;
+    target.tv_sec = static_cast<time_t>(ns / 1000000000);
+    target.tv_nsec = static_cast<long>(ns % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, nullptr) == EINTR) {
+    }
+#endif
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <chrono>
+
+// Caps the frame rate by sleeping until each frame's deadline. Deadlines are
+// absolute (start + n * period) so oversleeping one frame is made up on the
+// next rather than accumulating, and the sleep uses the OS's high resolution
+// timer instead of spinning: a high-resolution waitable timer on Windows,
+// clock_nanosleep on CLOCK_MONOTONIC elsewhere.
+class FrameLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // 0 disables the limiter
+    explicit FrameLimiter(double targetFps = 0.0);
+    ~FrameLimiter();
+
+    FrameLimiter(const FrameLimiter&) = delete;
+    FrameLimiter& operator=(const FrameLimiter&) = delete;
+
+    void SetTargetFps(double targetFps);
+    double GetTargetFps() const { return m_TargetFps; }
+
+    // Sleeps until the next frame is due. A frame that ran long resets the
+    // schedule instead of letting the following frames run back to back.
+    void Wait();
+
+private:
+    double m_TargetFps = 0.0;
+    Clock::duration m_Period{};
+    Clock::time_point m_Deadline{};
+    void* m_Timer = nullptr;            // Windows waitable timer
+
+    void SleepUntil(Clock::time_point deadline);
+};
@@ -0,0 +1,266 @@
+#include "stdafx.h"
+#include "job_system.hpp"
+
+thread_local JobSystem* JobSystem::s_Current = nullptr;
+thread_local uint32_t JobSystem::s_WorkerIndex = 0;
+
+JobSystem::JobSystem(uint32_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_Workers.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++) {
+        auto worker = std::make_unique<Worker>();
+        worker->jobs = std::make_unique<Job[]>(MAX_JOBS_PER_THREAD);
+        worker->random = 0x9e3779b9u * (i + 1);
+        m_Workers.push_back(std::move(worker));
+    }
+
+    s_Current = this;
+    s_WorkerIndex = 0;
+
+    m_Threads.reserve(threadCount - 1);
+    for (uint32_t i = 1; i < threadCount; i++) {
+        m_Threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    // Let everything already queued finish, main-thread jobs included
+    for (;;) {
+        RunMainThreadJobs();
+        Job* job = FindJob();
+        if (job) {
+            Execute(job);
+            continue;
+        }
+
+        bool idle = m_SharedQueueSize.load(std::memory_order_acquire) == 0 &&
+                    m_MainQueueSize.load(std::memory_order_acquire) == 0 &&
+                    std::all_of(m_Workers.begin(), m_Workers.end(), [](const auto& w) { return w->deque.IsEmpty(); });
+        if (idle) {
+            break;
+        }
+        std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        m_Stop = true;
+    }
+    m_WakeCondition.notify_all();
+    for (auto& thread : m_Threads) {
+        thread.join();
+    }
+
+    if (s_Current == this) {
+        s_Current = nullptr;
+    }
+}
+
+Job* JobSystem::AllocateJob() {
+    if (s_Current == this) {
+        // Only the owning thread hands out its slots; whoever runs the job
+        // frees the slot again by clearing inUse
+        Worker& worker = *m_Workers[s_WorkerIndex];
+        for (uint32_t attempt = 0; attempt < MAX_JOBS_PER_THREAD; attempt++) {
+            Job& job = worker.jobs[worker.nextJob++ & (MAX_JOBS_PER_THREAD - 1)];
+            if (!job.inUse.load(std::memory_order_acquire)) {
+                job.inUse.store(true, std::memory_order_relaxed);
+                job.heapAllocated = false;
+                return &job;
+            }
+        }
+    }
+
+    // Foreign thread, or every slot is still pending
+    Job* job = new Job();
+    job->heapAllocated = true;
+    return job;
+}
+
+void JobSystem::Push(Job* job) {
+    if (s_Current != this || !m_Workers[s_WorkerIndex]->deque.Push(job)) {
+        std::lock_guard<std::mutex> lock(m_SharedMutex);
+        m_SharedQueue.push_back(job);
+        m_SharedQueueSize.fetch_add(1, std::memory_order_release);
+    }
+
+    // Pairs with the sleeping worker's increment before its final look for
+    // work: either it sees this job or we see it asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_Sleeping.load(std::memory_order_relaxed) > 0) {
+        {
+            std::lock_guard<std::mutex> lock(m_SleepMutex);
+            m_WakeEpoch++;
+        }
+        m_WakeCondition.notify_one();
+    }
+}
+
+Job* JobSystem::PopQueue(std::mutex& mutex, std::deque<Job*>& queue, std::atomic<uint32_t>& size) {
+    if (size.load(std::memory_order_acquire) == 0) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (queue.empty()) {
+        return nullptr;
+    }
+    Job* job = queue.front();
+    queue.pop_front();
+    size.fetch_sub(1, std::memory_order_relaxed);
+    return job;
+}
+
+Job* JobSystem::FindJob() {
+    uint32_t self = s_Current == this ? s_WorkerIndex : UINT32_MAX;
+
+    if (self == 0) {
+        if (Job* job = PopQueue(m_MainMutex, m_MainQueue, m_MainQueueSize)) {
+            return job;
+        }
+    }
+    if (self != UINT32_MAX) {
+        if (Job* job = m_Workers[self]->deque.Pop()) {
+            return job;
+        }
+    }
+    if (Job* job = PopQueue(m_SharedMutex, m_SharedQueue, m_SharedQueueSize)) {
+        return job;
+    }
+
+    // Steal, starting from a random victim so thieves spread out
+    uint32_t count = static_cast<uint32_t>(m_Workers.size());
+    uint32_t start = 0;
+    if (self != UINT32_MAX) {
+        uint32_t& random = m_Workers[self]->random;
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        start = random % count;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t victim = (start + i) % count;
+        if (victim == self) {
+            continue;
+        }
+        if (Job* job = m_Workers[victim]->deque.Steal()) {
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::Execute(Job* job) {
+    JobCounter* counter = job->counter;
+    try {
+        job->invoke(job->storage);
+    } catch (...) {
+        if (!counter) {
+            throw;
+        }
+        std::lock_guard<std::mutex> lock(counter->m_Mutex);
+        if (!counter->m_Error) {
+            counter->m_Error = std::current_exception();
+        }
+    }
+    job->destroy(job->storage);
+
+    if (job->heapAllocated) {
+        delete job;
+    } else {
+        job->inUse.store(false, std::memory_order_release);
+    }
+
+    if (!counter) {
+        return;
+    }
+
+    uint32_t value = counter->m_Value.load(std::memory_order_relaxed);
+    while (value > 1 && !counter->m_Value.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel)) {
+    }
+    if (value > 1) {
+        return;
+    }
+
+    // The last decrement happens under the lock: Wait takes the same lock
+    // before returning, so the counter cannot go away while we still touch it
+    std::vector<Job*> continuations;
+    {
+        std::lock_guard<std::mutex> lock(counter->m_Mutex);
+        if (counter->m_Value.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            continuations.swap(counter->m_Continuations);
+        }
+    }
+    for (Job* continuation : continuations) {
+        Push(continuation);
+    }
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+    uint32_t idleSpins = 0;
+    while (!counter.IsDone()) {
+        if (Job* job = FindJob()) {
+            Execute(job);
+            idleSpins = 0;
+        } else if (++idleSpins > 64) {
+            std::this_thread::yield();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(counter.m_Mutex);
+    if (counter.m_Error) {
+        std::rethrow_exception(std::exchange(counter.m_Error, nullptr));
+    }
+}
+
+void JobSystem::RunMainThreadJobs() {
+    while (Job* job = PopQueue(m_MainMutex, m_MainQueue, m_MainQueueSize)) {
+        Execute(job);
+    }
+}
+
+void JobSystem::WorkerLoop(uint32_t index) {
+    s_Current = this;
+    s_WorkerIndex = index;
+
+    uint32_t idleSpins = 0;
+    for (;;) {
+        if (Job* job = FindJob()) {
+            Execute(job);
+            idleSpins = 0;
+            continue;
+        }
+
+        // Spin briefly before paying for a sleep/wake round trip
+        if (++idleSpins < 256) {
+            std::this_thread::yield();
+            continue;
+        }
+        idleSpins = 0;
+
+        uint64_t epoch;
+        {
+            std::lock_guard<std::mutex> lock(m_SleepMutex);
+            if (m_Stop) {
+                return;
+            }
+            epoch = m_WakeEpoch;
+        }
+
+        m_Sleeping.fetch_add(1, std::memory_order_seq_cst);
+        if (Job* job = FindJob()) {
+            m_Sleeping.fetch_sub(1, std::memory_order_relaxed);
+            Execute(job);
+            continue;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(m_SleepMutex);
+            m_WakeCondition.wait(lock, [&] { return m_Stop || m_WakeEpoch != epoch; });
+        }
+        m_Sleeping.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "work_stealing_deque.hpp"
+
+class JobCounter;
+
+// A unit of work with its callable stored inline. Internal to JobSystem.
+struct Job {
+    static constexpr size_t STORAGE_SIZE = 64;
+
+    alignas(std::max_align_t) unsigned char storage[STORAGE_SIZE];
+    void (*invoke)(void*) = nullptr;
+    void (*destroy)(void*) = nullptr;
+    JobCounter* counter = nullptr;
+    bool heapAllocated = false;
+    std::atomic<bool> inUse{false};
+};
+
+// Number of unfinished jobs spawned against it. JobSystem::Wait runs other
+// jobs until it drops to zero, SpawnAfter holds a job back until then, and
+// the first exception thrown by one of its jobs is rethrown from Wait.
+class JobCounter {
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool IsDone() const { return m_Value.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> m_Value{0};
+    std::mutex m_Mutex;
+    std::vector<Job*> m_Continuations;
+    std::exception_ptr m_Error;
+};
+
+// Work-stealing scheduler. The constructing thread is worker 0 (the main
+// thread) and takes part whenever it waits; the others run a loop that pops
+// their own deque, then steals from random peers, then sleeps. Jobs spawned
+// with SpawnOnMainThread only ever run on worker 0, for APIs such as GLFW
+// that must be called from the main thread.
+class JobSystem {
+public:
+    static constexpr uint32_t MAX_JOBS_PER_THREAD = 4096;
+
+    // threadCount includes the calling thread; 0 means one per hardware core
+    explicit JobSystem(uint32_t threadCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+    bool IsMainThread() const { return s_Current == this && s_WorkerIndex == 0; }
+    // Worker running the caller, 0 for the main thread. Lets callers keep
+    // per-thread state without locking; threads the system does not own
+    // also read 0.
+    uint32_t GetCurrentThreadIndex() const { return s_Current == this ? s_WorkerIndex : 0; }
+
+    // fn is moved into the job; captures must fit in Job::STORAGE_SIZE bytes
+    template <typename F>
+    void Spawn(F&& fn, JobCounter* counter = nullptr) {
+        Push(MakeJob(std::forward<F>(fn), counter));
+    }
+
+    // Runs fn once dependency reaches zero
+    template <typename F>
+    void SpawnAfter(JobCounter& dependency, F&& fn, JobCounter* counter = nullptr) {
+        Job* job = MakeJob(std::forward<F>(fn), counter);
+        {
+            std::lock_guard<std::mutex> lock(dependency.m_Mutex);
+            if (!dependency.IsDone()) {
+                dependency.m_Continuations.push_back(job);
+                return;
+            }
+        }
+        Push(job);
+    }
+
+    template <typename F>
+    void SpawnOnMainThread(F&& fn, JobCounter* counter = nullptr) {
+        Job* job = MakeJob(std::forward<F>(fn), counter);
+        std::lock_guard<std::mutex> lock(m_MainMutex);
+        m_MainQueue.push_back(job);
+        m_MainQueueSize.fetch_add(1, std::memory_order_release);
+    }
+
+    // Runs queued jobs on this thread until counter reaches zero
+    void Wait(JobCounter& counter);
+
+    // Drains the main-thread queue. Call once per frame from the main loop.
+    void RunMainThreadJobs();
+
+    // Calls fn(begin, end) over [0, count) in batches of batchSize and waits
+    template <typename F>
+    void ParallelFor(uint32_t count, uint32_t batchSize, const F& fn) {
+        if (count == 0) {
+            return;
+        }
+        batchSize = std::max(batchSize, 1u);
+        if (count <= batchSize || m_Workers.size() == 1) {
+            fn(0u, count);
+            return;
+        }
+
+        JobCounter counter;
+        const F* body = &fn;
+        for (uint32_t begin = 0; begin < count; begin += batchSize) {
+            uint32_t end = std::min(begin + batchSize, count);
+            Spawn([body, begin, end]() { (*body)(begin, end); }, &counter);
+        }
+        Wait(counter);
+    }
+
+private:
+    struct Worker {
+        WorkStealingDeque<Job, MAX_JOBS_PER_THREAD> deque;
+        std::unique_ptr<Job[]> jobs;
+        uint32_t nextJob = 0;
+        uint32_t random = 0;
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_Workers;
+    std::vector<std::thread> m_Threads;
+
+    // Jobs spawned from threads that are not workers, or when a deque is full
+    std::mutex m_SharedMutex;
+    std::deque<Job*> m_SharedQueue;
+    std::atomic<uint32_t> m_SharedQueueSize{0};
+
+    std::mutex m_MainMutex;
+    std::deque<Job*> m_MainQueue;
+    std::atomic<uint32_t> m_MainQueueSize{0};
+
+    std::mutex m_SleepMutex;
+    std::condition_variable m_WakeCondition;
+    std::atomic<uint32_t> m_Sleeping{0};
+    uint64_t m_WakeEpoch = 0;
+    bool m_Stop = false;
+
+    static thread_local JobSystem* s_Current;
+    static thread_local uint32_t s_WorkerIndex;
+
+    template <typename F>
+    Job* MakeJob(F&& fn, JobCounter* counter) {
+        using Fn = std::decay_t<F>;
+        static_assert(sizeof(Fn) <= Job::STORAGE_SIZE, "Job captures too large, capture by pointer or reference");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t), "Job captures over-aligned");
+
+        Job* job = AllocateJob();
+        new (job->storage) Fn(std::forward<F>(fn));
+        job->invoke = [](void* storage) { (*static_cast<Fn*>(storage))(); };
+        job->destroy = [](void* storage) { static_cast<Fn*>(storage)->~Fn(); };
+        job->counter = counter;
+        if (counter) {
+            counter->m_Value.fetch_add(1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    Job* AllocateJob();
+    void Push(Job* job);
+    Job* FindJob();
+    Job* PopQueue(std::mutex& mutex, std::deque<Job*>& queue, std::atomic<uint32_t>& size);
+    void Execute(Job* job);
+    void WorkerLoop(uint32_t index);
+};
@@ -0,0 +1,106 @@
+#include "stdafx.h"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+    const char* GetTrackLabel(ProfileTrack track) {
+        switch (track) {
+            case ProfileTrack::Gpu: return "GPU ";
+            case ProfileTrack::GpuCompute: return "ACS ";
+            default: return "CPU ";
+        }
+    }
+}
+
+Profiler& Profiler::Get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+uint64_t Profiler::NowNs() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+uint32_t Profiler::GetThreadId() {
+    static std::atomic<uint32_t> nextId{0};
+    thread_local uint32_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+void Profiler::Record(const ProfileEvent& event) {
+    if (!IsEnabled()) {
+        return;
+    }
+    if (!m_Events.TryPush(event)) {
+        m_Dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+size_t Profiler::Drain(std::vector<ProfileEvent>& out) {
+    size_t count = 0;
+    ProfileEvent event;
+    while (m_Events.TryPop(event)) {
+        out.push_back(event);
+        count++;
+    }
+    return count;
+}
+
+ProfileZone::~ProfileZone() {
+    auto& profiler = Profiler::Get();
+    if (m_Start == 0 || !profiler.IsEnabled()) {
+        return;
+    }
+
+    ProfileEvent event;
+    event.name = m_Name;
+    event.startNs = m_Start;
+    event.endNs = Profiler::NowNs();
+    event.frame = profiler.GetFrameIndex();
+    event.threadId = Profiler::GetThreadId();
+    event.track = ProfileTrack::Cpu;
+    profiler.Record(event);
+}
+
+void ProfileStats::Add(const std::vector<ProfileEvent>& events) {
+    for (const auto& event : events) {
+        auto& zones = m_Zones[static_cast<size_t>(event.track)];
+        auto it = zones.find(event.name);
+        if (it == zones.end()) {
+            it = zones.emplace(event.name, ZoneStats{event.name, event.track}).first;
+        }
+
+        double ms = static_cast<double>(event.endNs - event.startNs) / 1e6;
+        it->second.totalMs += ms;
+        it->second.maxMs = std::max(it->second.maxMs, ms);
+        it->second.count++;
+    }
+}
+
+void ProfileStats::Print(std::ostream& os, uint64_t frameCount) const {
+    // Built apart, so the column formatting does not stick to the caller's stream
+    std::ostringstream table;
+    table << "Profile over " << frameCount << " frames (avg / max ms):\n";
+    for (const auto& zones : m_Zones) {
+        std::vector<const ZoneStats*> sorted;
+        for (const auto& [key, stats] : zones) {
+            sorted.push_back(&stats);
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const ZoneStats* a, const ZoneStats* b) {
+            return std::string(a->name) < std::string(b->name);
+        });
+
+        for (const auto* stats : sorted) {
+            table << "  " << GetTrackLabel(stats->track)
+                  << std::left << std::setw(20) << stats->name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(9) << stats->totalMs / static_cast<double>(stats->count)
+                  << std::setw(9) << stats->maxMs << "\n";
+        }
+    }
+    os << table.str() << std::flush;
+}
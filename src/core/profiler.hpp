@@ -0,0 +1,98 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include "ring_buffer.hpp"
+
+enum class ProfileTrack : uint8_t {
+    Cpu,
+    Gpu,
+    GpuCompute,         // The async compute queue
+    Count
+};
+
+// A completed zone. Names must be string literals (or otherwise outlive the
+// profiler) since only the pointer is stored.
+struct ProfileEvent {
+    const char* name = nullptr;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    uint64_t frame = 0;
+    uint32_t threadId = 0;
+    ProfileTrack track = ProfileTrack::Cpu;
+};
+
+// Process-wide sink for CPU zones and resolved GPU timestamps. Producers
+// never block: events go into a lock-free ring and are dropped if nobody
+// drains it fast enough.
+class Profiler {
+public:
+    static Profiler& Get();
+
+    // Nanoseconds on the steady clock since process start
+    static uint64_t NowNs();
+    static uint32_t GetThreadId();
+
+    void SetEnabled(bool enabled) { m_Enabled.store(enabled, std::memory_order_relaxed); }
+    bool IsEnabled() const { return m_Enabled.load(std::memory_order_relaxed); }
+
+    void BeginFrame() { m_Frame.fetch_add(1, std::memory_order_relaxed); }
+    uint64_t GetFrameIndex() const { return m_Frame.load(std::memory_order_relaxed); }
+
+    void Record(const ProfileEvent& event);
+
+    // Pops everything currently queued into out, returns the number appended
+    size_t Drain(std::vector<ProfileEvent>& out);
+    uint64_t GetDroppedCount() const { return m_Dropped.load(std::memory_order_relaxed); }
+
+private:
+    Profiler() = default;
+
+    RingBuffer<ProfileEvent, 16384> m_Events;
+    std::atomic<bool> m_Enabled{false};
+    std::atomic<uint64_t> m_Frame{0};
+    std::atomic<uint64_t> m_Dropped{0};
+};
+
+// Scoped CPU zone, recorded on destruction
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name)
+        : m_Name(name), m_Start(Profiler::Get().IsEnabled() ? Profiler::NowNs() : 0) {}
+    ~ProfileZone();
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* m_Name;
+    uint64_t m_Start;
+};
+
+// Accumulates drained events into per-zone averages for periodic reporting
+class ProfileStats {
+public:
+    void Add(const std::vector<ProfileEvent>& events);
+    void Print(std::ostream& os, uint64_t frameCount) const;
+    void Reset() {
+        for (auto& zones : m_Zones) {
+            zones.clear();
+        }
+    }
+
+private:
+    struct ZoneStats {
+        const char* name;
+        ProfileTrack track;
+        double totalMs = 0.0;
+        double maxMs = 0.0;
+        uint64_t count = 0;
+    };
+    std::unordered_map<const void*, ZoneStats> m_Zones[static_cast<size_t>(ProfileTrack::Count)];
+};
+
+#define JB_PROFILE_CONCAT_INNER(a, b) a##b
+#define JB_PROFILE_CONCAT(a, b) JB_PROFILE_CONCAT_INNER(a, b)
+#define JB_PROFILE_ZONE(name) ProfileZone JB_PROFILE_CONCAT(profileZone_, __LINE__)(name)
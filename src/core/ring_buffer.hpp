@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Bounded lock-free multi-producer/multi-consumer queue (Vyukov). Each cell
+// carries a sequence number so producers and consumers only contend on
+// their own cursor; TryPush fails instead of blocking when the ring is full.
+template <typename T, size_t Capacity>
+class RingBuffer {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    RingBuffer()
+        : m_Cells(std::make_unique<Cell[]>(Capacity))
+    {
+        for (size_t i = 0; i < Capacity; i++) {
+            m_Cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    bool TryPush(const T& value) {
+        size_t pos = m_Head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_Cells[pos & (Capacity - 1)];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_Head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // Full
+            } else {
+                pos = m_Head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool TryPop(T& out) {
+        size_t pos = m_Tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_Cells[pos & (Capacity - 1)];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (m_Tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = cell.value;
+                    cell.sequence.store(pos + Capacity, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // Empty
+            } else {
+                pos = m_Tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    static constexpr size_t GetCapacity() { return Capacity; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> m_Cells;
+    alignas(64) std::atomic<size_t> m_Head{0};
+    alignas(64) std::atomic<size_t> m_Tail{0};
+};
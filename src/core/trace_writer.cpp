@@ -0,0 +1,91 @@
+#include "stdafx.h"
+#include "trace_writer.hpp"
+
+#include <algorithm>
+
+TraceWriter::TraceWriter(const std::string& path)
+    : m_FileBuffer(FILE_BUFFER_SIZE)
+{
+    m_File = std::fopen(path.c_str(), "wb");
+    if (!m_File) {
+        throw std::runtime_error("Failed to open trace file: " + path);
+    }
+    std::setvbuf(m_File, m_FileBuffer.data(), _IOFBF, m_FileBuffer.size());
+
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", m_File);
+    WriteThreadName(Profiler::GetThreadId(), "Main");
+    WriteThreadName(GPU_THREAD_ID, "GPU");
+    WriteThreadName(GPU_COMPUTE_THREAD_ID, "GPU Async Compute");
+
+    m_Pending.reserve(4096);
+    m_Thread = std::thread(&TraceWriter::WriterLoop, this);
+}
+
+TraceWriter::~TraceWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Wake.notify_one();
+    m_Thread.join();
+
+    // Pick up anything recorded after the writer's last pass
+    Flush();
+
+    std::fputs("\n]}\n", m_File);
+    std::fclose(m_File);
+}
+
+void TraceWriter::WriterLoop() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (!m_Stop) {
+        m_Wake.wait_for(lock, std::chrono::milliseconds(10));
+        lock.unlock();
+        Flush();
+        lock.lock();
+    }
+}
+
+void TraceWriter::Flush() {
+    m_Pending.clear();
+    Profiler::Get().Drain(m_Pending);
+    for (const auto& event : m_Pending) {
+        WriteEvent(event);
+    }
+    m_EventCount.fetch_add(m_Pending.size(), std::memory_order_relaxed);
+}
+
+void TraceWriter::WriteEvent(const ProfileEvent& event) {
+    // GPU queues get a row each, so async compute shows up next to the
+    // graphics work it overlaps
+    uint32_t tid = event.threadId;
+    if (event.track == ProfileTrack::Gpu) {
+        tid = GPU_THREAD_ID;
+    } else if (event.track == ProfileTrack::GpuCompute) {
+        tid = GPU_COMPUTE_THREAD_ID;
+    }
+
+    // Zone names are code literals, so no JSON escaping is needed
+    char line[256];
+    int length = std::snprintf(line, sizeof(line),
+        "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+        "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+        m_FirstEvent ? "" : ",\n",
+        event.name,
+        event.track == ProfileTrack::Cpu ? "cpu" : "gpu",
+        tid,
+        static_cast<double>(event.startNs) / 1000.0,
+        static_cast<double>(event.endNs - event.startNs) / 1000.0,
+        static_cast<unsigned long long>(event.frame));
+    if (length > 0) {
+        std::fwrite(line, 1, std::min(static_cast<size_t>(length), sizeof(line) - 1), m_File);
+        m_FirstEvent = false;
+    }
+}
+
+void TraceWriter::WriteThreadName(uint32_t threadId, const char* name) {
+    std::fprintf(m_File,
+        "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+        m_FirstEvent ? "" : ",\n", threadId, name);
+    m_FirstEvent = false;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "profiler.hpp"
+
+// Streams profiler events to a Chrome trace JSON file (chrome://tracing,
+// Perfetto). A background thread drains the profiler ring and formats
+// events into a large stdio buffer, so the render thread only ever pays
+// for the lock-free push.
+class TraceWriter {
+public:
+    explicit TraceWriter(const std::string& path);
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    uint64_t GetEventCount() const { return m_EventCount.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t FILE_BUFFER_SIZE = 1 << 20;
+    static constexpr uint32_t GPU_THREAD_ID = 1000;
+    static constexpr uint32_t GPU_COMPUTE_THREAD_ID = 1001;
+
+    std::FILE* m_File = nullptr;
+    std::vector<char> m_FileBuffer;
+    std::vector<ProfileEvent> m_Pending;
+    bool m_FirstEvent = true;
+    std::atomic<uint64_t> m_EventCount{0};
+
+    std::thread m_Thread;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    bool m_Stop = false;
+
+    void WriterLoop();
+    void Flush();
+    void WriteEvent(const ProfileEvent& event);
+    void WriteThreadName(uint32_t threadId, const char* name);
+};
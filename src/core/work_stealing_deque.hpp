@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Bounded Chase-Lev deque of pointers. The owning thread pushes and pops at
+// the bottom (LIFO, cache-warm); any other thread may steal from the top
+// (FIFO, oldest and usually largest work first). Only the single pop/steal
+// race on the last element needs a CAS.
+template <typename T, size_t Capacity>
+class WorkStealingDeque {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    WorkStealingDeque()
+        : m_Items(std::make_unique<std::atomic<T*>[]>(Capacity))
+    {
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // Owner only. Fails when full.
+    bool Push(T* item) {
+        int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+        int64_t top = m_Top.load(std::memory_order_acquire);
+        if (bottom - top >= static_cast<int64_t>(Capacity)) {
+            return false;
+        }
+
+        m_Items[bottom & (Capacity - 1)].store(item, std::memory_order_relaxed);
+        m_Bottom.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Owner only. Returns nullptr when empty.
+    T* Pop() {
+        int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+        m_Bottom.store(bottom, std::memory_order_seq_cst);
+        int64_t top = m_Top.load(std::memory_order_seq_cst);
+
+        if (top > bottom) {
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T* item = m_Items[bottom & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (top == bottom) {
+            // Last element: race any thief for it
+            if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Any thread. Returns nullptr when empty or when another thread won the race.
+    T* Steal() {
+        int64_t top = m_Top.load(std::memory_order_seq_cst);
+        int64_t bottom = m_Bottom.load(std::memory_order_seq_cst);
+        if (top >= bottom) {
+            return nullptr;
+        }
+
+        T* item = m_Items[top & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    bool IsEmpty() const {
+        return m_Top.load(std::memory_order_relaxed) >= m_Bottom.load(std::memory_order_relaxed);
+    }
+
+    static constexpr size_t GetCapacity() { return Capacity; }
+
+private:
+    std::unique_ptr<std::atomic<T*>[]> m_Items;
+    alignas(64) std::atomic<int64_t> m_Top{0};
+    alignas(64) std::atomic<int64_t> m_Bottom{0};
+};
@@ -1,13 +1,115 @@
 #include "stdafx.h"
 #include "app.hpp"
 
-int main()
+static void PrintUsage(const char* program)
+{
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --headless          Render offscreen without a window\n"
+              << "  --frames <n>        Exit after rendering n frames (headless default: 1000)\n"
+              << "  --size <w>x<h>      Render target size (default: 1024x1024)\n"
+              << "  --profile           Print CPU/GPU zone timings every second\n"
+              << "  --trace <file>      Write a Chrome trace JSON (chrome://tracing, Perfetto)\n"
+              << "  --pipeline-cache <file>  Pipeline cache location (default: pipeline_cache.bin)\n"
+              << "  --no-pipeline-cache      Do not load or save the pipeline cache\n"
+              << "  --no-dynamic-rendering   Use VkRenderPass/VkFramebuffer even if dynamic rendering is available\n"
+              << "  --no-async-compute       Cull the GPU scene on the graphics queue\n"
+              << "  --no-bindless            Do not use descriptor indexing; instanced draws are untextured\n"
+              << "  --texture-budget <mb>    Device memory for streamed texture mips (default: 256)\n"
+              << "  --no-validation          Run without the Khronos validation layers\n"
+              << "  --threads <n>       Job system threads (default: one per core)\n"
+              << "  --frames-in-flight <n>   Frames recorded ahead of the GPU, 1-4 (default: 2)\n"
+              << "  --present-mode <mode>    fifo, mailbox, immediate or fifo_relaxed (default: fifo)\n"
+              << "  --swapchain-images <n>   Swapchain images to request (default: surface minimum + 1)\n"
+              << "  --low-latency       Start each frame once the previous one is presented (VK_KHR_present_wait)\n"
+              << "  --fps-limit <n>     Cap the frame rate (default: no limit)\n";
+}
+
+static AppConfig ParseArgs(int argc, char** argv)
+{
+    AppConfig config;
+    bool framesSet = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--headless") {
+            config.headless = true;
+        } else if (arg == "--profile") {
+            config.profile = true;
+        } else if (arg == "--trace" && hasValue) {
+            config.tracePath = argv[++i];
+        } else if (arg == "--pipeline-cache" && hasValue) {
+            config.renderer.pipelineCachePath = argv[++i];
+        } else if (arg == "--no-pipeline-cache") {
+            config.renderer.pipelineCachePath.clear();
+        } else if (arg == "--no-dynamic-rendering") {
+            config.renderer.dynamicRendering = false;
+        } else if (arg == "--no-async-compute") {
+            config.renderer.asyncCompute = false;
+        } else if (arg == "--no-bindless") {
+            config.renderer.bindless = false;
+        } else if (arg == "--no-validation") {
+            config.renderer.validation = false;
+        } else if (arg == "--texture-budget" && hasValue) {
+            config.renderer.textureBudgetMB = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--frames-in-flight" && hasValue) {
+            config.renderer.framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--present-mode" && hasValue) {
+            std::string mode = argv[++i];
+            if (!SwapChain::ParsePresentMode(mode, config.renderer.presentMode)) {
+                throw std::runtime_error("Unknown present mode: " + mode);
+            }
+        } else if (arg == "--swapchain-images" && hasValue) {
+            config.renderer.swapchainImages = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--low-latency") {
+            config.renderer.lowLatency = true;
+        } else if (arg == "--fps-limit" && hasValue) {
+            config.fpsLimit = std::stod(argv[++i]);
+        } else if (arg == "--threads" && hasValue) {
+            config.renderer.workerThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--frames" && hasValue) {
+            config.frameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+            framesSet = true;
+        } else if (arg == "--size" && hasValue) {
+            std::string size = argv[++i];
+            auto x = size.find('x');
+            if (x == std::string::npos) {
+                throw std::runtime_error("Invalid --size, expected <w>x<h>: " + size);
+            }
+            config.width = static_cast<uint32_t>(std::stoul(size.substr(0, x)));
+            config.height = static_cast<uint32_t>(std::stoul(size.substr(x + 1)));
+            if (config.width == 0 || config.height == 0) {
+                throw std::runtime_error("Invalid --size, width and height must be non-zero: " + size);
+            }
+        } else if (arg == "--help" || arg == "-h") {
+            PrintUsage(argv[0]);
+            std::exit(0);
+        } else {
+            PrintUsage(argv[0]);
+            throw std::runtime_error("Unknown argument: " + arg);
+        }
+    }
+
+    // Both consume the profiler's event ring, so only one can be active
+    if (config.profile && !config.tracePath.empty()) {
+        throw std::runtime_error("--profile and --trace cannot be combined");
+    }
+
+    // A headless run has no window to close, so it needs a frame budget
+    if (config.headless && !framesSet) {
+        config.frameCount = 1000;
+    }
+    return config;
+}
+
+int main(int argc, char** argv)
 {
     try {
-        App app;
+        App app(ParseArgs(argc, argv));
         return app.Run();
     } catch (const std::exception& e) {
         std::cerr << "Fatal error: " << e.what() << std::endl;
         return -1;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,257 @@
+#include "../stdafx.h"
+#include "async_compute.hpp"
+#include "../core/profiler.hpp"
+
+#include <algorithm>
+
+AsyncCompute::AsyncCompute(VulkanContext& context, uint32_t frameCount)
+    : m_Context(context)
+{
+    auto& disp = m_Context.GetDispatchTable();
+
+    // Transient: the whole pool is reset every time the slot comes around
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = m_Context.GetComputeQueueIndex();
+
+    m_Slots.resize(frameCount);
+    for (auto& slot : m_Slots) {
+        if (disp.createCommandPool(&poolInfo, nullptr, &slot.pool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create compute command pool");
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = slot.pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        if (disp.allocateCommandBuffers(&allocInfo, &slot.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate compute command buffer");
+        }
+    }
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (disp.createSemaphore(&semaphoreInfo, nullptr, &m_Timeline) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create compute timeline");
+    }
+}
+
+AsyncCompute::~AsyncCompute() {
+    WaitIdle();
+
+    auto& disp = m_Context.GetDispatchTable();
+    disp.destroySemaphore(m_Timeline, nullptr);
+    for (auto& slot : m_Slots) {
+        disp.destroyCommandPool(slot.pool, nullptr);
+    }
+}
+
+VkCommandBuffer AsyncCompute::Begin(uint32_t frameIndex) {
+    auto& disp = m_Context.GetDispatchTable();
+    Slot& slot = m_Slots[frameIndex];
+    if (!IsComplete(slot.value)) {
+        JB_PROFILE_ZONE("WaitForCompute");
+        WaitForValue(slot.value);
+    }
+
+    disp.resetCommandPool(slot.pool, 0);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (disp.beginCommandBuffer(slot.commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording compute command buffer");
+    }
+    return slot.commandBuffer;
+}
+
+void AsyncCompute::AddWait(VkSemaphore timeline, uint64_t value, VkPipelineStageFlags stages) {
+    for (auto& wait : m_Waits) {
+        if (wait.semaphore == timeline) {
+            wait.value = std::max(wait.value, value);
+            wait.stages |= stages;
+            return;
+        }
+    }
+    if (m_Waits.size() == MAX_WAITS) {
+        throw std::runtime_error("Too many timeline waits for one compute submission");
+    }
+    m_Waits.push_back({timeline, value, stages});
+}
+
+uint64_t AsyncCompute::Submit(uint32_t frameIndex) {
+    auto& disp = m_Context.GetDispatchTable();
+    Slot& slot = m_Slots[frameIndex];
+
+    if (disp.endCommandBuffer(slot.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record compute command buffer");
+    }
+
+    VkSemaphore waitSemaphores[MAX_WAITS];
+    VkPipelineStageFlags waitStages[MAX_WAITS];
+    uint64_t waitValues[MAX_WAITS];
+    uint32_t waitCount = 0;
+    for (const auto& wait : m_Waits) {
+        waitSemaphores[waitCount] = wait.semaphore;
+        waitStages[waitCount] = wait.stages;
+        waitValues[waitCount] = wait.value;
+        waitCount++;
+    }
+    m_Waits.clear();
+
+    uint64_t signalValue = m_NextValue;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = waitCount;
+    timelineInfo.pWaitSemaphoreValues = waitValues;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = waitCount;
+    submitInfo.pWaitSemaphores = waitSemaphores;
+    submitInfo.pWaitDstStageMask = waitStages;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &slot.commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_Timeline;
+
+    if (disp.queueSubmit(m_Context.GetComputeQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit compute command buffer");
+    }
+
+    slot.value = signalValue;
+    m_NextValue++;
+    return signalValue;
+}
+
+bool AsyncCompute::IsComplete(uint64_t value) {
+    if (value <= m_CompletedValue) {
+        return true;
+    }
+    if (m_Context.GetDispatchTable().getSemaphoreCounterValue(m_Timeline, &m_CompletedValue) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to read compute timeline");
+    }
+    return value <= m_CompletedValue;
+}
+
+void AsyncCompute::WaitIdle() {
+    WaitForValue(m_NextValue - 1);
+}
+
+void AsyncCompute::WaitForValue(uint64_t value) {
+    if (value <= m_CompletedValue) {
+        return;
+    }
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_Timeline;
+    waitInfo.pValues = &value;
+
+    if (m_Context.GetDispatchTable().waitSemaphores(&waitInfo, UINT64_MAX) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to wait for compute work");
+    }
+    m_CompletedValue = value;
+}
+
+void AsyncCompute::GetFamilies(Transfer transfer, uint32_t& src, uint32_t& dst) const {
+    src = m_Context.GetGraphicsQueueIndex();
+    dst = m_Context.GetComputeQueueIndex();
+    if (transfer == Transfer::ToGraphics) {
+        std::swap(src, dst);
+    }
+}
+
+void AsyncCompute::ReleaseBuffer(VkCommandBuffer cmd, VkBuffer buffer, Transfer transfer,
+                                 VkPipelineStageFlags srcStages, VkAccessFlags srcAccess) const {
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = 0;
+    GetFamilies(transfer, barrier.srcQueueFamilyIndex, barrier.dstQueueFamilyIndex);
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    if (barrier.srcQueueFamilyIndex == barrier.dstQueueFamilyIndex) {
+        return;
+    }
+
+    // The semaphore signal after this submission carries the dependency on
+    m_Context.GetDispatchTable().cmdPipelineBarrier(cmd, srcStages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                                    0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void AsyncCompute::AcquireBuffer(VkCommandBuffer cmd, VkBuffer buffer, Transfer transfer,
+                                 VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) const {
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = dstAccess;
+    GetFamilies(transfer, barrier.srcQueueFamilyIndex, barrier.dstQueueFamilyIndex);
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    if (barrier.srcQueueFamilyIndex == barrier.dstQueueFamilyIndex) {
+        return;
+    }
+
+    // Source stages match the semaphore wait, so the acquire is ordered after it
+    m_Context.GetDispatchTable().cmdPipelineBarrier(cmd, dstStages, dstStages,
+                                                    0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void AsyncCompute::ReleaseImage(VkCommandBuffer cmd, VkImage image, const VkImageSubresourceRange& range,
+                                VkImageLayout oldLayout, VkImageLayout newLayout, Transfer transfer,
+                                VkPipelineStageFlags srcStages, VkAccessFlags srcAccess) const {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = 0;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    GetFamilies(transfer, barrier.srcQueueFamilyIndex, barrier.dstQueueFamilyIndex);
+    barrier.image = image;
+    barrier.subresourceRange = range;
+    if (barrier.srcQueueFamilyIndex == barrier.dstQueueFamilyIndex) {
+        return;
+    }
+
+    m_Context.GetDispatchTable().cmdPipelineBarrier(cmd, srcStages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                                    0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void AsyncCompute::AcquireImage(VkCommandBuffer cmd, VkImage image, const VkImageSubresourceRange& range,
+                                VkImageLayout oldLayout, VkImageLayout newLayout, Transfer transfer,
+                                VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) const {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    GetFamilies(transfer, barrier.srcQueueFamilyIndex, barrier.dstQueueFamilyIndex);
+    barrier.image = image;
+    barrier.subresourceRange = range;
+    if (barrier.srcQueueFamilyIndex == barrier.dstQueueFamilyIndex) {
+        return;
+    }
+
+    m_Context.GetDispatchTable().cmdPipelineBarrier(cmd, dstStages, dstStages,
+                                                    0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
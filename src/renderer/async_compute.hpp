@@ -0,0 +1,93 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include <vector>
+#include "vulkan_context.hpp"
+#include "frame_tracker.hpp"
+
+// Compute work submitted on the compute queue, next to the frame's graphics
+// submission rather than inside it. Each frame slot has its own command pool
+// on the compute family, reset when the slot comes around. Every Submit
+// signals the next value of the class's timeline semaphore; the graphics
+// submission waits on that value at the stages that consume the results,
+// so everything before them overlaps the compute work.
+//
+// Resources written on one queue and read on the other either are created
+// VK_SHARING_MODE_CONCURRENT over both families or change owner with the
+// Release/Acquire pairs below.
+class AsyncCompute {
+public:
+    enum class Transfer {
+        ToGraphics,
+        ToCompute
+    };
+
+    // Only worth it when the context found a compute family other than the
+    // graphics one
+    static bool IsSupported(const VulkanContext& context) { return context.HasAsyncCompute(); }
+
+    AsyncCompute(VulkanContext& context, uint32_t frameCount = DEFAULT_FRAMES_IN_FLIGHT);
+    ~AsyncCompute();
+
+    AsyncCompute(const AsyncCompute&) = delete;
+    AsyncCompute& operator=(const AsyncCompute&) = delete;
+
+    // Resets the slot's pool and begins its command buffer. Waits for the
+    // slot's previous submission, which the graphics frame that used the
+    // slot before has normally waited on already.
+    VkCommandBuffer Begin(uint32_t frameIndex);
+    // Makes the next Submit wait for value on another timeline
+    void AddWait(VkSemaphore timeline, uint64_t value, VkPipelineStageFlags stages);
+    // Ends and submits the slot's command buffer; returns the timeline value
+    // signalled once it has completed
+    uint64_t Submit(uint32_t frameIndex);
+
+    bool IsComplete(uint64_t value);
+    void WaitIdle();
+
+    VkSemaphore GetTimeline() const { return m_Timeline; }
+    uint32_t GetQueueFamily() const { return m_Context.GetComputeQueueIndex(); }
+
+    // Queue family ownership transfers between the graphics and compute
+    // families. The release goes into the giving queue's command buffer, the
+    // matching acquire into the receiving one's, which must wait on the
+    // giving submission at dstStages. Contents that are about to be
+    // overwritten need no transfer at all.
+    void ReleaseBuffer(VkCommandBuffer cmd, VkBuffer buffer, Transfer transfer,
+                       VkPipelineStageFlags srcStages, VkAccessFlags srcAccess) const;
+    void AcquireBuffer(VkCommandBuffer cmd, VkBuffer buffer, Transfer transfer,
+                       VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) const;
+    // The layouts must match between the release and the acquire; the
+    // transition happens once, between the two
+    void ReleaseImage(VkCommandBuffer cmd, VkImage image, const VkImageSubresourceRange& range,
+                      VkImageLayout oldLayout, VkImageLayout newLayout, Transfer transfer,
+                      VkPipelineStageFlags srcStages, VkAccessFlags srcAccess) const;
+    void AcquireImage(VkCommandBuffer cmd, VkImage image, const VkImageSubresourceRange& range,
+                      VkImageLayout oldLayout, VkImageLayout newLayout, Transfer transfer,
+                      VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) const;
+
+private:
+    static constexpr uint32_t MAX_WAITS = 4;
+
+    struct Slot {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        uint64_t value = 0;             // Signalled by the slot's last submission
+    };
+
+    struct Wait {
+        VkSemaphore semaphore;
+        uint64_t value;
+        VkPipelineStageFlags stages;
+    };
+
+    VulkanContext& m_Context;
+    std::vector<Slot> m_Slots;
+    VkSemaphore m_Timeline = VK_NULL_HANDLE;
+    uint64_t m_NextValue = 1;
+    uint64_t m_CompletedValue = 0;
+    std::vector<Wait> m_Waits;
+
+    void WaitForValue(uint64_t value);
+    void GetFamilies(Transfer transfer, uint32_t& src, uint32_t& dst) const;
+};
@@ -0,0 +1,259 @@
+#include "../stdafx.h"
+#include "bindless_table.hpp"
+#include "../core/profiler.hpp"
+
+#include <algorithm>
+
+bool BindlessTable::IsSupported(const VulkanContext& context) {
+    // Defined by CMake (compile_optional_shaders) when the SPIR-V is available
+#ifdef JB_BINDLESS
+    return context.IsDescriptorIndexingEnabled();
+#else
+    (void)context;
+    return false;
+#endif
+}
+
+BindlessTable::BindlessTable(VulkanContext& context, uint32_t frameCount, uint32_t maxImages, uint32_t maxBuffers)
+    : m_Context(context), m_FrameCount(frameCount)
+{
+    auto& disp = m_Context.GetDispatchTable();
+
+    // Update-after-bind arrays have their own, usually much larger, limits
+    VkPhysicalDeviceVulkan12Properties properties12{};
+    properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &properties12;
+    m_Context.GetInstanceDispatch().getPhysicalDeviceProperties2(m_Context.GetDevice().physical_device.physical_device,
+                                                                 &properties);
+    maxImages = std::min({maxImages, properties12.maxDescriptorSetUpdateAfterBindSampledImages,
+                          properties12.maxPerStageDescriptorUpdateAfterBindSampledImages});
+    maxBuffers = std::min({maxBuffers, properties12.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                           properties12.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+
+    for (Array* array : {&m_Images, &m_Buffers}) {
+        array->capacity = array == &m_Images ? maxImages : maxBuffers;
+        array->stale.resize(frameCount);
+    }
+    m_Stats.maxImages = maxImages;
+    m_Stats.maxBuffers = maxBuffers;
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (disp.createSampler(&samplerInfo, nullptr, &m_Sampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create bindless sampler");
+    }
+
+    VkDescriptorSetLayoutBinding bindings[3]{};
+    bindings[0].binding = IMAGE_BINDING;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    bindings[0].descriptorCount = maxImages;
+    bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+    bindings[1].binding = BUFFER_BINDING;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = maxBuffers;
+    bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+    bindings[2].binding = SAMPLER_BINDING;
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    bindings[2].descriptorCount = 1;
+    bindings[2].stageFlags = VK_SHADER_STAGE_ALL;
+    bindings[2].pImmutableSamplers = &m_Sampler;
+
+    // Only the handles in use hold valid descriptors
+    VkDescriptorBindingFlags arrayFlags =
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+    VkDescriptorBindingFlags bindingFlags[3] = {arrayFlags, arrayFlags, 0};
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+    flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flagsInfo.bindingCount = 3;
+    flagsInfo.pBindingFlags = bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &flagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = 3;
+    layoutInfo.pBindings = bindings;
+
+    if (disp.createDescriptorSetLayout(&layoutInfo, nullptr, &m_SetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create bindless descriptor set layout");
+    }
+
+    VkDescriptorPoolSize poolSizes[3]{};
+    poolSizes[0] = {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, maxImages * frameCount};
+    poolSizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxBuffers * frameCount};
+    poolSizes[2] = {VK_DESCRIPTOR_TYPE_SAMPLER, frameCount};
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = frameCount;
+    poolInfo.poolSizeCount = 3;
+    poolInfo.pPoolSizes = poolSizes;
+
+    if (disp.createDescriptorPool(&poolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create bindless descriptor pool");
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts(frameCount, m_SetLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = frameCount;
+    allocInfo.pSetLayouts = layouts.data();
+
+    m_Sets.resize(frameCount);
+    if (disp.allocateDescriptorSets(&allocInfo, m_Sets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate bindless descriptor sets");
+    }
+}
+
+BindlessTable::~BindlessTable() {
+    auto& disp = m_Context.GetDispatchTable();
+    disp.destroyDescriptorPool(m_DescriptorPool, nullptr);
+    disp.destroyDescriptorSetLayout(m_SetLayout, nullptr);
+    disp.destroySampler(m_Sampler, nullptr);
+}
+
+BindlessTable::Handle BindlessTable::Allocate(Array& array, const char* what) {
+    Handle handle;
+    if (!array.freeHandles.empty()) {
+        handle = array.freeHandles.back();
+        array.freeHandles.pop_back();
+    } else if (array.descriptors.size() < array.capacity) {
+        handle = static_cast<Handle>(array.descriptors.size());
+        array.descriptors.emplace_back();
+    } else {
+        throw std::runtime_error(std::string("Bindless ") + what + " array is full");
+    }
+    array.count++;
+    return handle;
+}
+
+void BindlessTable::Release(Array& array, Handle handle) {
+    // Slots may still list the handle as stale; Flush skips it while empty
+    Descriptor& descriptor = array.descriptors[handle];
+    descriptor.view = VK_NULL_HANDLE;
+    descriptor.buffer = {};
+    array.freeHandles.push_back(handle);
+    array.count--;
+}
+
+void BindlessTable::MarkStale(Array& array, Handle handle) {
+    Descriptor& descriptor = array.descriptors[handle];
+    for (uint32_t frame = 0; frame < m_FrameCount; frame++) {
+        uint32_t bit = 1u << frame;
+        if (!(descriptor.staleFrames & bit)) {
+            descriptor.staleFrames |= bit;
+            array.stale[frame].push_back(handle);
+        }
+    }
+}
+
+BindlessTable::Handle BindlessTable::AddImage(VkImageView view) {
+    Handle handle = Allocate(m_Images, "image");
+    SetImage(handle, view);
+    m_Stats.imageCount = m_Images.count;
+    return handle;
+}
+
+void BindlessTable::SetImage(Handle handle, VkImageView view) {
+    m_Images.descriptors[handle].view = view;
+    if (view != VK_NULL_HANDLE) {
+        MarkStale(m_Images, handle);
+    }
+}
+
+void BindlessTable::RemoveImage(Handle handle) {
+    Release(m_Images, handle);
+    m_Stats.imageCount = m_Images.count;
+}
+
+BindlessTable::Handle BindlessTable::AddBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    Handle handle = Allocate(m_Buffers, "buffer");
+    SetBuffer(handle, buffer, offset, range);
+    m_Stats.bufferCount = m_Buffers.count;
+    return handle;
+}
+
+void BindlessTable::SetBuffer(Handle handle, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    m_Buffers.descriptors[handle].buffer = {buffer, offset, range};
+    if (buffer != VK_NULL_HANDLE) {
+        MarkStale(m_Buffers, handle);
+    }
+}
+
+void BindlessTable::RemoveBuffer(Handle handle) {
+    Release(m_Buffers, handle);
+    m_Stats.bufferCount = m_Buffers.count;
+}
+
+void BindlessTable::Flush(uint32_t frameIndex) {
+    std::vector<Handle>& staleImages = m_Images.stale[frameIndex];
+    std::vector<Handle>& staleBuffers = m_Buffers.stale[frameIndex];
+    if (staleImages.empty() && staleBuffers.empty()) {
+        return;
+    }
+
+    JB_PROFILE_ZONE("BindlessFlush");
+    uint32_t bit = 1u << frameIndex;
+
+    // Sized up front: the writes point into these
+    std::vector<VkDescriptorImageInfo> imageInfos;
+    std::vector<VkDescriptorBufferInfo> bufferInfos;
+    std::vector<VkWriteDescriptorSet> writes;
+    imageInfos.reserve(staleImages.size());
+    bufferInfos.reserve(staleBuffers.size());
+    writes.reserve(staleImages.size() + staleBuffers.size());
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_Sets[frameIndex];
+    write.descriptorCount = 1;
+
+    for (Handle handle : staleImages) {
+        Descriptor& descriptor = m_Images.descriptors[handle];
+        descriptor.staleFrames &= ~bit;
+        if (descriptor.view == VK_NULL_HANDLE) {
+            continue;
+        }
+        imageInfos.push_back({VK_NULL_HANDLE, descriptor.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+        write.dstBinding = IMAGE_BINDING;
+        write.dstArrayElement = handle;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        write.pImageInfo = &imageInfos.back();
+        write.pBufferInfo = nullptr;
+        writes.push_back(write);
+    }
+    for (Handle handle : staleBuffers) {
+        Descriptor& descriptor = m_Buffers.descriptors[handle];
+        descriptor.staleFrames &= ~bit;
+        if (descriptor.buffer.buffer == VK_NULL_HANDLE) {
+            continue;
+        }
+        bufferInfos.push_back(descriptor.buffer);
+        write.dstBinding = BUFFER_BINDING;
+        write.dstArrayElement = handle;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.pImageInfo = nullptr;
+        write.pBufferInfo = &bufferInfos.back();
+        writes.push_back(write);
+    }
+    staleImages.clear();
+    staleBuffers.clear();
+
+    if (!writes.empty()) {
+        m_Context.GetDispatchTable().updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        m_Stats.writeCount += writes.size();
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include <vector>
+#include "vulkan_context.hpp"
+#include "frame_tracker.hpp"
+
+// Every sampled image and storage buffer the renderer hands to shaders, as
+// large partially bound arrays in one descriptor set. A resource is
+// registered once and shaders index the arrays with its handle, taken from
+// push constants or per-instance data, so draws bind no descriptors of their
+// own and draws with different textures can still be merged.
+//
+// Each frame in flight has its own copy of the set. Add, Set and Remove only
+// record a change; Flush writes it into a frame slot's set once that slot's
+// previous submission has completed, so no descriptor is rewritten while the
+// GPU may read it and handles can be recycled right away. The set is
+// update-after-bind, so Flush may run after the frame's secondaries bound
+// it. Main thread only.
+class BindlessTable {
+public:
+    using Handle = uint32_t;
+    static constexpr Handle INVALID_HANDLE = UINT32_MAX;
+
+    static constexpr uint32_t DEFAULT_MAX_IMAGES = 16384;
+    static constexpr uint32_t DEFAULT_MAX_BUFFERS = 4096;
+
+    // Bindings of the set, see bindless.frag
+    static constexpr uint32_t IMAGE_BINDING = 0;        // texture2D[], SHADER_READ_ONLY_OPTIMAL
+    static constexpr uint32_t BUFFER_BINDING = 1;       // Storage buffers
+    static constexpr uint32_t SAMPLER_BINDING = 2;      // One immutable trilinear repeat sampler
+
+    struct Stats {
+        uint32_t imageCount = 0;
+        uint32_t bufferCount = 0;
+        uint32_t maxImages = 0;         // After clamping to the device limits
+        uint32_t maxBuffers = 0;
+        uint64_t writeCount = 0;        // Descriptors written by Flush, in total
+    };
+
+    // The device has descriptor indexing and the build has bindless.frag
+    static bool IsSupported(const VulkanContext& context);
+
+    BindlessTable(VulkanContext& context, uint32_t frameCount = DEFAULT_FRAMES_IN_FLIGHT,
+                  uint32_t maxImages = DEFAULT_MAX_IMAGES, uint32_t maxBuffers = DEFAULT_MAX_BUFFERS);
+    ~BindlessTable();
+
+    BindlessTable(const BindlessTable&) = delete;
+    BindlessTable& operator=(const BindlessTable&) = delete;
+
+    // A null view reserves the handle without writing it; shaders must not
+    // index it until SetImage gives it a view. Throws when the array is full.
+    Handle AddImage(VkImageView view);
+    void SetImage(Handle handle, VkImageView view);
+    // The handle may be returned by the next Add; frames already recorded
+    // keep reading the old view, which must outlive them
+    void RemoveImage(Handle handle);
+
+    Handle AddBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+    void SetBuffer(Handle handle, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+    void RemoveBuffer(Handle handle);
+
+    // Writes the changes frameIndex's set has not seen yet. Once per frame
+    // before its submission, after the slot's previous one has completed.
+    void Flush(uint32_t frameIndex);
+
+    VkDescriptorSetLayout GetSetLayout() const { return m_SetLayout; }
+    VkDescriptorSet GetSet(uint32_t frameIndex) const { return m_Sets[frameIndex]; }
+    const Stats& GetStats() const { return m_Stats; }
+
+private:
+    struct Descriptor {
+        VkImageView view = VK_NULL_HANDLE;
+        VkDescriptorBufferInfo buffer{};
+        uint32_t staleFrames = 0;       // Bit per frame slot whose set lacks the latest value
+    };
+
+    // One of the set's arrays
+    struct Array {
+        uint32_t capacity = 0;
+        uint32_t count = 0;
+        std::vector<Descriptor> descriptors;
+        std::vector<Handle> freeHandles;
+        std::vector<std::vector<Handle>> stale;     // Per frame slot
+    };
+
+    VulkanContext& m_Context;
+    uint32_t m_FrameCount;
+    VkSampler m_Sampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> m_Sets;
+    Array m_Images;
+    Array m_Buffers;
+    Stats m_Stats;
+
+    Handle Allocate(Array& array, const char* what);
+    void Release(Array& array, Handle handle);
+    void MarkStale(Array& array, Handle handle);
+};
@@ -1,10 +1,13 @@
 #include "../stdafx.h"
 #include "command_manager.hpp"
+#include "../core/profiler.hpp"
 
-CommandManager::CommandManager(VulkanContext& context, uint32_t bufferCount)
+#include <algorithm>
+
+CommandManager::CommandManager(VulkanContext& context, uint32_t frameCount, uint32_t threadCount)
     : m_Context(context)
 {
-    Initialize(bufferCount);
+    Initialize(frameCount, threadCount);
 }
 
 CommandManager::~CommandManager() {
@@ -13,81 +16,229 @@ CommandManager::~CommandManager() {
 
 void CommandManager::Cleanup() {
     auto& disp = m_Context.GetDispatchTable();
-    disp.destroyCommandPool(m_CommandPool, nullptr);
+    for (auto pool : m_CommandPools) {
+        disp.destroyCommandPool(pool, nullptr);
+    }
+    for (auto& frame : m_ThreadCommands) {
+        for (auto& thread : frame) {
+            disp.destroyCommandPool(thread.pool, nullptr);
+        }
+    }
 }
 
-void CommandManager::Initialize(uint32_t bufferCount) {
-    // Create command pool
+VkCommandPool CommandManager::CreatePool() {
+    // Transient: the whole pool is reset every time the frame comes around
     VkCommandPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
     poolInfo.queueFamilyIndex = m_Context.GetGraphicsQueueIndex();
 
-    if (m_Context.GetDispatchTable().createCommandPool(&poolInfo, nullptr, &m_CommandPool) != VK_SUCCESS) {
+    VkCommandPool pool;
+    if (m_Context.GetDispatchTable().createCommandPool(&poolInfo, nullptr, &pool) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create command pool");
     }
+    return pool;
+}
 
-    // Allocate command buffers
-    m_CommandBuffers.resize(bufferCount);
-
+VkCommandBuffer CommandManager::AllocateBuffer(VkCommandPool pool, VkCommandBufferLevel level) {
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = m_CommandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = static_cast<uint32_t>(m_CommandBuffers.size());
+    allocInfo.commandPool = pool;
+    allocInfo.level = level;
+    allocInfo.commandBufferCount = 1;
 
-    if (m_Context.GetDispatchTable().allocateCommandBuffers(&allocInfo, m_CommandBuffers.data()) != VK_SUCCESS) {
+    VkCommandBuffer buffer;
+    if (m_Context.GetDispatchTable().allocateCommandBuffers(&allocInfo, &buffer) != VK_SUCCESS) {
         throw std::runtime_error("Failed to allocate command buffers");
     }
+    return buffer;
 }
 
-void CommandManager::RecordCommands(
-    SwapChain& swapchain,
+void CommandManager::Initialize(uint32_t frameCount, uint32_t threadCount) {
+    m_CommandPools.resize(frameCount);
+    m_CommandBuffers.resize(frameCount);
+    m_ThreadCommands.resize(frameCount);
+    m_SecondaryCounts.resize(frameCount, 0);
+
+    for (uint32_t i = 0; i < frameCount; i++) {
+        m_CommandPools[i] = CreatePool();
+        m_CommandBuffers[i] = AllocateBuffer(m_CommandPools[i], VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+        m_ThreadCommands[i].resize(threadCount + 1);
+        for (auto& thread : m_ThreadCommands[i]) {
+            thread.pool = CreatePool();
+            thread.secondary = AllocateBuffer(thread.pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+        }
+    }
+}
+
+void CommandManager::RecordSecondaries(
+    uint32_t frameIndex,
+    uint32_t imageIndex,
+    RenderTarget& target,
     RenderPass& renderPass,
     Framebuffer& framebuffers,
-    Pipeline& pipeline
+    Pipeline& pipeline,
+    JobSystem& jobs,
+    uint32_t drawCount,
+    const RecordDrawsFn& recordDraws,
+    const RecordCommandsFn& recordPassExtra
 ) {
     auto& disp = m_Context.GetDispatchTable();
-    
-    for (size_t i = 0; i < m_CommandBuffers.size(); i++) {
+    auto& threadCommands = m_ThreadCommands[frameIndex];
+
+    VkFramebuffer framebuffer = renderPass.IsDynamic() ? VK_NULL_HANDLE : framebuffers.GetHandles()[imageIndex];
+    VkFormat colorFormat = renderPass.GetColorFormat();
+
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(target.GetExtent().width);
+    viewport.height = static_cast<float>(target.GetExtent().height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor{};
+    scissor.offset = {0, 0};
+    scissor.extent = target.GetExtent();
+
+    // Contiguous draw ranges, one per thread, each recorded into that
+    // thread's own pool so no two threads ever touch the same pool
+    uint32_t wanted = (drawCount + MIN_DRAWS_PER_THREAD - 1) / MIN_DRAWS_PER_THREAD;
+    uint32_t chunkCount = std::clamp(wanted, 1u, static_cast<uint32_t>(threadCommands.size() - 1));
+    uint32_t perChunk = (drawCount + chunkCount - 1) / chunkCount;
+
+    // The extra secondary takes the slot after the last draw range
+    uint32_t secondaryCount = chunkCount + (recordPassExtra ? 1 : 0);
+
+    auto recordChunk = [&](uint32_t chunk) {
+        JB_PROFILE_ZONE("RecordSecondary");
+        ThreadCommands& thread = threadCommands[chunk];
+        disp.resetCommandPool(thread.pool, 0);
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = renderPass.GetHandle();
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = framebuffer;
+
+        // Dynamic rendering inherits the attachment formats instead of a render pass
+        VkCommandBufferInheritanceRenderingInfoKHR renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachmentFormats = &colorFormat;
+        renderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        if (renderPass.IsDynamic()) {
+            inheritanceInfo.pNext = &renderingInfo;
+        }
+
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
 
-        if (disp.beginCommandBuffer(m_CommandBuffers[i], &beginInfo) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to begin recording command buffer");
+        if (disp.beginCommandBuffer(thread.secondary, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to begin recording secondary command buffer");
         }
 
-        VkRenderPassBeginInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = renderPass.GetHandle();
-        renderPassInfo.framebuffer = framebuffers.GetHandles()[i];
-        renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = swapchain.GetExtent();
-
-        VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &clearColor;
-
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = static_cast<float>(swapchain.GetExtent().width);
-        viewport.height = static_cast<float>(swapchain.GetExtent().height);
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-
-        VkRect2D scissor{};
-        scissor.offset = {0, 0};
-        scissor.extent = swapchain.GetExtent();
-
-        disp.cmdSetViewport(m_CommandBuffers[i], 0, 1, &viewport);
-        disp.cmdSetScissor(m_CommandBuffers[i], 0, 1, &scissor);
-        disp.cmdBeginRenderPass(m_CommandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        disp.cmdBindPipeline(m_CommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.GetHandle());
-        disp.cmdDraw(m_CommandBuffers[i], 3, 1, 0, 0);
-        disp.cmdEndRenderPass(m_CommandBuffers[i]);
-
-        if (disp.endCommandBuffer(m_CommandBuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to record command buffer");
+        // Dynamic state is not inherited from the primary
+        disp.cmdSetViewport(thread.secondary, 0, 1, &viewport);
+        disp.cmdSetScissor(thread.secondary, 0, 1, &scissor);
+
+        if (chunk < chunkCount) {
+            disp.cmdBindPipeline(thread.secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.GetHandle());
+            uint32_t begin = std::min(chunk * perChunk, drawCount);
+            uint32_t end = std::min(begin + perChunk, drawCount);
+            recordDraws(thread.secondary, begin, end);
+        } else {
+            recordPassExtra(thread.secondary);
         }
+
+        if (disp.endCommandBuffer(thread.secondary) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to record secondary command buffer");
+        }
+    };
+
+    // One job per chunk; jobs may land on any worker, which is fine because
+    // the pool belongs to the chunk rather than to the thread
+    jobs.ParallelFor(secondaryCount, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t chunk = begin; chunk < end; chunk++) {
+            recordChunk(chunk);
+        }
+    });
+
+    m_SecondaryCounts[frameIndex] = secondaryCount;
+}
+
+VkCommandBuffer CommandManager::BeginPrimary(uint32_t frameIndex) {
+    auto& disp = m_Context.GetDispatchTable();
+    VkCommandBuffer cmd = m_CommandBuffers[frameIndex];
+
+    disp.resetCommandPool(m_CommandPools[frameIndex], 0);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (disp.beginCommandBuffer(cmd, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording command buffer");
+    }
+    return cmd;
+}
+
+void CommandManager::RecordMainPass(VkCommandBuffer cmd, uint32_t frameIndex, uint32_t imageIndex, RenderTarget& target,
+                                    RenderPass& renderPass, Framebuffer& framebuffers) {
+    auto& disp = m_Context.GetDispatchTable();
+    auto& threadCommands = m_ThreadCommands[frameIndex];
+    uint32_t secondaryCount = m_SecondaryCounts[frameIndex];
+
+    std::vector<VkCommandBuffer> secondaries(secondaryCount);
+    for (uint32_t i = 0; i < secondaryCount; i++) {
+        secondaries[i] = threadCommands[i].secondary;
     }
-}
\ No newline at end of file
+
+    VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+
+    if (renderPass.IsDynamic()) {
+        VkRenderingAttachmentInfoKHR colorAttachment{};
+        colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        colorAttachment.imageView = target.GetImageViews()[imageIndex];
+        colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.clearValue = clearColor;
+
+        VkRenderingInfoKHR renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+        renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR;
+        renderingInfo.renderArea.offset = {0, 0};
+        renderingInfo.renderArea.extent = target.GetExtent();
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachments = &colorAttachment;
+
+        disp.cmdBeginRenderingKHR(cmd, &renderingInfo);
+        disp.cmdExecuteCommands(cmd, secondaryCount, secondaries.data());
+        disp.cmdEndRenderingKHR(cmd);
+        return;
+    }
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass.GetHandle();
+    renderPassInfo.framebuffer = framebuffers.GetHandles()[imageIndex];
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = target.GetExtent();
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearColor;
+
+    disp.cmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    disp.cmdExecuteCommands(cmd, secondaryCount, secondaries.data());
+    disp.cmdEndRenderPass(cmd);
+}
+
+void CommandManager::EndPrimary(uint32_t frameIndex) {
+    if (m_Context.GetDispatchTable().endCommandBuffer(m_CommandBuffers[frameIndex]) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record command buffer");
+    }
+}
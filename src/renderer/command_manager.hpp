@@ -1,32 +1,71 @@
 #pragma once
 #include <vulkan/vulkan_core.h>
+#include <functional>
 #include <vector>
 #include "vulkan_context.hpp"
 #include "framebuffer.hpp"
 #include "render_pass.hpp"
 #include "pipeline.hpp"
-#include "swap_chain.hpp"
+#include "render_target.hpp"
+#include "../core/job_system.hpp"
 
+// Per frame in flight: one pool for the primary command buffer plus one pool
+// per recording job for secondaries. Pools are reset, never freed, and the
+// whole frame is re-recorded every time it comes around.
 class CommandManager {
 public:
-    CommandManager(VulkanContext& context, uint32_t bufferCount);
+    // Records draws [begin, end) into a secondary command buffer that already
+    // has the pipeline, viewport and scissor bound
+    using RecordDrawsFn = std::function<void(VkCommandBuffer cmd, uint32_t begin, uint32_t end)>;
+    using RecordCommandsFn = std::function<void(VkCommandBuffer cmd)>;
+
+    // Below this many draws per thread, fewer threads are used
+    static constexpr uint32_t MIN_DRAWS_PER_THREAD = 128;
+
+    CommandManager(VulkanContext& context, uint32_t frameCount, uint32_t threadCount);
     ~CommandManager();
 
-    void RecordCommands(
-        SwapChain& swapchain,
+    // Must only be called once frameIndex's previous submission has completed.
+    // Records the draw ranges into secondaries on the job system;
+    // recordPassExtra gets one more secondary, executed after the draw
+    // ranges, with viewport and scissor set but no pipeline bound.
+    void RecordSecondaries(
+        uint32_t frameIndex,
+        uint32_t imageIndex,
+        RenderTarget& target,
         RenderPass& renderPass,
         Framebuffer& framebuffers,
-        Pipeline& pipeline
+        Pipeline& pipeline,
+        JobSystem& jobs,
+        uint32_t drawCount,
+        const RecordDrawsFn& recordDraws,
+        const RecordCommandsFn& recordPassExtra = nullptr
     );
 
-    VkCommandPool GetPool() const { return m_CommandPool; }
+    // Resets the frame's pool and begins its primary command buffer
+    VkCommandBuffer BeginPrimary(uint32_t frameIndex);
+    // Runs the render pass (or dynamic rendering into the target's image
+    // view) over the secondaries from RecordSecondaries
+    void RecordMainPass(VkCommandBuffer cmd, uint32_t frameIndex, uint32_t imageIndex, RenderTarget& target,
+                        RenderPass& renderPass, Framebuffer& framebuffers);
+    void EndPrimary(uint32_t frameIndex);
+
     const std::vector<VkCommandBuffer>& GetBuffers() const { return m_CommandBuffers; }
 
 private:
+    struct ThreadCommands {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        VkCommandBuffer secondary = VK_NULL_HANDLE;
+    };
+
     VulkanContext& m_Context;
-    VkCommandPool m_CommandPool;
+    std::vector<VkCommandPool> m_CommandPools;
     std::vector<VkCommandBuffer> m_CommandBuffers;
+    std::vector<std::vector<ThreadCommands>> m_ThreadCommands;     // [frame][thread], plus one for recordPassExtra
+    std::vector<uint32_t> m_SecondaryCounts;                        // Recorded per frame by RecordSecondaries
 
     void Cleanup();
-    void Initialize(uint32_t bufferCount);
+    void Initialize(uint32_t frameCount, uint32_t threadCount);
+    VkCommandPool CreatePool();
+    VkCommandBuffer AllocateBuffer(VkCommandPool pool, VkCommandBufferLevel level);
 };
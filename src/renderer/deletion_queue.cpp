@@ -0,0 +1,23 @@
+#include "../stdafx.h"
+#include "deletion_queue.hpp"
+
+DeletionQueue::~DeletionQueue() {
+    Flush();
+}
+
+void DeletionQueue::Push(std::function<void()> destroy) {
+    m_Entries.push_back({m_CurrentFrame, std::move(destroy)});
+}
+
+void DeletionQueue::Collect(uint64_t completedFrame) {
+    while (!m_Entries.empty() && m_Entries.front().frame <= completedFrame) {
+        // Popped first so a destroy that pushes more work cannot invalidate it
+        std::function<void()> destroy = std::move(m_Entries.front().destroy);
+        m_Entries.pop_front();
+        destroy();
+    }
+}
+
+void DeletionQueue::Flush() {
+    Collect(UINT64_MAX);
+}
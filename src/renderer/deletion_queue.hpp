@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// Destroys Vulkan objects once the GPU can no longer be using them. Each
+// entry is tagged with the frame number current when it was pushed and runs
+// once the frame timeline reaches it, so a resource can be dropped while
+// frames are in flight instead of after vkDeviceWaitIdle. The FrameTracker
+// advances and collects it. Covers anything used by frame submissions and by
+// presents queued before the next frame; work submitted elsewhere needs its
+// own fence. Main thread only.
+class DeletionQueue {
+public:
+    DeletionQueue() = default;
+    // Runs whatever is left; the device must be idle
+    ~DeletionQueue();
+
+    DeletionQueue(const DeletionQueue&) = delete;
+    DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+    // destroy runs once the current frame has completed
+    void Push(std::function<void()> destroy);
+
+    // Frame number that new entries wait for
+    void SetCurrentFrame(uint64_t frame) { m_CurrentFrame = frame; }
+    // Runs the entries whose frame is at most completedFrame
+    void Collect(uint64_t completedFrame);
+    // Runs every entry; the device must be idle
+    void Flush();
+
+    bool IsEmpty() const { return m_Entries.empty(); }
+    size_t GetPendingCount() const { return m_Entries.size(); }
+
+private:
+    struct Entry {
+        uint64_t frame;
+        std::function<void()> destroy;
+    };
+
+    std::deque<Entry> m_Entries;        // Ordered by frame
+    uint64_t m_CurrentFrame = 1;
+};
@@ -0,0 +1,128 @@
+#include "../stdafx.h"
+#include "descriptor_allocator.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+    // Descriptors of each type per set a pool is sized for. Sets of other
+    // shapes still fit, the pool just runs out of one type sooner.
+    constexpr VkDescriptorPoolSize POOL_RATIOS[] = {
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2},
+        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
+        {VK_DESCRIPTOR_TYPE_SAMPLER, 1},
+    };
+}
+
+DescriptorAllocator::DescriptorAllocator(VulkanContext& context, JobSystem& jobs, uint32_t frameCount,
+                                         uint32_t setsPerPool)
+    : m_Context(context), m_Jobs(jobs), m_SetsPerPool(std::clamp(setsPerPool, 1u, MAX_SETS_PER_POOL))
+{
+    // Pools are only created once a thread first allocates in a slot
+    m_Frames.resize(frameCount);
+    for (auto& threads : m_Frames) {
+        threads = std::vector<ThreadPools>(jobs.GetThreadCount());
+    }
+}
+
+DescriptorAllocator::~DescriptorAllocator() {
+    auto& disp = m_Context.GetDispatchTable();
+    for (auto& threads : m_Frames) {
+        for (auto& thread : threads) {
+            for (VkDescriptorPool pool : thread.pools) {
+                disp.destroyDescriptorPool(pool, nullptr);
+            }
+        }
+    }
+}
+
+VkDescriptorPool DescriptorAllocator::CreatePool(uint32_t maxSets) {
+    VkDescriptorPoolSize sizes[std::size(POOL_RATIOS)];
+    for (size_t i = 0; i < std::size(POOL_RATIOS); i++) {
+        sizes[i] = {POOL_RATIOS[i].type, POOL_RATIOS[i].descriptorCount * maxSets};
+    }
+
+    // No FREE_DESCRIPTOR_SET_BIT: sets only go away with the whole pool
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = maxSets;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(std::size(sizes));
+    poolInfo.pPoolSizes = sizes;
+
+    VkDescriptorPool pool;
+    if (m_Context.GetDispatchTable().createDescriptorPool(&poolInfo, nullptr, &pool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor pool");
+    }
+    return pool;
+}
+
+void DescriptorAllocator::BeginFrame(uint32_t frameIndex) {
+    auto& disp = m_Context.GetDispatchTable();
+
+    m_LastSetCount = 0;
+    for (auto& thread : m_Frames[frameIndex]) {
+        // Pools past current were not touched since the last reset
+        uint32_t used = std::min(thread.current + 1, static_cast<uint32_t>(thread.pools.size()));
+        for (uint32_t i = 0; i < used; i++) {
+            disp.resetDescriptorPool(thread.pools[i], 0);
+        }
+        m_ResetCount += used;
+        m_LastSetCount += thread.setCount;
+        thread.current = 0;
+        thread.setCount = 0;
+    }
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(uint32_t frameIndex, VkDescriptorSetLayout layout) {
+    auto& disp = m_Context.GetDispatchTable();
+    ThreadPools& thread = m_Frames[frameIndex][m_Jobs.GetCurrentThreadIndex()];
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    // Full pools are skipped until the next reset; once every pool is full
+    // a larger one is added, so a thread settles on a few pools that fit
+    // its busiest frame
+    for (;;) {
+        // A set too large for an empty pool may still fit a larger one
+        bool largest = false;
+        if (thread.current == thread.pools.size()) {
+            uint32_t maxSets = m_SetsPerPool;
+            for (size_t i = 0; i < thread.pools.size() && maxSets < MAX_SETS_PER_POOL; i++) {
+                maxSets = std::min(maxSets * 2, MAX_SETS_PER_POOL);
+            }
+            thread.pools.push_back(CreatePool(maxSets));
+            largest = maxSets == MAX_SETS_PER_POOL;
+        }
+
+        allocInfo.descriptorPool = thread.pools[thread.current];
+        VkDescriptorSet set;
+        VkResult result = disp.allocateDescriptorSets(&allocInfo, &set);
+        if (result == VK_SUCCESS) {
+            thread.setCount++;
+            return set;
+        }
+        if ((result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) || largest) {
+            throw std::runtime_error("Failed to allocate descriptor set");
+        }
+        thread.current++;
+    }
+}
+
+DescriptorAllocator::Stats DescriptorAllocator::GetStats() const {
+    Stats stats;
+    for (const auto& threads : m_Frames) {
+        for (const auto& thread : threads) {
+            stats.poolCount += static_cast<uint32_t>(thread.pools.size());
+        }
+    }
+    stats.setCount = m_LastSetCount;
+    stats.resetCount = m_ResetCount;
+    return stats;
+}
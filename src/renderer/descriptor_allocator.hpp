@@ -0,0 +1,61 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include <vector>
+#include "vulkan_context.hpp"
+#include "frame_tracker.hpp"
+#include "../core/job_system.hpp"
+
+// Short-lived descriptor sets for what cannot go through the bindless table:
+// per-pass uniforms, compute bindings. A set lives until its frame slot comes
+// around again. Each frame in flight and each job system thread has its own
+// list of pools, grown on demand, so recorders running in parallel never
+// share a pool or a lock. Sets are never freed one by one: BeginFrame resets
+// every pool of the slot at once.
+class DescriptorAllocator {
+public:
+    static constexpr uint32_t DEFAULT_SETS_PER_POOL = 64;
+    // Each new pool of a thread is twice the size of its last, up to this
+    static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+    struct Stats {
+        uint32_t poolCount = 0;         // Over every frame slot and thread
+        uint32_t setCount = 0;          // Allocated in the last slot reset, before the reset
+        uint64_t resetCount = 0;        // Pools reset, in total
+    };
+
+    DescriptorAllocator(VulkanContext& context, JobSystem& jobs, uint32_t frameCount = DEFAULT_FRAMES_IN_FLIGHT,
+                        uint32_t setsPerPool = DEFAULT_SETS_PER_POOL);
+    ~DescriptorAllocator();
+
+    DescriptorAllocator(const DescriptorAllocator&) = delete;
+    DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+    // Resets the slot's pools. Must only be called once frameIndex's previous
+    // submission has completed, and not while anything allocates.
+    void BeginFrame(uint32_t frameIndex);
+
+    // From any of the job system's threads, between BeginFrame and the
+    // frame's submission. The set is not written.
+    VkDescriptorSet Allocate(uint32_t frameIndex, VkDescriptorSetLayout layout);
+
+    // Main thread, not while anything allocates
+    Stats GetStats() const;
+
+private:
+    // Kept apart so threads allocating side by side do not share cache lines
+    struct alignas(64) ThreadPools {
+        std::vector<VkDescriptorPool> pools;    // In creation order
+        uint32_t current = 0;                   // Pools before it are full
+        uint32_t setCount = 0;                  // Since the last reset
+    };
+
+    VulkanContext& m_Context;
+    JobSystem& m_Jobs;
+    uint32_t m_SetsPerPool;
+    std::vector<std::vector<ThreadPools>> m_Frames;     // [frame][thread]
+    uint32_t m_LastSetCount = 0;
+    uint64_t m_ResetCount = 0;
+
+    VkDescriptorPool CreatePool(uint32_t maxSets);
+};
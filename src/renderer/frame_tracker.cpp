@@ -0,0 +1,192 @@
+#include "../stdafx.h"
+#include "frame_tracker.hpp"
+#include "deletion_queue.hpp"
+#include "../core/profiler.hpp"
+
+#include <algorithm>
+
+FrameTracker::FrameTracker(VulkanContext& context, uint32_t frameCount, uint32_t imageCount)
+    : m_Context(context), m_FrameCount(frameCount)
+{
+    if (frameCount == 0 || frameCount > MAX_FRAMES_IN_FLIGHT) {
+        throw std::runtime_error("Frames in flight must be between 1 and " + std::to_string(MAX_FRAMES_IN_FLIGHT));
+    }
+
+    m_Timeline = MakeSemaphore(VK_SEMAPHORE_TYPE_TIMELINE);
+    m_AcquireSemaphores.resize(frameCount);
+    for (auto& semaphore : m_AcquireSemaphores) {
+        semaphore = MakeSemaphore(VK_SEMAPHORE_TYPE_BINARY);
+    }
+    CreatePresentSemaphores(imageCount);
+}
+
+FrameTracker::~FrameTracker() {
+    auto& disp = m_Context.GetDispatchTable();
+    DestroyPresentSemaphores();
+    for (auto semaphore : m_AcquireSemaphores) {
+        disp.destroySemaphore(semaphore, nullptr);
+    }
+    disp.destroySemaphore(m_Timeline, nullptr);
+}
+
+VkSemaphore FrameTracker::MakeSemaphore(VkSemaphoreType type) {
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = type;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    VkSemaphore semaphore;
+    if (m_Context.GetDispatchTable().createSemaphore(&semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create synchronization objects");
+    }
+    return semaphore;
+}
+
+void FrameTracker::CreatePresentSemaphores(uint32_t imageCount) {
+    // Headless targets never present, but the semaphores are cheap and keep
+    // the indexing uniform
+    m_PresentSemaphores.resize(imageCount);
+    for (auto& semaphore : m_PresentSemaphores) {
+        semaphore = MakeSemaphore(VK_SEMAPHORE_TYPE_BINARY);
+    }
+    m_ImageFrames.assign(imageCount, 0);
+}
+
+void FrameTracker::DestroyPresentSemaphores() {
+    auto& disp = m_Context.GetDispatchTable();
+    for (auto semaphore : m_PresentSemaphores) {
+        disp.destroySemaphore(semaphore, nullptr);
+    }
+    m_PresentSemaphores.clear();
+}
+
+void FrameTracker::OnImageCountChanged(uint32_t imageCount) {
+    // Presents queued on the old swapchain may still be waiting on these
+    auto& disp = m_Context.GetDispatchTable();
+    m_Context.GetDeletionQueue().Push([&disp, semaphores = std::move(m_PresentSemaphores)]() {
+        for (auto semaphore : semaphores) {
+            disp.destroySemaphore(semaphore, nullptr);
+        }
+    });
+    m_PresentSemaphores.clear();
+    CreatePresentSemaphores(imageCount);
+}
+
+uint64_t FrameTracker::GetCompletedFrame() {
+    if (m_Context.GetDispatchTable().getSemaphoreCounterValue(m_Timeline, &m_CompletedFrame) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to read frame timeline");
+    }
+    return m_CompletedFrame;
+}
+
+bool FrameTracker::IsFrameComplete(uint64_t frame) {
+    // The cached value only ever lags, so it can answer yes without a call
+    return frame <= m_CompletedFrame || frame <= GetCompletedFrame();
+}
+
+void FrameTracker::WaitForFrame(uint64_t frame) {
+    if (frame <= m_CompletedFrame) {
+        return;
+    }
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_Timeline;
+    waitInfo.pValues = &frame;
+
+    if (m_Context.GetDispatchTable().waitSemaphores(&waitInfo, UINT64_MAX) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to wait for frame " + std::to_string(frame));
+    }
+    m_CompletedFrame = std::max(m_CompletedFrame, frame);
+}
+
+void FrameTracker::BeginFrame() {
+    if (m_FrameNumber > m_FrameCount) {
+        JB_PROFILE_ZONE("WaitForFrame");
+        WaitForFrame(m_FrameNumber - m_FrameCount);
+    }
+
+    DeletionQueue& deletions = m_Context.GetDeletionQueue();
+    if (!deletions.IsEmpty()) {
+        deletions.Collect(GetCompletedFrame());
+    }
+}
+
+void FrameTracker::BeginImage(uint32_t imageIndex) {
+    if (!IsFrameComplete(m_ImageFrames[imageIndex])) {
+        JB_PROFILE_ZONE("WaitForImage");
+        WaitForFrame(m_ImageFrames[imageIndex]);
+    }
+    m_ImageFrames[imageIndex] = m_FrameNumber;
+}
+
+void FrameTracker::AddWait(VkSemaphore timeline, uint64_t value, VkPipelineStageFlags stages) {
+    for (auto& wait : m_ExtraWaits) {
+        if (wait.semaphore == timeline) {
+            wait.value = std::max(wait.value, value);
+            wait.stages |= stages;
+            return;
+        }
+    }
+    if (m_ExtraWaits.size() == MAX_EXTRA_WAITS) {
+        throw std::runtime_error("Too many timeline waits for one frame");
+    }
+    m_ExtraWaits.push_back({timeline, value, stages});
+}
+
+void FrameTracker::Submit(VkCommandBuffer cmd, uint32_t imageIndex, bool present) {
+    // Binary semaphores ignore their entry in the value arrays
+    VkSemaphore waitSemaphores[1 + MAX_EXTRA_WAITS];
+    VkPipelineStageFlags waitStages[1 + MAX_EXTRA_WAITS];
+    uint64_t waitValues[1 + MAX_EXTRA_WAITS];
+    uint32_t waitCount = 0;
+    if (present) {
+        waitSemaphores[waitCount] = GetAcquireSemaphore();
+        waitStages[waitCount] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        waitValues[waitCount] = 0;
+        waitCount++;
+    }
+    for (const auto& wait : m_ExtraWaits) {
+        waitSemaphores[waitCount] = wait.semaphore;
+        waitStages[waitCount] = wait.stages;
+        waitValues[waitCount] = wait.value;
+        waitCount++;
+    }
+    m_ExtraWaits.clear();
+
+    VkSemaphore signalSemaphores[] = {m_Timeline, m_PresentSemaphores[imageIndex]};
+    uint64_t signalValues[] = {m_FrameNumber, 0};
+    uint32_t signalCount = present ? 2 : 1;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = waitCount;
+    timelineInfo.pWaitSemaphoreValues = waitValues;
+    timelineInfo.signalSemaphoreValueCount = signalCount;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = waitCount;
+    submitInfo.pWaitSemaphores = waitSemaphores;
+    submitInfo.pWaitDstStageMask = waitStages;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cmd;
+    submitInfo.signalSemaphoreCount = signalCount;
+    submitInfo.pSignalSemaphores = signalSemaphores;
+
+    if (m_Context.GetDispatchTable().queueSubmit(m_Context.GetGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit draw command buffer");
+    }
+    m_FrameNumber++;
+
+    // Anything released from here on may have been used by this frame or by
+    // its present, which is queued before the next frame is submitted
+    m_Context.GetDeletionQueue().SetCurrentFrame(m_FrameNumber);
+}
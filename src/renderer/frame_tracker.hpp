@@ -0,0 +1,84 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vector>
+#include "vulkan_context.hpp"
+
+// Upper bound for RendererConfig::framesInFlight, and the default
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+constexpr uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+// Tracks GPU progress with one timeline semaphore on the graphics queue:
+// frame N's submission signals value N, so "is frame N done" is a counter
+// read and waiting for it is a single vkWaitSemaphores. Frames in flight
+// share frameCount slots of per-frame resources, frame N using slot
+// N % frameCount. Binary semaphores remain only for acquire and present,
+// which require them. The tracker also advances and collects the context's
+// DeletionQueue.
+class FrameTracker {
+public:
+    FrameTracker(VulkanContext& context, uint32_t frameCount, uint32_t imageCount);
+    ~FrameTracker();
+
+    FrameTracker(const FrameTracker&) = delete;
+    FrameTracker& operator=(const FrameTracker&) = delete;
+
+    // Waits until the current frame's slot is free, i.e. frame
+    // GetFrameNumber() - frameCount has completed, then runs the deferred
+    // destroys that are now safe
+    void BeginFrame();
+    // Waits for the last frame that rendered to imageIndex, in case more
+    // frames are in flight than the target has images
+    void BeginImage(uint32_t imageIndex);
+    // Submits cmd signalling the timeline with the current frame number (and
+    // the image's present semaphore when presenting), then moves on to the
+    // next frame
+    void Submit(VkCommandBuffer cmd, uint32_t imageIndex, bool present);
+    // Makes the next Submit wait at stages for another queue's timeline
+    // semaphore to reach value. Repeated waits on one semaphore keep the
+    // largest value.
+    void AddWait(VkSemaphore timeline, uint64_t value, VkPipelineStageFlags stages);
+
+    // Frame number the current frame will signal. Starts at 1.
+    uint64_t GetFrameNumber() const { return m_FrameNumber; }
+    uint32_t GetFrameIndex() const { return static_cast<uint32_t>(m_FrameNumber % m_FrameCount); }
+    uint32_t GetFrameCount() const { return m_FrameCount; }
+
+    uint64_t GetCompletedFrame();
+    bool IsFrameComplete(uint64_t frame);
+    void WaitForFrame(uint64_t frame);
+    VkSemaphore GetTimeline() const { return m_Timeline; }
+
+    // Signalled by acquire for the current frame slot
+    VkSemaphore GetAcquireSemaphore() const { return m_AcquireSemaphores[GetFrameIndex()]; }
+    // Signalled by Submit for present; per image, since a present's wait is
+    // only known to be done once that image is acquired again
+    VkSemaphore GetPresentSemaphore(uint32_t imageIndex) const { return m_PresentSemaphores[imageIndex]; }
+
+    // Recreates the present semaphores; the old ones are destroyed through
+    // the deletion queue
+    void OnImageCountChanged(uint32_t imageCount);
+
+private:
+    static constexpr uint32_t MAX_EXTRA_WAITS = 4;
+
+    struct TimelineWait {
+        VkSemaphore semaphore;
+        uint64_t value;
+        VkPipelineStageFlags stages;
+    };
+
+    VulkanContext& m_Context;
+    uint32_t m_FrameCount;
+    uint64_t m_FrameNumber = 1;
+    uint64_t m_CompletedFrame = 0;          // Last value read from the timeline
+
+    VkSemaphore m_Timeline = VK_NULL_HANDLE;
+    std::vector<VkSemaphore> m_AcquireSemaphores;
+    std::vector<VkSemaphore> m_PresentSemaphores;
+    std::vector<uint64_t> m_ImageFrames;    // Last frame that rendered to each image
+    std::vector<TimelineWait> m_ExtraWaits; // For the next Submit
+
+    VkSemaphore MakeSemaphore(VkSemaphoreType type);
+    void CreatePresentSemaphores(uint32_t imageCount);
+    void DestroyPresentSemaphores();
+};
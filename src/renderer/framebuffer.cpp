@@ -1,8 +1,9 @@
 #include "../stdafx.h"
 #include "framebuffer.hpp"
+#include "deletion_queue.hpp"
 
-Framebuffer::Framebuffer(VulkanContext& context, SwapChain& swapchain, RenderPass& renderPass)
-    : m_Context(context), m_Swapchain(swapchain), m_RenderPass(renderPass)
+Framebuffer::Framebuffer(VulkanContext& context, RenderTarget& target, RenderPass& renderPass)
+    : m_Context(context), m_Target(target), m_RenderPass(renderPass)
 {
     Initialize();
 }
@@ -19,7 +20,13 @@ void Framebuffer::Cleanup() {
 }
 
 void Framebuffer::Initialize() {
-    auto& imageViews = m_Swapchain.GetImageViews();
+    // Dynamic rendering attaches the image views directly
+    m_Framebuffers.clear();
+    if (m_RenderPass.IsDynamic()) {
+        return;
+    }
+
+    auto& imageViews = m_Target.GetImageViews();
     m_Framebuffers.resize(imageViews.size());
 
     for (size_t i = 0; i < imageViews.size(); i++) {
@@ -30,8 +37,8 @@ void Framebuffer::Initialize() {
         framebufferInfo.renderPass = m_RenderPass.GetHandle();
         framebufferInfo.attachmentCount = 1;
         framebufferInfo.pAttachments = attachments;
-        framebufferInfo.width = m_Swapchain.GetExtent().width;
-        framebufferInfo.height = m_Swapchain.GetExtent().height;
+        framebufferInfo.width = m_Target.GetExtent().width;
+        framebufferInfo.height = m_Target.GetExtent().height;
         framebufferInfo.layers = 1;
 
         if (m_Context.GetDispatchTable().createFramebuffer(&framebufferInfo, nullptr, &m_Framebuffers[i]) != VK_SUCCESS) {
@@ -41,6 +48,12 @@ void Framebuffer::Initialize() {
 }
 
 void Framebuffer::Recreate() {
-    Cleanup();
+    // Frames in flight may still be rendering through the old ones
+    auto& disp = m_Context.GetDispatchTable();
+    m_Context.GetDeletionQueue().Push([&disp, framebuffers = std::move(m_Framebuffers)]() {
+        for (auto framebuffer : framebuffers) {
+            disp.destroyFramebuffer(framebuffer, nullptr);
+        }
+    });
     Initialize();
 }
\ No newline at end of file
@@ -2,12 +2,13 @@
 #include <vulkan/vulkan_core.h>
 #include <vector>
 #include "vulkan_context.hpp"
-#include "swap_chain.hpp"
+#include "render_target.hpp"
 #include "render_pass.hpp"
 
+// One VkFramebuffer per target image. Empty when the render pass is dynamic.
 class Framebuffer {
 public:
-    Framebuffer(VulkanContext& context, SwapChain& swapchain, RenderPass& renderPass);
+    Framebuffer(VulkanContext& context, RenderTarget& target, RenderPass& renderPass);
     ~Framebuffer();
 
     void Recreate();
@@ -15,7 +16,7 @@ public:
 
 private:
     VulkanContext& m_Context;
-    SwapChain& m_Swapchain;
+    RenderTarget& m_Target;
     RenderPass& m_RenderPass;
     std::vector<VkFramebuffer> m_Framebuffers;
 
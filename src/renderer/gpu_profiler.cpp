@@ -0,0 +1,146 @@
+#include "../stdafx.h"
+#include "gpu_profiler.hpp"
+#include "../core/profiler.hpp"
+
+GpuProfiler::GpuProfiler(VulkanContext& context, uint32_t slotCount, uint32_t queueFamily, ProfileTrack track,
+                         const GpuProfiler* anchor)
+    : m_Context(context), m_Track(track), m_Anchor(anchor)
+{
+    const auto& device = m_Context.GetDevice();
+    const auto& limits = device.physical_device.properties.limits;
+    if (queueFamily == UINT32_MAX) {
+        queueFamily = m_Context.GetGraphicsQueueIndex();
+    }
+    uint32_t validBits = device.queue_families[queueFamily].timestampValidBits;
+
+    m_Supported = limits.timestampComputeAndGraphics == VK_TRUE && validBits != 0;
+    if (!m_Supported) {
+        return;
+    }
+
+    m_TimestampPeriod = static_cast<double>(limits.timestampPeriod);
+    m_TimestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+    m_Results.resize(MAX_QUERIES_PER_SLOT);
+    m_Slots.resize(slotCount);
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = MAX_QUERIES_PER_SLOT;
+
+    for (auto& slot : m_Slots) {
+        if (m_Context.GetDispatchTable().createQueryPool(&poolInfo, nullptr, &slot.pool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create timestamp query pool");
+        }
+    }
+}
+
+GpuProfiler::~GpuProfiler() {
+    auto& disp = m_Context.GetDispatchTable();
+    for (auto& slot : m_Slots) {
+        disp.destroyQueryPool(slot.pool, nullptr);
+    }
+}
+
+void GpuProfiler::BeginRecording(VkCommandBuffer cmd, uint32_t slot) {
+    if (!m_Supported) {
+        return;
+    }
+
+    auto& s = m_Slots[slot];
+    s.zones.clear();
+    s.queryCount = 0;
+    s.pending = false;
+    m_Context.GetDispatchTable().cmdResetQueryPool(cmd, s.pool, 0, MAX_QUERIES_PER_SLOT);
+}
+
+uint32_t GpuProfiler::BeginZone(VkCommandBuffer cmd, uint32_t slot, const char* name, VkPipelineStageFlagBits stage) {
+    if (!m_Supported) {
+        return 0;
+    }
+
+    auto& s = m_Slots[slot];
+    if (s.queryCount + 2 > MAX_QUERIES_PER_SLOT) {
+        throw std::runtime_error("Too many GPU profiler zones in one command buffer");
+    }
+
+    Zone zone{name, s.queryCount, s.queryCount + 1};
+    s.queryCount += 2;
+    m_Context.GetDispatchTable().cmdWriteTimestamp(cmd, stage, s.pool, zone.beginQuery);
+    s.zones.push_back(zone);
+    return static_cast<uint32_t>(s.zones.size() - 1);
+}
+
+void GpuProfiler::EndZone(VkCommandBuffer cmd, uint32_t slot, uint32_t zone, VkPipelineStageFlagBits stage) {
+    if (!m_Supported) {
+        return;
+    }
+
+    auto& s = m_Slots[slot];
+    m_Context.GetDispatchTable().cmdWriteTimestamp(cmd, stage, s.pool, s.zones[zone].endQuery);
+}
+
+void GpuProfiler::OnSubmit(uint32_t slot, uint64_t frame) {
+    if (!m_Supported) {
+        return;
+    }
+
+    auto& s = m_Slots[slot];
+    s.pending = s.queryCount > 0;
+    s.submitNs = Profiler::NowNs();
+    s.frame = frame;
+}
+
+void GpuProfiler::Resolve(uint32_t slot) {
+    if (!m_Supported) {
+        return;
+    }
+
+    auto& s = m_Slots[slot];
+    if (!s.pending) {
+        return;
+    }
+    s.pending = false;
+
+    auto& profiler = Profiler::Get();
+    if (!profiler.IsEnabled()) {
+        return;
+    }
+
+    // No WAIT bit: the caller guarantees completion, and NOT_READY just drops the frame
+    VkResult result = m_Context.GetDispatchTable().getQueryPoolResults(
+        s.pool, 0, s.queryCount,
+        s.queryCount * sizeof(uint64_t), m_Results.data(), sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) {
+        return;
+    }
+
+    // GPU ticks live in their own clock domain; anchor the first timestamp
+    // to the CPU submit time so GPU zones line up with the CPU timeline.
+    // Queues of one device share the timestamp clock, so a second queue
+    // reuses its anchor's mapping when the anchor resolved the same frame.
+    s.baseTicks = m_Results[0] & m_TimestampMask;
+    s.baseNs = s.submitNs;
+    if (m_Anchor && m_Anchor->m_Supported && m_Anchor->m_Slots[slot].baseFrame == s.frame) {
+        s.baseTicks = m_Anchor->m_Slots[slot].baseTicks;
+        s.baseNs = m_Anchor->m_Slots[slot].baseNs;
+    }
+    s.baseFrame = s.frame;
+
+    // Signed: work on another queue can start before the anchor's first timestamp
+    auto toNs = [&](uint32_t query) {
+        int64_t ticks = static_cast<int64_t>(m_Results[query] & m_TimestampMask) - static_cast<int64_t>(s.baseTicks);
+        return static_cast<uint64_t>(static_cast<int64_t>(s.baseNs) +
+                                     static_cast<int64_t>(static_cast<double>(ticks) * m_TimestampPeriod));
+    };
+    for (const auto& zone : s.zones) {
+        ProfileEvent event;
+        event.name = zone.name;
+        event.startNs = toNs(zone.beginQuery);
+        event.endNs = toNs(zone.endQuery);
+        event.frame = s.frame;
+        event.track = m_Track;
+        profiler.Record(event);
+    }
+}
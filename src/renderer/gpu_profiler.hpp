@@ -0,0 +1,67 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vector>
+#include "vulkan_context.hpp"
+#include "../core/profiler.hpp"
+
+// Timestamp queries around passes. Each command buffer slot owns its own
+// query pool; results are read back without waiting once the slot's frame
+// has completed, so they arrive a few frames late but never stall the queue.
+//
+// One profiler covers one queue family. A profiler for a second queue can
+// take the first as its anchor: its frames are then placed on the CPU
+// timeline with the anchor's mapping for the same frame, so zones on the two
+// queues keep their real offsets and overlap shows up as overlap.
+class GpuProfiler {
+public:
+    static constexpr uint32_t MAX_QUERIES_PER_SLOT = 64;
+
+    // queueFamily defaults to the graphics family. An anchor must resolve
+    // each slot before this profiler does.
+    GpuProfiler(VulkanContext& context, uint32_t slotCount, uint32_t queueFamily = UINT32_MAX,
+                ProfileTrack track = ProfileTrack::Gpu, const GpuProfiler* anchor = nullptr);
+    ~GpuProfiler();
+
+    bool IsSupported() const { return m_Supported; }
+
+    // Recording. BeginRecording resets the slot's pool from inside cmd, so a
+    // pre-recorded command buffer can be resubmitted as-is.
+    void BeginRecording(VkCommandBuffer cmd, uint32_t slot);
+    uint32_t BeginZone(VkCommandBuffer cmd, uint32_t slot, const char* name,
+                       VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+    void EndZone(VkCommandBuffer cmd, uint32_t slot, uint32_t zone,
+                 VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+    // Submission. Resolve must only be called once the slot's previous
+    // submission is known complete (FrameTracker::BeginFrame has waited on it).
+    void OnSubmit(uint32_t slot, uint64_t frame);
+    void Resolve(uint32_t slot);
+
+private:
+    struct Zone {
+        const char* name;
+        uint32_t beginQuery;
+        uint32_t endQuery;
+    };
+
+    struct Slot {
+        VkQueryPool pool = VK_NULL_HANDLE;
+        std::vector<Zone> zones;
+        uint32_t queryCount = 0;
+        bool pending = false;
+        uint64_t submitNs = 0;
+        uint64_t frame = 0;
+        uint64_t baseTicks = 0;         // Mapped to baseNs by the last Resolve, of baseFrame
+        uint64_t baseNs = 0;
+        uint64_t baseFrame = UINT64_MAX;
+    };
+
+    VulkanContext& m_Context;
+    ProfileTrack m_Track;
+    const GpuProfiler* m_Anchor;
+    std::vector<Slot> m_Slots;
+    std::vector<uint64_t> m_Results;
+    bool m_Supported = false;
+    double m_TimestampPeriod = 1.0;
+    uint64_t m_TimestampMask = ~0ull;
+};
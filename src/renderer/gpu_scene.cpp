@@ -0,0 +1,409 @@
+#include "../stdafx.h"
+#include "gpu_scene.hpp"
+#include "pipeline_cache.hpp"
+#include "shader_module.hpp"
+#include "vertex.hpp"
+
+#include <algorithm>
+
+// Defined by CMake (compile_optional_shaders) when the SPIR-V is available
+#ifdef JB_GPU_DRIVEN
+#include "shaders/gpu_cull_comp_spv.h"
+#include "shaders/gpu_driven_vert_spv.h"
+#include "shaders/triangle_frag_spv.h"
+#endif
+
+namespace {
+    constexpr uint32_t CULL_GROUP_SIZE = 64;        // local_size_x in gpu_cull.comp
+
+    // Push constants of gpu_cull.comp
+    struct CullParams {
+        glm::vec4 planes[Frustum::PLANE_COUNT];
+        uint32_t objectCount;
+    };
+}
+
+bool GpuScene::IsSupported(const VulkanContext& context) {
+#ifdef JB_GPU_DRIVEN
+    const VkPhysicalDeviceFeatures& features = context.GetEnabledFeatures();
+    return features.multiDrawIndirect && features.drawIndirectFirstInstance;
+#else
+    (void)context;
+    return false;
+#endif
+}
+
+GpuScene::GpuScene(VulkanContext& context, StagingRing& staging, DescriptorAllocator& descriptors,
+                   RenderPass& renderPass, RenderTarget& target, VkDescriptorSetLayout cameraSetLayout,
+                   uint32_t maxObjects, uint32_t frameCount)
+    : m_Context(context), m_Staging(staging), m_Descriptors(descriptors)
+{
+    if (!IsSupported(context)) {
+        throw std::runtime_error("Failed to create GPU scene: GPU-driven rendering is not supported");
+    }
+
+    // A single indirect call may draw every object of one mesh
+    m_MaxObjects = std::min(maxObjects, context.GetDevice().physical_device.properties.limits.maxDrawIndirectCount);
+    m_HasDrawCount = context.IsExtensionEnabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+    // Objects and batches are updated in place and read on both queues when
+    // culling runs async, so they are shared rather than handed back and forth
+    std::vector<uint32_t> families{context.GetGraphicsQueueIndex()};
+    if (context.HasAsyncCompute()) {
+        families.push_back(context.GetComputeQueueIndex());
+    }
+
+    auto& allocator = m_Context.GetAllocator();
+    m_ObjectBuffer = allocator.CreateBuffer(m_MaxObjects * sizeof(GpuObject),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        0, families);
+    m_BatchBuffer = allocator.CreateBuffer(MAX_MESHES * sizeof(GpuBatch),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        0, families);
+
+    // Commands and counts are written by the GPU every frame, so each frame
+    // in flight gets its own
+    m_Frames.resize(frameCount);
+    for (auto& frame : m_Frames) {
+        frame.commands = allocator.CreateBuffer(m_MaxObjects * sizeof(VkDrawIndexedIndirectCommand),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        frame.counts = allocator.CreateBuffer(MAX_MESHES * sizeof(uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+
+    CreateDescriptors();
+    CreateCullPipeline();
+
+#ifdef JB_GPU_DRIVEN
+    ShaderStages shaders{gpu_driven_vert_spv, "gpu_driven.vert", triangle_frag_spv, "triangle.frag"};
+    m_DrawPipeline = std::make_unique<Pipeline>(m_Context, renderPass, target, shaders, Vertex::GetLayout(),
+                                                std::vector<VkDescriptorSetLayout>{cameraSetLayout, m_DrawSetLayout});
+#endif
+
+    m_Objects.reserve(m_MaxObjects);
+}
+
+GpuScene::~GpuScene() {
+    auto& disp = m_Context.GetDispatchTable();
+    m_DrawPipeline.reset();
+    disp.destroyPipeline(m_CullPipeline, nullptr);
+    disp.destroyPipelineLayout(m_CullLayout, nullptr);
+    disp.destroyDescriptorPool(m_DescriptorPool, nullptr);
+    disp.destroyDescriptorSetLayout(m_DrawSetLayout, nullptr);
+    disp.destroyDescriptorSetLayout(m_CullSetLayout, nullptr);
+
+    auto& allocator = m_Context.GetAllocator();
+    for (auto& frame : m_Frames) {
+        allocator.DestroyBuffer(frame.counts);
+        allocator.DestroyBuffer(frame.commands);
+    }
+    allocator.DestroyBuffer(m_BatchBuffer);
+    allocator.DestroyBuffer(m_ObjectBuffer);
+}
+
+void GpuScene::CreateDescriptors() {
+    auto& disp = m_Context.GetDispatchTable();
+
+    // Culling: objects, batches, commands, counts
+    VkDescriptorSetLayoutBinding cullBindings[4]{};
+    for (uint32_t i = 0; i < 4; i++) {
+        cullBindings[i].binding = i;
+        cullBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        cullBindings[i].descriptorCount = 1;
+        cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 4;
+    layoutInfo.pBindings = cullBindings;
+
+    if (disp.createDescriptorSetLayout(&layoutInfo, nullptr, &m_CullSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create culling descriptor set layout");
+    }
+
+    // Drawing: objects only, read by gpu_driven.vert as set 1
+    VkDescriptorSetLayoutBinding drawBinding{};
+    drawBinding.binding = 0;
+    drawBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    drawBinding.descriptorCount = 1;
+    drawBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &drawBinding;
+
+    if (disp.createDescriptorSetLayout(&layoutInfo, nullptr, &m_DrawSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create GPU scene descriptor set layout");
+    }
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = 1;
+
+    // Culling sets come from the frame's DescriptorAllocator pools instead
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    if (disp.createDescriptorPool(&poolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create GPU scene descriptor pool");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_DrawSetLayout;
+
+    if (disp.allocateDescriptorSets(&allocInfo, &m_DrawSet) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate GPU scene descriptor set");
+    }
+
+    // Written once: the buffers never change, only their contents
+    VkDescriptorBufferInfo objectInfo{m_ObjectBuffer.buffer, 0, VK_WHOLE_SIZE};
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_DrawSet;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &objectInfo;
+    disp.updateDescriptorSets(1, &write, 0, nullptr);
+}
+
+void GpuScene::CreateCullPipeline() {
+    auto& disp = m_Context.GetDispatchTable();
+
+    VkPushConstantRange pushRange{};
+    pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushRange.offset = 0;
+    pushRange.size = sizeof(CullParams);
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &m_CullSetLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushRange;
+
+    if (disp.createPipelineLayout(&layoutInfo, nullptr, &m_CullLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create culling pipeline layout");
+    }
+
+#ifdef JB_GPU_DRIVEN
+    ShaderModule cullShader(m_Context, gpu_cull_comp_spv, "gpu_cull.comp");
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = cullShader.GetHandle();
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_CullLayout;
+
+    if (m_Context.GetPipelineCache().CreateComputePipeline(pipelineInfo, &m_CullPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create culling pipeline");
+    }
+#endif
+}
+
+GpuScene::ObjectId GpuScene::AddObject(const Mesh& mesh, const glm::mat4& model) {
+    if (GetObjectCount() >= m_MaxObjects) {
+        throw std::runtime_error("GPU scene is full");
+    }
+
+    auto it = m_BatchLookup.find(&mesh);
+    if (it == m_BatchLookup.end()) {
+        if (GetMeshCount() >= MAX_MESHES) {
+            throw std::runtime_error("GPU scene has too many meshes");
+        }
+        it = m_BatchLookup.emplace(&mesh, GetMeshCount()).first;
+        m_Batches.push_back({&mesh, 0, 0});
+    }
+    uint32_t batch = it->second;
+    m_Batches[batch].objectCount++;
+    m_BatchesDirty = true;
+
+    GpuObject object{};
+    object.model = model;
+    object.sphere = glm::vec4(mesh.GetBoundsCenter(), mesh.GetBoundsRadius());
+    object.batch = batch;
+    m_Objects.push_back(object);
+    m_Dirty.push_back(0);
+    return GetObjectCount() - 1;
+}
+
+void GpuScene::SetTransform(ObjectId id, const glm::mat4& model) {
+    m_Objects[id].model = model;
+    // Objects that were never uploaded go out with the next bulk copy
+    if (id < m_UploadedCount && !m_Dirty[id]) {
+        m_Dirty[id] = 1;
+        m_DirtyList.push_back(id);
+    }
+}
+
+void GpuScene::Clear() {
+    m_Objects.clear();
+    m_UploadedCount = 0;
+    m_Dirty.clear();
+    m_DirtyList.clear();
+    m_Batches.clear();
+    m_BatchLookup.clear();
+    m_BatchesDirty = false;
+}
+
+void GpuScene::Upload() {
+    if (m_BatchesDirty) {
+        // Each mesh's command range is sized for all of its objects
+        std::vector<GpuBatch> batches(m_Batches.size());
+        uint32_t commandOffset = 0;
+        for (size_t i = 0; i < m_Batches.size(); i++) {
+            Batch& batch = m_Batches[i];
+            batch.commandOffset = commandOffset;
+            batches[i] = {batch.mesh->GetIndexCount(), 0, 0, commandOffset};
+            commandOffset += batch.objectCount;
+        }
+        m_Staging.Upload(m_BatchBuffer.buffer, 0, batches.data(), batches.size() * sizeof(GpuBatch));
+        m_BatchesDirty = false;
+    }
+
+    // Moved objects, one copy per run of consecutive ids
+    std::sort(m_DirtyList.begin(), m_DirtyList.end());
+    for (size_t i = 0; i < m_DirtyList.size();) {
+        size_t j = i + 1;
+        while (j < m_DirtyList.size() && m_DirtyList[j] == m_DirtyList[j - 1] + 1) {
+            j++;
+        }
+        ObjectId first = m_DirtyList[i];
+        uint32_t count = static_cast<uint32_t>(j - i);
+        m_Staging.Upload(m_ObjectBuffer.buffer, first * sizeof(GpuObject), &m_Objects[first], count * sizeof(GpuObject));
+        i = j;
+    }
+    for (ObjectId id : m_DirtyList) {
+        m_Dirty[id] = 0;
+    }
+    m_DirtyList.clear();
+
+    uint32_t count = GetObjectCount();
+    if (m_UploadedCount < count) {
+        m_Staging.Upload(m_ObjectBuffer.buffer, m_UploadedCount * sizeof(GpuObject), &m_Objects[m_UploadedCount],
+                         (count - m_UploadedCount) * sizeof(GpuObject));
+        m_UploadedCount = count;
+    }
+}
+
+void GpuScene::RecordCull(VkCommandBuffer cmd, uint32_t frameIndex, const Frustum& frustum) {
+    uint32_t objectCount = GetObjectCount();
+    if (objectCount == 0) {
+        return;
+    }
+
+    auto& disp = m_Context.GetDispatchTable();
+    FrameResources& frame = m_Frames[frameIndex];
+
+    // The frame slot's previous use of these buffers completed before the
+    // slot was reused, so they can be cleared without a barrier (or, on the
+    // compute queue, without taking them back: the contents are discarded)
+    disp.cmdFillBuffer(cmd, frame.counts.buffer, 0, GetMeshCount() * sizeof(uint32_t), 0);
+    if (!m_HasDrawCount) {
+        // Slots left untouched by the shader become zero-instance draws
+        disp.cmdFillBuffer(cmd, frame.commands.buffer, 0, objectCount * sizeof(VkDrawIndexedIndirectCommand), 0);
+    }
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    disp.cmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                            0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    CullParams params{};
+    std::copy(std::begin(frustum.planes), std::end(frustum.planes), params.planes);
+    params.objectCount = objectCount;
+
+    // A fresh set each frame, released with the rest of the slot's pools
+    VkDescriptorSet cullSet = m_Descriptors.Allocate(frameIndex, m_CullSetLayout);
+    VkDescriptorBufferInfo bufferInfos[4] = {
+        {m_ObjectBuffer.buffer, 0, VK_WHOLE_SIZE},
+        {m_BatchBuffer.buffer, 0, VK_WHOLE_SIZE},
+        {frame.commands.buffer, 0, VK_WHOLE_SIZE},
+        {frame.counts.buffer, 0, VK_WHOLE_SIZE},
+    };
+
+    VkWriteDescriptorSet writes[4]{};
+    for (uint32_t i = 0; i < 4; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = cullSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    disp.updateDescriptorSets(4, writes, 0, nullptr);
+
+    disp.cmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipeline);
+    disp.cmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullLayout, 0, 1, &cullSet, 0, nullptr);
+    disp.cmdPushConstants(cmd, m_CullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullParams), &params);
+    disp.cmdDispatch(cmd, (objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+}
+
+void GpuScene::RecordRelease(VkCommandBuffer cmd, uint32_t frameIndex, const AsyncCompute& compute) {
+    FrameResources& frame = m_Frames[frameIndex];
+    compute.ReleaseBuffer(cmd, frame.commands.buffer, AsyncCompute::Transfer::ToGraphics,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+    compute.ReleaseBuffer(cmd, frame.counts.buffer, AsyncCompute::Transfer::ToGraphics,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+}
+
+void GpuScene::RecordAcquire(VkCommandBuffer cmd, uint32_t frameIndex, const AsyncCompute& compute) {
+    FrameResources& frame = m_Frames[frameIndex];
+    compute.AcquireBuffer(cmd, frame.commands.buffer, AsyncCompute::Transfer::ToGraphics,
+                          CONSUMER_STAGES, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    compute.AcquireBuffer(cmd, frame.counts.buffer, AsyncCompute::Transfer::ToGraphics,
+                          CONSUMER_STAGES, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+}
+
+void GpuScene::RecordDraws(VkCommandBuffer cmd, uint32_t frameIndex, VkDescriptorSet cameraSet, uint32_t cameraOffset) {
+    if (GetObjectCount() == 0) {
+        return;
+    }
+
+    auto& disp = m_Context.GetDispatchTable();
+    FrameResources& frame = m_Frames[frameIndex];
+
+    disp.cmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_DrawPipeline->GetHandle());
+
+    // The per-object uniform binding of set 0 is unused here
+    VkDescriptorSet sets[] = {cameraSet, m_DrawSet};
+    uint32_t dynamicOffsets[] = {cameraOffset, 0};
+    disp.cmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_DrawPipeline->GetLayout(), 0, 2, sets,
+                               2, dynamicOffsets);
+
+    constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    for (uint32_t i = 0; i < GetMeshCount(); i++) {
+        const Batch& batch = m_Batches[i];
+        if (batch.objectCount == 0) {
+            continue;
+        }
+
+        VkBuffer vertexBuffers[] = {batch.mesh->GetVertexBuffer()};
+        VkDeviceSize offsets[] = {0};
+        disp.cmdBindVertexBuffers(cmd, 0, 1, vertexBuffers, offsets);
+        disp.cmdBindIndexBuffer(cmd, batch.mesh->GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+        VkDeviceSize commandOffset = static_cast<VkDeviceSize>(batch.commandOffset) * stride;
+        if (m_HasDrawCount) {
+            disp.cmdDrawIndexedIndirectCountKHR(cmd, frame.commands.buffer, commandOffset, frame.counts.buffer,
+                                                i * sizeof(uint32_t), batch.objectCount, stride);
+        } else {
+            disp.cmdDrawIndexedIndirect(cmd, frame.commands.buffer, commandOffset, batch.objectCount, stride);
+        }
+    }
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "vulkan_context.hpp"
+#include "memory_allocator.hpp"
+#include "staging_ring.hpp"
+#include "render_pass.hpp"
+#include "render_target.hpp"
+#include "pipeline.hpp"
+#include "mesh.hpp"
+#include "frame_tracker.hpp"
+#include "async_compute.hpp"
+#include "descriptor_allocator.hpp"
+#include "../scene/frustum_culler.hpp"
+
+// Objects that stay on the GPU from frame to frame. Transforms and bounds
+// live in a storage buffer that is only written where objects were added or
+// moved. Each frame a compute pass (gpu_cull.comp) tests every object's
+// sphere against the frustum and appends a draw for each survivor to its
+// mesh's range of an indirect buffer; the render pass then issues one
+// indirect draw per mesh. The CPU cost depends on the number of meshes, not
+// on the number of objects.
+//
+// The cull can run on the async compute queue: the object and batch buffers
+// are then shared by both families, and each frame's commands and counts
+// change owner from compute to graphics (RecordRelease/RecordAcquire).
+class GpuScene {
+public:
+    using ObjectId = uint32_t;
+
+    static constexpr uint32_t DEFAULT_MAX_OBJECTS = 1u << 18;
+    static constexpr uint32_t MAX_MESHES = 256;
+
+    // Needs multiDrawIndirect, drawIndirectFirstInstance and a build with
+    // the gpu_cull.comp and gpu_driven.vert SPIR-V
+    static bool IsSupported(const VulkanContext& context);
+
+    // Culling sets are allocated from descriptors each frame
+    GpuScene(VulkanContext& context, StagingRing& staging, DescriptorAllocator& descriptors, RenderPass& renderPass,
+             RenderTarget& target, VkDescriptorSetLayout cameraSetLayout, uint32_t maxObjects = DEFAULT_MAX_OBJECTS,
+             uint32_t frameCount = DEFAULT_FRAMES_IN_FLIGHT);
+    ~GpuScene();
+
+    GpuScene(const GpuScene&) = delete;
+    GpuScene& operator=(const GpuScene&) = delete;
+
+    // The mesh must outlive the scene (or the next Clear). Throws when the
+    // scene is full.
+    ObjectId AddObject(const Mesh& mesh, const glm::mat4& model);
+    void SetTransform(ObjectId id, const glm::mat4& model);
+    void Clear();
+
+    uint32_t GetObjectCount() const { return static_cast<uint32_t>(m_Objects.size()); }
+    uint32_t GetMeshCount() const { return static_cast<uint32_t>(m_Batches.size()); }
+    // Without VK_KHR_draw_indirect_count every command slot is drawn, and
+    // culled objects are left as zero-instance draws
+    bool HasDrawCount() const { return m_HasDrawCount; }
+    // Written by RecordCull and read by RecordDraws for frameIndex
+    VkBuffer GetCommandBuffer(uint32_t frameIndex) const { return m_Frames[frameIndex].commands.buffer; }
+    VkBuffer GetCountBuffer(uint32_t frameIndex) const { return m_Frames[frameIndex].counts.buffer; }
+
+    // Queues new and moved objects on the staging ring. Call once per frame
+    // before recording, so the copies go out in the ring's next Flush.
+    void Upload();
+    // Outside a render pass: clears the frame's draw counts and dispatches
+    // the culling shader. The caller (the render graph) makes the results
+    // visible to indirect draws.
+    void RecordCull(VkCommandBuffer cmd, uint32_t frameIndex, const Frustum& frustum);
+    // Async culling: RecordRelease follows RecordCull on the compute queue;
+    // RecordAcquire goes into the graphics command buffer, whose submission
+    // waits on the compute one at DRAW_INDIRECT, and makes the results
+    // visible to indirect draws
+    void RecordRelease(VkCommandBuffer cmd, uint32_t frameIndex, const AsyncCompute& compute);
+    void RecordAcquire(VkCommandBuffer cmd, uint32_t frameIndex, const AsyncCompute& compute);
+    // Waited on by the graphics submission after async culling
+    static constexpr VkPipelineStageFlags CONSUMER_STAGES = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+    // Inside the render pass, with viewport and scissor already set.
+    // cameraSet is the UniformRing set, bound at cameraOffset.
+    void RecordDraws(VkCommandBuffer cmd, uint32_t frameIndex, VkDescriptorSet cameraSet, uint32_t cameraOffset);
+
+private:
+    // Mirrors Object in gpu_cull.comp and gpu_driven.vert (std430)
+    struct GpuObject {
+        glm::mat4 model;
+        glm::vec4 sphere;               // Object-space center, radius
+        uint32_t batch;
+        uint32_t pad[3];
+    };
+    static_assert(sizeof(GpuObject) == 96, "GpuObject must match the std430 layout");
+
+    // Mirrors Batch in gpu_cull.comp
+    struct GpuBatch {
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        uint32_t commandOffset;
+    };
+
+    // One per mesh. Its objects' draws go to commands
+    // [commandOffset, commandOffset + objectCount) of the indirect buffer.
+    struct Batch {
+        const Mesh* mesh;
+        uint32_t objectCount;
+        uint32_t commandOffset;
+    };
+
+    struct FrameResources {
+        AllocatedBuffer commands;
+        AllocatedBuffer counts;         // One draw count per batch
+    };
+
+    VulkanContext& m_Context;
+    StagingRing& m_Staging;
+    DescriptorAllocator& m_Descriptors;
+    uint32_t m_MaxObjects;
+    bool m_HasDrawCount = false;
+
+    AllocatedBuffer m_ObjectBuffer;
+    AllocatedBuffer m_BatchBuffer;
+    std::vector<FrameResources> m_Frames;
+
+    VkDescriptorSetLayout m_CullSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_DrawSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_DrawSet = VK_NULL_HANDLE;
+    VkPipelineLayout m_CullLayout = VK_NULL_HANDLE;
+    VkPipeline m_CullPipeline = VK_NULL_HANDLE;
+    std::unique_ptr<Pipeline> m_DrawPipeline;
+
+    // CPU copy of the object buffer; [m_UploadedCount, size) has never been
+    // uploaded, and m_DirtyList holds moved objects below that
+    std::vector<GpuObject> m_Objects;
+    uint32_t m_UploadedCount = 0;
+    std::vector<uint8_t> m_Dirty;
+    std::vector<ObjectId> m_DirtyList;
+
+    std::vector<Batch> m_Batches;
+    std::unordered_map<const Mesh*, uint32_t> m_BatchLookup;
+    bool m_BatchesDirty = false;
+
+    void CreateDescriptors();
+    void CreateCullPipeline();
+};
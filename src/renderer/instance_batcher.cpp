@@ -0,0 +1,158 @@
+#include "../stdafx.h"
+#include "instance_batcher.hpp"
+
+// Defined by CMake (compile_optional_shaders) when the SPIR-V is available
+#ifdef JB_INSTANCING
+#include "shaders/instanced_vert_spv.h"
+#include "shaders/triangle_frag_spv.h"
+#endif
+#ifdef JB_BINDLESS
+#include "shaders/bindless_frag_spv.h"
+#endif
+
+namespace {
+    // Instances written per job in Build
+    constexpr uint32_t WRITE_BATCH_SIZE = 4096;
+}
+
+VertexLayout InstanceData::GetLayout() {
+    VertexLayout layout = Vertex::GetLayout();
+    layout.bindings.push_back({1, sizeof(InstanceData), VK_VERTEX_INPUT_RATE_INSTANCE});
+    // A mat4 attribute takes one location per column
+    for (uint32_t column = 0; column < 4; column++) {
+        layout.attributes.push_back({2 + column, 1, VK_FORMAT_R32G32B32A32_SFLOAT,
+                                     static_cast<uint32_t>(offsetof(InstanceData, model) + column * sizeof(glm::vec4))});
+    }
+    layout.attributes.push_back({6, 1, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, color)});
+    layout.attributes.push_back({7, 1, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, custom)});
+    layout.attributes.push_back({8, 1, VK_FORMAT_R32_UINT, offsetof(InstanceData, texture)});
+    return layout;
+}
+
+bool InstanceBatcher::IsSupported() {
+#ifdef JB_INSTANCING
+    return true;
+#else
+    return false;
+#endif
+}
+
+InstanceBatcher::InstanceBatcher(VulkanContext& context, RenderPass& renderPass, RenderTarget& target,
+                                 VkDescriptorSetLayout cameraSetLayout, const BindlessTable* bindless,
+                                 VkDeviceSize capacityPerFrame, uint32_t frameCount)
+    : m_Context(context),
+      m_Bindless(bindless),
+      m_Arena(context.GetAllocator(), capacityPerFrame, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, frameCount)
+{
+#ifdef JB_INSTANCING
+    ShaderStages shaders{instanced_vert_spv, "instanced.vert", triangle_frag_spv, "triangle.frag"};
+    std::vector<VkDescriptorSetLayout> setLayouts{cameraSetLayout};
+#ifdef JB_BINDLESS
+    if (m_Bindless) {
+        shaders.fragmentCode = bindless_frag_spv;
+        shaders.fragmentName = "bindless.frag";
+        setLayouts.push_back(m_Bindless->GetSetLayout());
+    }
+#else
+    m_Bindless = nullptr;
+#endif
+    m_Pipeline = std::make_unique<Pipeline>(m_Context, renderPass, target, shaders, InstanceData::GetLayout(),
+                                            setLayouts);
+#else
+    throw std::runtime_error("Failed to create instance batcher: built without instanced.vert");
+#endif
+}
+
+void InstanceBatcher::BeginFrame(uint32_t frameIndex) {
+    m_Arena.BeginFrame(frameIndex);
+    m_FrameIndex = frameIndex;
+}
+
+void InstanceBatcher::Build(std::span<const DrawItem> draws, std::span<const uint32_t> visible, JobSystem& jobs) {
+    uint32_t count = static_cast<uint32_t>(visible.size());
+    m_Batches.clear();
+    m_BatchLookup.clear();
+    m_Slots.resize(count);
+
+    // Batch of every draw, counting instances per batch. Consecutive draws
+    // of the same mesh skip the lookup.
+    const Mesh* lastMesh = nullptr;
+    uint32_t lastBatch = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const Mesh* mesh = draws[visible[i]].mesh;
+        if (mesh != lastMesh) {
+            auto [it, inserted] = m_BatchLookup.try_emplace(mesh, static_cast<uint32_t>(m_Batches.size()));
+            if (inserted) {
+                m_Batches.push_back({mesh, 0, 0});
+            }
+            lastMesh = mesh;
+            lastBatch = it->second;
+        }
+        m_Batches[lastBatch].instanceCount++;
+        m_Slots[i] = lastBatch;
+    }
+
+    // Batches get consecutive instance ranges; instanceCount is rebuilt as
+    // the fill cursor while each draw is given its slot
+    uint32_t firstInstance = 0;
+    for (auto& batch : m_Batches) {
+        batch.firstInstance = firstInstance;
+        firstInstance += batch.instanceCount;
+        batch.instanceCount = 0;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        Batch& batch = m_Batches[m_Slots[i]];
+        m_Slots[i] = batch.firstInstance + batch.instanceCount++;
+    }
+
+    m_Stats.instanceCount = count;
+    m_Stats.batchCount = GetBatchCount();
+
+    m_Instances = {};
+    if (count == 0) {
+        return;
+    }
+
+    m_Instances = m_Arena.Allocate(count * sizeof(InstanceData), alignof(glm::vec4));
+    if (m_Instances.buffer == VK_NULL_HANDLE) {
+        throw std::runtime_error("Instance arena is full");
+    }
+
+    InstanceData* instances = static_cast<InstanceData*>(m_Instances.mapped);
+    jobs.ParallelFor(count, WRITE_BATCH_SIZE, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            const DrawItem& draw = draws[visible[i]];
+            instances[m_Slots[i]] = {draw.model, draw.color, draw.custom, draw.texture};
+        }
+    });
+}
+
+void InstanceBatcher::RecordBatches(VkCommandBuffer cmd, uint32_t begin, uint32_t end, VkDescriptorSet cameraSet,
+                                    uint32_t cameraOffset) const {
+    if (begin >= end) {
+        return;
+    }
+
+    auto& disp = m_Context.GetDispatchTable();
+
+    // The per-object uniform binding of set 0 is unused here
+    uint32_t dynamicOffsets[] = {cameraOffset, 0};
+    disp.cmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline->GetLayout(), 0, 1, &cameraSet,
+                               2, dynamicOffsets);
+    // Once per secondary, whatever the instances sample
+    if (m_Bindless) {
+        VkDescriptorSet bindlessSet = m_Bindless->GetSet(m_FrameIndex);
+        disp.cmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline->GetLayout(), 1, 1, &bindlessSet,
+                                   0, nullptr);
+    }
+
+    for (uint32_t i = begin; i < end; i++) {
+        const Batch& batch = m_Batches[i];
+
+        VkBuffer vertexBuffers[] = {batch.mesh->GetVertexBuffer(), m_Instances.buffer};
+        VkDeviceSize offsets[] = {0, m_Instances.offset};
+        disp.cmdBindVertexBuffers(cmd, 0, 2, vertexBuffers, offsets);
+        disp.cmdBindIndexBuffer(cmd, batch.mesh->GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+        disp.cmdDrawIndexed(cmd, batch.mesh->GetIndexCount(), batch.instanceCount, 0, 0, batch.firstInstance);
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "vulkan_context.hpp"
+#include "linear_arena.hpp"
+#include "render_pass.hpp"
+#include "render_target.hpp"
+#include "pipeline.hpp"
+#include "mesh.hpp"
+#include "vertex.hpp"
+#include "frame_tracker.hpp"
+#include "bindless_table.hpp"
+#include "../core/job_system.hpp"
+
+struct DrawItem {
+    const Mesh* mesh;
+    glm::mat4 model;
+    glm::vec4 color;
+    glm::vec4 custom;
+    BindlessTable::Handle texture = BindlessTable::INVALID_HANDLE;
+};
+
+// Per-instance vertex data read by instanced.vert from binding 1
+struct InstanceData {
+    glm::mat4 model;
+    glm::vec4 color;        // Multiplies the vertex color
+    glm::vec4 custom;       // Free for shaders to interpret
+    uint32_t texture;       // Bindless image handle, INVALID_HANDLE for none
+
+    // Vertex plus this struct at instance rate
+    static VertexLayout GetLayout();
+};
+
+// Turns the frame's visible draws into one instanced draw per mesh. Draws
+// are grouped by mesh and their InstanceData written contiguously into a
+// per-frame arena, which is bound as the instance-rate vertex buffer; each
+// batch is then a single vkCmdDrawIndexed over its range of instances.
+// Given a bindless table, the batches are textured by each instance's
+// handle, so meshes drawn with different textures still share one draw.
+class InstanceBatcher {
+public:
+    static constexpr VkDeviceSize DEFAULT_CAPACITY_PER_FRAME = 16ull << 20;
+
+    struct Batch {
+        const Mesh* mesh;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+    };
+
+    // Counters for the last Build
+    struct Stats {
+        uint32_t instanceCount = 0;     // Visible draws going in
+        uint32_t batchCount = 0;        // Draw calls coming out
+    };
+
+    // Needs a build with the instanced.vert SPIR-V
+    static bool IsSupported();
+
+    // bindless, when not null, is bound as set 1 and must outlive the batcher
+    InstanceBatcher(VulkanContext& context, RenderPass& renderPass, RenderTarget& target,
+                    VkDescriptorSetLayout cameraSetLayout, const BindlessTable* bindless = nullptr,
+                    VkDeviceSize capacityPerFrame = DEFAULT_CAPACITY_PER_FRAME,
+                    uint32_t frameCount = DEFAULT_FRAMES_IN_FLIGHT);
+
+    InstanceBatcher(const InstanceBatcher&) = delete;
+    InstanceBatcher& operator=(const InstanceBatcher&) = delete;
+
+    // Must only be called once frameIndex's previous submission has completed
+    void BeginFrame(uint32_t frameIndex);
+
+    // Batches draws[visible[i]] in order of each mesh's first appearance.
+    // Throws when the frame's instance data does not fit the arena.
+    void Build(std::span<const DrawItem> draws, std::span<const uint32_t> visible, JobSystem& jobs);
+
+    // Records batches [begin, end) into a command buffer that already has
+    // GetPipeline() bound. cameraSet is the UniformRing set, bound at
+    // cameraOffset.
+    void RecordBatches(VkCommandBuffer cmd, uint32_t begin, uint32_t end, VkDescriptorSet cameraSet,
+                       uint32_t cameraOffset) const;
+
+    Pipeline& GetPipeline() { return *m_Pipeline; }
+    bool IsBindless() const { return m_Bindless != nullptr; }
+    uint32_t GetBatchCount() const { return static_cast<uint32_t>(m_Batches.size()); }
+    const Stats& GetStats() const { return m_Stats; }
+
+private:
+    VulkanContext& m_Context;
+    const BindlessTable* m_Bindless;
+    LinearArena m_Arena;
+    std::unique_ptr<Pipeline> m_Pipeline;
+    uint32_t m_FrameIndex = 0;
+
+    std::vector<Batch> m_Batches;
+    std::unordered_map<const Mesh*, uint32_t> m_BatchLookup;
+    std::vector<uint32_t> m_Slots;          // Instance slot of each visible draw
+    LinearArena::Slice m_Instances;
+    Stats m_Stats;
+};
@@ -0,0 +1,212 @@
+#include "../stdafx.h"
+#include "ktx2_file.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace {
+    const uint8_t KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+    // Fixed part of the file up to the level index (KTX2 spec, section 3)
+    struct Header {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+    static_assert(sizeof(Header) == 80, "KTX2 header must be packed");
+
+    struct LevelIndex {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    // Texels per block and bytes per block, to size each level. 1x1 for
+    // uncompressed formats.
+    struct FormatBlock {
+        uint32_t width;
+        uint32_t height;
+        uint32_t bytes;
+    };
+
+    bool GetFormatBlock(VkFormat format, FormatBlock& block) {
+        switch (format) {
+        case VK_FORMAT_R8_UNORM:
+        case VK_FORMAT_R8_SNORM:
+        case VK_FORMAT_R8_SRGB:
+            block = {1, 1, 1};
+            return true;
+        case VK_FORMAT_R8G8_UNORM:
+        case VK_FORMAT_R8G8_SNORM:
+        case VK_FORMAT_R8G8_SRGB:
+        case VK_FORMAT_R16_UNORM:
+        case VK_FORMAT_R16_SFLOAT:
+        case VK_FORMAT_R5G6B5_UNORM_PACK16:
+        case VK_FORMAT_B5G6R5_UNORM_PACK16:
+        case VK_FORMAT_R4G4B4A4_UNORM_PACK16:
+            block = {1, 1, 2};
+            return true;
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+        case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+        case VK_FORMAT_A2R10G10B10_UNORM_PACK32:
+        case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+        case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:
+        case VK_FORMAT_R16G16_UNORM:
+        case VK_FORMAT_R16G16_SFLOAT:
+        case VK_FORMAT_R32_SFLOAT:
+            block = {1, 1, 4};
+            return true;
+        case VK_FORMAT_R16G16B16A16_UNORM:
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+        case VK_FORMAT_R32G32_SFLOAT:
+            block = {1, 1, 8};
+            return true;
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            block = {1, 1, 16};
+            return true;
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+        case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+        case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+            block = {4, 4, 8};
+            return true;
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+        case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+        case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+        case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+        case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+            block = {4, 4, 16};
+            return true;
+        case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+            block = {6, 6, 16};
+            return true;
+        case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+            block = {8, 8, 16};
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+Ktx2File::Ktx2File(std::string path)
+    : m_Path(std::move(path))
+{
+    std::ifstream file(m_Path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open texture: " + m_Path);
+    }
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    Header header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+        throw std::runtime_error("Not a KTX2 file: " + m_Path);
+    }
+
+    if (header.vkFormat == VK_FORMAT_UNDEFINED || header.supercompressionScheme != 0) {
+        throw std::runtime_error("Unsupported KTX2 file (Basis or supercompressed): " + m_Path);
+    }
+    if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1 ||
+        header.layerCount > 1 || header.faceCount != 1) {
+        throw std::runtime_error("Unsupported KTX2 file (only single 2D images): " + m_Path);
+    }
+    m_Format = static_cast<VkFormat>(header.vkFormat);
+    // Level sizes are checked against the format, so that copies of a level
+    // never read past its data
+    FormatBlock block;
+    if (!GetFormatBlock(m_Format, block)) {
+        throw std::runtime_error("Unsupported KTX2 format " + std::to_string(header.vkFormat) + ": " + m_Path);
+    }
+
+    // A level count of 0 asks the loader to generate mips; only level 0 is stored
+    uint32_t levelCount = std::max(header.levelCount, 1u);
+    // Down to 1x1 at most, so the extents below never shift by 32 or more
+    uint32_t maxLevels = static_cast<uint32_t>(std::bit_width(std::max(header.pixelWidth, header.pixelHeight)));
+    if (levelCount > maxLevels) {
+        throw std::runtime_error("Invalid KTX2 level count " + std::to_string(levelCount) + ": " + m_Path);
+    }
+    if (sizeof(Header) + uint64_t(levelCount) * sizeof(LevelIndex) > fileSize) {
+        throw std::runtime_error("Truncated KTX2 level index: " + m_Path);
+    }
+
+    std::vector<LevelIndex> index(levelCount);
+    if (!file.read(reinterpret_cast<char*>(index.data()), levelCount * sizeof(LevelIndex))) {
+        throw std::runtime_error("Truncated KTX2 level index: " + m_Path);
+    }
+
+    m_Levels.resize(levelCount);
+    for (uint32_t i = 0; i < levelCount; i++) {
+        if (index[i].byteLength == 0 || index[i].byteLength > fileSize ||
+            index[i].byteOffset > fileSize - index[i].byteLength) {
+            throw std::runtime_error("Invalid KTX2 level " + std::to_string(i) + ": " + m_Path);
+        }
+        VkExtent2D extent{std::max(header.pixelWidth >> i, 1u), std::max(header.pixelHeight >> i, 1u)};
+        uint64_t expected = uint64_t((extent.width + block.width - 1) / block.width) *
+                            ((extent.height + block.height - 1) / block.height) * block.bytes;
+        if (index[i].byteLength != expected) {
+            throw std::runtime_error("KTX2 level " + std::to_string(i) + " holds " + std::to_string(index[i].byteLength) +
+                                     " bytes, expected " + std::to_string(expected) + ": " + m_Path);
+        }
+        m_Levels[i].offset = index[i].byteOffset;
+        m_Levels[i].size = index[i].byteLength;
+        m_Levels[i].extent = extent;
+    }
+}
+
+void Ktx2File::ReadLevels(uint32_t first, uint32_t last, std::vector<uint8_t>& out) const {
+    std::ifstream file(m_Path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open texture: " + m_Path);
+    }
+
+    for (uint32_t i = first; i < last; i++) {
+        const Level& level = m_Levels[i];
+        size_t start = out.size();
+        out.resize(start + level.size);
+        file.seekg(static_cast<std::streamoff>(level.offset));
+        if (!file.read(reinterpret_cast<char*>(out.data() + start), static_cast<std::streamsize>(level.size))) {
+            throw std::runtime_error("Failed to read level " + std::to_string(i) + " of " + m_Path);
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A KTX2 texture on disk. Construction reads only the header and the level
+// index; level data is read on demand, so a texture library costs a few
+// hundred bytes per file until its mips are actually needed.
+//
+// Supports single-layer, single-face 2D textures stored with a Vulkan format
+// and no supercompression. Basis Universal and zstd payloads would need a
+// transcoder and are rejected, as are formats whose level sizes the parser
+// cannot check (see GetFormatBlock in ktx2_file.cpp).
+class Ktx2File {
+public:
+    struct Level {
+        uint64_t offset;                // In the file
+        uint64_t size;
+        VkExtent2D extent;
+    };
+
+    // Throws when the file is missing, malformed or unsupported
+    explicit Ktx2File(std::string path);
+
+    const std::string& GetPath() const { return m_Path; }
+    VkFormat GetFormat() const { return m_Format; }
+    VkExtent2D GetExtent() const { return m_Levels[0].extent; }
+    uint32_t GetLevelCount() const { return static_cast<uint32_t>(m_Levels.size()); }
+    // Level 0 is the full resolution image
+    const Level& GetLevel(uint32_t level) const { return m_Levels[level]; }
+
+    // Appends the data of levels [first, last) to out, finest first. Opens
+    // its own stream, so any thread may call it.
+    void ReadLevels(uint32_t first, uint32_t last, std::vector<uint8_t>& out) const;
+
+private:
+    std::string m_Path;
+    VkFormat m_Format = VK_FORMAT_UNDEFINED;
+    std::vector<Level> m_Levels;
+};
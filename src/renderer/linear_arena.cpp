@@ -0,0 +1,48 @@
+#include "../stdafx.h"
+#include "linear_arena.hpp"
+
+#include <algorithm>
+
+LinearArena::LinearArena(MemoryAllocator& allocator, VkDeviceSize capacityPerFrame, VkBufferUsageFlags usage, uint32_t frameCount)
+    : m_Allocator(allocator), m_CapacityPerFrame(capacityPerFrame)
+{
+    // Keep every frame region 256-byte aligned, the largest
+    // minUniformBufferOffsetAlignment found in practice
+    m_CapacityPerFrame = (m_CapacityPerFrame + 255) & ~VkDeviceSize(255);
+
+    m_Buffer = m_Allocator.CreateBuffer(m_CapacityPerFrame * frameCount, usage,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (m_Buffer.allocation.mapped == nullptr) {
+        throw std::runtime_error("Failed to map linear arena");
+    }
+}
+
+LinearArena::~LinearArena() {
+    m_Allocator.DestroyBuffer(m_Buffer);
+}
+
+void LinearArena::BeginFrame(uint32_t frameIndex) {
+    m_PeakUsed = std::max(m_PeakUsed, m_Cursor.load(std::memory_order_relaxed));
+    m_FrameBase = m_CapacityPerFrame * frameIndex;
+    m_Cursor.store(0, std::memory_order_relaxed);
+}
+
+LinearArena::Slice LinearArena::Allocate(VkDeviceSize size, VkDeviceSize alignment) {
+    VkDeviceSize cursor = m_Cursor.load(std::memory_order_relaxed);
+    VkDeviceSize offset;
+    do {
+        offset = (cursor + alignment - 1) & ~(alignment - 1);
+        if (offset + size > m_CapacityPerFrame) {
+            return {};
+        }
+    } while (!m_Cursor.compare_exchange_weak(cursor, offset + size, std::memory_order_relaxed));
+
+    Slice slice;
+    slice.buffer = m_Buffer.buffer;
+    slice.offset = m_FrameBase + offset;
+    slice.size = size;
+    slice.mapped = static_cast<char*>(m_Buffer.allocation.mapped) + slice.offset;
+    return slice;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <atomic>
+#include "memory_allocator.hpp"
+
+// Bump allocator for per-frame transient data (uniforms, staging, dynamic
+// geometry). One persistently mapped buffer is split into a region per frame
+// in flight; BeginFrame rewinds that frame's region, so nothing is ever freed
+// individually. Allocate is lock-free and safe from any thread.
+class LinearArena {
+public:
+    struct Slice {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void* mapped = nullptr;
+    };
+
+    LinearArena(MemoryAllocator& allocator, VkDeviceSize capacityPerFrame, VkBufferUsageFlags usage, uint32_t frameCount);
+    ~LinearArena();
+
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    // Must only be called once the GPU is done with frameIndex's previous use
+    void BeginFrame(uint32_t frameIndex);
+
+    // Returns an empty slice (buffer == VK_NULL_HANDLE) when the frame's region is full
+    Slice Allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+    VkBuffer GetBuffer() const { return m_Buffer.buffer; }
+    VkDeviceSize GetCapacityPerFrame() const { return m_CapacityPerFrame; }
+    VkDeviceSize GetUsed() const { return m_Cursor.load(std::memory_order_relaxed); }
+    VkDeviceSize GetPeakUsed() const { return m_PeakUsed; }
+
+private:
+    MemoryAllocator& m_Allocator;
+    AllocatedBuffer m_Buffer;
+    VkDeviceSize m_CapacityPerFrame;
+    VkDeviceSize m_FrameBase = 0;
+    VkDeviceSize m_PeakUsed = 0;
+    std::atomic<VkDeviceSize> m_Cursor{0};
+};
@@ -0,0 +1,268 @@
+#include "../stdafx.h"
+#include "memory_allocator.hpp"
+
+#include <algorithm>
+
+MemoryAllocator::MemoryAllocator(VulkanContext& context)
+    : m_Context(context)
+{
+    const auto& memProperties = m_Context.GetDevice().physical_device.memory_properties;
+    m_Pools.resize(memProperties.memoryTypeCount * 2);
+
+    for (uint32_t type = 0; type < memProperties.memoryTypeCount; type++) {
+        // Small heaps (e.g. 256 MiB BAR) get proportionally smaller blocks
+        VkDeviceSize heapSize = memProperties.memoryHeaps[memProperties.memoryTypes[type].heapIndex].size;
+        VkDeviceSize blockSize = heapSize <= (1ull << 30) ? std::max<VkDeviceSize>(heapSize / 8, 1ull << 20) : DEFAULT_BLOCK_SIZE;
+
+        for (uint32_t kind = 0; kind < 2; kind++) {
+            Pool& pool = m_Pools[type * 2 + kind];
+            pool.memoryType = type;
+            pool.kind = static_cast<AllocationKind>(kind);
+            pool.blockSize = blockSize;
+        }
+    }
+}
+
+MemoryAllocator::~MemoryAllocator() {
+    for (auto& pool : m_Pools) {
+        for (auto& block : pool.blocks) {
+            if (block.memory != VK_NULL_HANDLE) {
+                FreeDeviceMemory(block.memory, block.mapped != nullptr);
+            }
+        }
+    }
+}
+
+uint32_t MemoryAllocator::FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const {
+    const auto& memProperties = m_Context.GetDevice().physical_device.memory_properties;
+
+    if (preferred != 0) {
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+            VkMemoryPropertyFlags flags = memProperties.memoryTypes[i].propertyFlags;
+            if ((typeBits & (1u << i)) && (flags & (required | preferred)) == (required | preferred)) {
+                return i;
+            }
+        }
+    }
+
+    return m_Context.FindMemoryType(typeBits, required);
+}
+
+MemoryAllocator::Pool& MemoryAllocator::GetPool(uint32_t memoryType, AllocationKind kind) {
+    return m_Pools[memoryType * 2 + static_cast<uint32_t>(kind)];
+}
+
+VkDeviceMemory MemoryAllocator::AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void** mapped) {
+    const auto& device = m_Context.GetDevice().physical_device;
+    if (m_DeviceAllocationCount >= device.properties.limits.maxMemoryAllocationCount) {
+        throw std::runtime_error("Exceeded maxMemoryAllocationCount");
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    auto& disp = m_Context.GetDispatchTable();
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    if (disp.allocateMemory(&allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate device memory");
+    }
+    m_DeviceAllocationCount++;
+
+    *mapped = nullptr;
+    if (device.memory_properties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if (disp.mapMemory(memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to map device memory");
+        }
+    }
+    return memory;
+}
+
+void MemoryAllocator::FreeDeviceMemory(VkDeviceMemory memory, bool mapped) {
+    auto& disp = m_Context.GetDispatchTable();
+    if (mapped) {
+        disp.unmapMemory(memory);
+    }
+    disp.freeMemory(memory, nullptr);
+    m_DeviceAllocationCount--;
+}
+
+Allocation MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required,
+                                     AllocationKind kind, VkMemoryPropertyFlags preferred) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    Allocation allocation;
+    allocation.memoryType = FindMemoryType(requirements.memoryTypeBits, required, preferred);
+    allocation.size = requirements.size;
+    Pool& pool = GetPool(allocation.memoryType, kind);
+
+    // Large resources get their own allocation rather than hogging a block
+    if (requirements.size > pool.blockSize / 2) {
+        allocation.memory = AllocateDeviceMemory(requirements.size, allocation.memoryType, &allocation.mapped);
+        m_DedicatedCount++;
+        m_DedicatedBytes += requirements.size;
+        return allocation;
+    }
+
+    allocation.pool = allocation.memoryType * 2 + static_cast<uint32_t>(kind);
+
+    for (uint32_t i = 0; i < pool.blocks.size(); i++) {
+        Block& block = pool.blocks[i];
+        if (block.memory == VK_NULL_HANDLE) {
+            continue;
+        }
+
+        allocation.handle = block.heap->Allocate(requirements.size, requirements.alignment, allocation.offset);
+        if (allocation.handle != TlsfHeap::INVALID) {
+            allocation.memory = block.memory;
+            allocation.block = i;
+            allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + allocation.offset : nullptr;
+            return allocation;
+        }
+    }
+
+    // No room anywhere: reuse a released block slot or add a new one
+    auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(),
+                           [](const Block& b) { return b.memory == VK_NULL_HANDLE; });
+    if (it == pool.blocks.end()) {
+        it = pool.blocks.emplace(pool.blocks.end());
+    }
+
+    Block& block = *it;
+    block.memory = AllocateDeviceMemory(pool.blockSize, pool.memoryType, &block.mapped);
+    block.heap = std::make_unique<TlsfHeap>(pool.blockSize);
+
+    allocation.handle = block.heap->Allocate(requirements.size, requirements.alignment, allocation.offset);
+    if (allocation.handle == TlsfHeap::INVALID) {
+        throw std::runtime_error("Allocation does not fit in an empty memory block");
+    }
+    allocation.memory = block.memory;
+    allocation.block = static_cast<uint32_t>(it - pool.blocks.begin());
+    allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + allocation.offset : nullptr;
+    return allocation;
+}
+
+void MemoryAllocator::Free(Allocation& allocation) {
+    if (allocation.memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if (allocation.pool == UINT32_MAX) {
+        FreeDeviceMemory(allocation.memory, allocation.mapped != nullptr);
+        m_DedicatedCount--;
+        m_DedicatedBytes -= allocation.size;
+    } else {
+        Pool& pool = m_Pools[allocation.pool];
+        Block& block = pool.blocks[allocation.block];
+        block.heap->Free(allocation.handle);
+
+        // Keep one empty block per pool around to avoid allocation churn
+        if (block.heap->IsEmpty()) {
+            auto empty = std::count_if(pool.blocks.begin(), pool.blocks.end(), [](const Block& b) {
+                return b.memory != VK_NULL_HANDLE && b.heap->IsEmpty();
+            });
+            if (empty > 1) {
+                FreeDeviceMemory(block.memory, block.mapped != nullptr);
+                block = Block{};
+            }
+        }
+    }
+
+    allocation = Allocation{};
+}
+
+AllocatedBuffer MemoryAllocator::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required,
+                                              VkMemoryPropertyFlags preferred, std::span<const uint32_t> queueFamilies) {
+    auto& disp = m_Context.GetDispatchTable();
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (queueFamilies.size() > 1) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+        bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+    }
+
+    AllocatedBuffer buffer;
+    if (disp.createBuffer(&bufferInfo, nullptr, &buffer.buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create buffer");
+    }
+
+    VkMemoryRequirements requirements;
+    disp.getBufferMemoryRequirements(buffer.buffer, &requirements);
+    buffer.allocation = Allocate(requirements, required, AllocationKind::Linear, preferred);
+
+    if (disp.bindBufferMemory(buffer.buffer, buffer.allocation.memory, buffer.allocation.offset) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to bind buffer memory");
+    }
+    return buffer;
+}
+
+void MemoryAllocator::DestroyBuffer(AllocatedBuffer& buffer) {
+    m_Context.GetDispatchTable().destroyBuffer(buffer.buffer, nullptr);
+    Free(buffer.allocation);
+    buffer.buffer = VK_NULL_HANDLE;
+}
+
+AllocatedImage MemoryAllocator::CreateImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags required) {
+    auto& disp = m_Context.GetDispatchTable();
+
+    AllocatedImage image;
+    if (disp.createImage(&imageInfo, nullptr, &image.image) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create image");
+    }
+
+    VkMemoryRequirements requirements;
+    disp.getImageMemoryRequirements(image.image, &requirements);
+    AllocationKind kind = imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL ? AllocationKind::Optimal : AllocationKind::Linear;
+    image.allocation = Allocate(requirements, required, kind);
+
+    if (disp.bindImageMemory(image.image, image.allocation.memory, image.allocation.offset) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to bind image memory");
+    }
+    return image;
+}
+
+void MemoryAllocator::DestroyImage(AllocatedImage& image) {
+    m_Context.GetDispatchTable().destroyImage(image.image, nullptr);
+    Free(image.allocation);
+    image.image = VK_NULL_HANDLE;
+}
+
+MemoryAllocator::Stats MemoryAllocator::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    Stats stats;
+    stats.bytesReserved = m_DedicatedBytes;
+    stats.bytesUsed = m_DedicatedBytes;
+    stats.dedicatedCount = m_DedicatedCount;
+    stats.allocationCount = m_DedicatedCount;
+
+    VkDeviceSize freeBytes = 0;
+    VkDeviceSize largestFree = 0;
+    for (const auto& pool : m_Pools) {
+        for (const auto& block : pool.blocks) {
+            if (block.memory == VK_NULL_HANDLE) {
+                continue;
+            }
+            auto heapStats = block.heap->GetStats();
+            stats.blockCount++;
+            stats.bytesReserved += heapStats.size;
+            stats.bytesUsed += heapStats.usedBytes;
+            stats.allocationCount += heapStats.allocationCount;
+            freeBytes += heapStats.freeBytes;
+            largestFree = std::max<VkDeviceSize>(largestFree, heapStats.largestFreeBlock);
+        }
+    }
+
+    if (freeBytes > 0) {
+        stats.fragmentation = 1.0f - static_cast<float>(largestFree) / static_cast<float>(freeBytes);
+    }
+    return stats;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+#include "vulkan_context.hpp"
+#include "tlsf_heap.hpp"
+
+// Buffers and linear images never share a block with optimal-tiling images,
+// which sidesteps bufferImageGranularity entirely.
+enum class AllocationKind : uint8_t {
+    Linear,
+    Optimal
+};
+
+struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr;                 // Set for host-visible memory, which stays mapped
+    uint32_t memoryType = 0;
+    uint32_t pool = UINT32_MAX;             // UINT32_MAX for dedicated allocations
+    uint32_t block = 0;
+    uint32_t handle = TlsfHeap::INVALID;
+};
+
+struct AllocatedBuffer {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    Allocation allocation;
+};
+
+struct AllocatedImage {
+    VkImage image = VK_NULL_HANDLE;
+    Allocation allocation;
+};
+
+// Sub-allocates resources out of large VkDeviceMemory blocks, one pool per
+// (memory type, AllocationKind), so the number of vkAllocateMemory calls
+// stays far below maxMemoryAllocationCount. Thread-safe.
+class MemoryAllocator {
+public:
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;
+
+    struct Stats {
+        VkDeviceSize bytesReserved = 0;     // Device memory held in blocks and dedicated allocations
+        VkDeviceSize bytesUsed = 0;         // Handed out to resources
+        uint32_t blockCount = 0;
+        uint32_t dedicatedCount = 0;
+        uint32_t allocationCount = 0;
+        float fragmentation = 0.0f;         // 1 - largest free range / total free, over all blocks
+    };
+
+    MemoryAllocator(VulkanContext& context);
+    ~MemoryAllocator();
+
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+    // preferred flags are tried first and dropped if no memory type has them
+    Allocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required,
+                        AllocationKind kind, VkMemoryPropertyFlags preferred = 0);
+    void Free(Allocation& allocation);
+
+    // Buffers are owned by one queue family at a time unless queueFamilies
+    // lists several distinct families, which then share it concurrently
+    AllocatedBuffer CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required,
+                                 VkMemoryPropertyFlags preferred = 0, std::span<const uint32_t> queueFamilies = {});
+    void DestroyBuffer(AllocatedBuffer& buffer);
+
+    AllocatedImage CreateImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags required);
+    void DestroyImage(AllocatedImage& image);
+
+    Stats GetStats() const;
+
+private:
+    struct Block {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        std::unique_ptr<TlsfHeap> heap;
+    };
+
+    struct Pool {
+        uint32_t memoryType = 0;
+        AllocationKind kind = AllocationKind::Linear;
+        VkDeviceSize blockSize = 0;
+        std::vector<Block> blocks;
+    };
+
+    VulkanContext& m_Context;
+    mutable std::mutex m_Mutex;
+    std::vector<Pool> m_Pools;
+    uint32_t m_DeviceAllocationCount = 0;
+    uint32_t m_DedicatedCount = 0;
+    VkDeviceSize m_DedicatedBytes = 0;
+
+    uint32_t FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const;
+    Pool& GetPool(uint32_t memoryType, AllocationKind kind);
+    VkDeviceMemory AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void** mapped);
+    void FreeDeviceMemory(VkDeviceMemory memory, bool mapped);
+};
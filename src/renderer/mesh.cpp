@@ -0,0 +1,41 @@
+#include "../stdafx.h"
+#include "mesh.hpp"
+
+#include <algorithm>
+
+Mesh::Mesh(VulkanContext& context, StagingRing& staging, std::span<const Vertex> vertices, std::span<const uint32_t> indices)
+    : m_Context(context),
+      m_VertexCount(static_cast<uint32_t>(vertices.size())),
+      m_IndexCount(static_cast<uint32_t>(indices.size()))
+{
+    auto& allocator = m_Context.GetAllocator();
+
+    m_VertexBuffer = allocator.CreateBuffer(vertices.size_bytes(),
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    m_IndexBuffer = allocator.CreateBuffer(indices.size_bytes(),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    staging.Upload(m_VertexBuffer.buffer, 0, vertices.data(), vertices.size_bytes());
+    staging.Upload(m_IndexBuffer.buffer, 0, indices.data(), indices.size_bytes());
+
+    if (!vertices.empty()) {
+        glm::vec3 min = vertices[0].position;
+        glm::vec3 max = vertices[0].position;
+        for (const auto& vertex : vertices) {
+            min = glm::min(min, vertex.position);
+            max = glm::max(max, vertex.position);
+        }
+        m_BoundsCenter = (min + max) * 0.5f;
+        m_BoundsExtents = (max - min) * 0.5f;
+
+        for (const auto& vertex : vertices) {
+            m_BoundsRadius = std::max(m_BoundsRadius, glm::length(vertex.position - m_BoundsCenter));
+        }
+    }
+}
+
+Mesh::~Mesh() {
+    auto& allocator = m_Context.GetAllocator();
+    allocator.DestroyBuffer(m_IndexBuffer);
+    allocator.DestroyBuffer(m_VertexBuffer);
+}
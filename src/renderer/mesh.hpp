@@ -0,0 +1,40 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <span>
+#include "vulkan_context.hpp"
+#include "memory_allocator.hpp"
+#include "staging_ring.hpp"
+#include "vertex.hpp"
+
+// Indexed triangle geometry in device-local vertex and index buffers. The
+// data goes through the staging ring, so it is usable by any command buffer
+// submitted after the ring's next Flush.
+class Mesh {
+public:
+    Mesh(VulkanContext& context, StagingRing& staging, std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+    ~Mesh();
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    VkBuffer GetVertexBuffer() const { return m_VertexBuffer.buffer; }
+    VkBuffer GetIndexBuffer() const { return m_IndexBuffer.buffer; }
+    uint32_t GetVertexCount() const { return m_VertexCount; }
+    uint32_t GetIndexCount() const { return m_IndexCount; }
+
+    // Object-space bounding box (center, half extents) and the radius of the
+    // sphere around the same center, for culling
+    const glm::vec3& GetBoundsCenter() const { return m_BoundsCenter; }
+    const glm::vec3& GetBoundsExtents() const { return m_BoundsExtents; }
+    float GetBoundsRadius() const { return m_BoundsRadius; }
+
+private:
+    VulkanContext& m_Context;
+    AllocatedBuffer m_VertexBuffer;
+    AllocatedBuffer m_IndexBuffer;
+    uint32_t m_VertexCount;
+    uint32_t m_IndexCount;
+    glm::vec3 m_BoundsCenter{0.0f};
+    glm::vec3 m_BoundsExtents{0.0f};
+    float m_BoundsRadius = 0.0f;
+};
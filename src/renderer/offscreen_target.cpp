@@ -0,0 +1,62 @@
+#include "../stdafx.h"
+#include "offscreen_target.hpp"
+
+OffscreenTarget::OffscreenTarget(VulkanContext& context, VkExtent2D extent, uint32_t imageCount, VkFormat format)
+    : m_Context(context), m_Extent(extent), m_Format(format)
+{
+    Initialize(imageCount);
+}
+
+OffscreenTarget::~OffscreenTarget() {
+    Cleanup();
+}
+
+void OffscreenTarget::Cleanup() {
+    auto& disp = m_Context.GetDispatchTable();
+    for (auto imageView : m_ImageViews) {
+        disp.destroyImageView(imageView, nullptr);
+    }
+    for (auto& image : m_Allocations) {
+        m_Context.GetAllocator().DestroyImage(image);
+    }
+}
+
+void OffscreenTarget::Initialize(uint32_t imageCount) {
+    auto& disp = m_Context.GetDispatchTable();
+    m_Images.resize(imageCount);
+    m_ImageViews.resize(imageCount);
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = m_Format;
+    imageInfo.extent = {m_Extent.width, m_Extent.height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    m_Allocations.reserve(imageCount);
+    for (uint32_t i = 0; i < imageCount; i++) {
+        m_Allocations.push_back(m_Context.GetAllocator().CreateImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+        m_Images[i] = m_Allocations[i].image;
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = m_Images[i];
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = m_Format;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (disp.createImageView(&viewInfo, nullptr, &m_ImageViews[i]) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create offscreen image view");
+        }
+    }
+}
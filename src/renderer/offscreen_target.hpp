@@ -0,0 +1,34 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vector>
+#include "vulkan_context.hpp"
+#include "render_target.hpp"
+#include "memory_allocator.hpp"
+
+// Ring of device-local color images used in place of the swapchain when
+// running headless. Images are left in TRANSFER_SRC_OPTIMAL so they can be
+// copied out for batch rendering.
+class OffscreenTarget : public RenderTarget {
+public:
+    OffscreenTarget(VulkanContext& context, VkExtent2D extent, uint32_t imageCount,
+                    VkFormat format = VK_FORMAT_R8G8B8A8_UNORM);
+    ~OffscreenTarget();
+
+    const std::vector<VkImage>& GetImages() const override { return m_Images; }
+    const std::vector<VkImageView>& GetImageViews() const override { return m_ImageViews; }
+    VkFormat GetImageFormat() const override { return m_Format; }
+    VkExtent2D GetExtent() const override { return m_Extent; }
+    uint32_t GetImageCount() const override { return static_cast<uint32_t>(m_Images.size()); }
+    VkImageLayout GetFinalLayout() const override { return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL; }
+
+private:
+    VulkanContext& m_Context;
+    VkExtent2D m_Extent;
+    VkFormat m_Format;
+    std::vector<VkImage> m_Images;
+    std::vector<VkImageView> m_ImageViews;
+    std::vector<AllocatedImage> m_Allocations;
+
+    void Cleanup();
+    void Initialize(uint32_t imageCount);
+};
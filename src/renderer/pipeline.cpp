@@ -1,12 +1,14 @@
 #include "../stdafx.h"
 #include "pipeline.hpp"
+#include "pipeline_cache.hpp"
 
-Pipeline::Pipeline(VulkanContext& context, RenderPass& renderPass, SwapChain& swapchain)
-    : m_Context(context), m_RenderPass(renderPass), m_Swapchain(swapchain)
+Pipeline::Pipeline(VulkanContext& context, RenderPass& renderPass, RenderTarget& target, const ShaderStages& shaders,
+                   const VertexLayout& vertexLayout, const std::vector<VkDescriptorSetLayout>& setLayouts)
+    : m_Context(context), m_RenderPass(renderPass), m_Target(target)
 {
     // Create shader modules
-    ShaderModule vertShader(context, std::string(EXAMPLE_BUILD_DIRECTORY) + "/shaders/triangle.vert.spv");
-    ShaderModule fragShader(context, std::string(EXAMPLE_BUILD_DIRECTORY) + "/shaders/triangle.frag.spv");
+    ShaderModule vertShader(context, shaders.vertexCode, shaders.vertexName);
+    ShaderModule fragShader(context, shaders.fragmentCode, shaders.fragmentName);
 
     VkPipelineShaderStageCreateInfo vertStageInfo{};
     vertStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -25,8 +27,10 @@ Pipeline::Pipeline(VulkanContext& context, RenderPass& renderPass, SwapChain& sw
     // Vertex input
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 0;
-    vertexInputInfo.vertexAttributeDescriptionCount = 0;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexLayout.bindings.size());
+    vertexInputInfo.pVertexBindingDescriptions = vertexLayout.bindings.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexLayout.attributes.size());
+    vertexInputInfo.pVertexAttributeDescriptions = vertexLayout.attributes.data();
 
     // Input assembly
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -38,14 +42,14 @@ Pipeline::Pipeline(VulkanContext& context, RenderPass& renderPass, SwapChain& sw
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = static_cast<float>(swapchain.GetExtent().width);
-    viewport.height = static_cast<float>(swapchain.GetExtent().height);
+    viewport.width = static_cast<float>(target.GetExtent().width);
+    viewport.height = static_cast<float>(target.GetExtent().height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
 
     VkRect2D scissor{};
     scissor.offset = {0, 0};
-    scissor.extent = swapchain.GetExtent();
+    scissor.extent = target.GetExtent();
 
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
@@ -98,7 +102,8 @@ Pipeline::Pipeline(VulkanContext& context, RenderPass& renderPass, SwapChain& sw
     // Pipeline layout
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 0;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
     pipelineLayoutInfo.pushConstantRangeCount = 0;
 
     if (m_Context.GetDispatchTable().createPipelineLayout(&pipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS) {
@@ -122,8 +127,17 @@ Pipeline::Pipeline(VulkanContext& context, RenderPass& renderPass, SwapChain& sw
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (m_Context.GetDispatchTable().createGraphicsPipelines(
-            VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_Pipeline) != VK_SUCCESS) {
+    // Without a render pass the attachment formats are given directly
+    VkFormat colorFormat = m_RenderPass.GetColorFormat();
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &colorFormat;
+    if (m_RenderPass.IsDynamic()) {
+        pipelineInfo.pNext = &renderingInfo;
+    }
+
+    if (m_Context.GetPipelineCache().CreateGraphicsPipeline(pipelineInfo, &m_Pipeline) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create graphics pipeline");
     }
 
@@ -1,13 +1,26 @@
 #pragma once
 #include <vulkan/vulkan_core.h>
+#include <span>
+#include <vector>
 #include "vulkan_context.hpp"
 #include "render_pass.hpp"
 #include "shader_module.hpp"
-#include "swap_chain.hpp"
+#include "render_target.hpp"
+#include "vertex.hpp"
+
+// Embedded SPIR-V for each stage. The names are the source file names, used
+// for the JBRENDERER_SHADER_DIR override.
+struct ShaderStages {
+    std::span<const uint32_t> vertexCode;
+    const char* vertexName;
+    std::span<const uint32_t> fragmentCode;
+    const char* fragmentName;
+};
 
 class Pipeline {
 public:
-    Pipeline(VulkanContext& context, RenderPass& renderPass, SwapChain& swapchain);
+    Pipeline(VulkanContext& context, RenderPass& renderPass, RenderTarget& target, const ShaderStages& shaders,
+             const VertexLayout& vertexLayout, const std::vector<VkDescriptorSetLayout>& setLayouts);
     ~Pipeline();
 
     VkPipeline GetHandle() const { return m_Pipeline; }
@@ -16,7 +29,7 @@ public:
 private:
     VulkanContext& m_Context;
     RenderPass& m_RenderPass;
-    SwapChain& m_Swapchain;
+    RenderTarget& m_Target;
     VkPipelineLayout m_PipelineLayout;
     VkPipeline m_Pipeline;
 };
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "../stdafx.h"
+#include "pipeline_cache.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+PipelineCache::PipelineCache(VulkanContext& context, const std::string& path)
+    : m_Context(context), m_Path(path)
+{
+    m_FeedbackSupported = m_Context.IsExtensionEnabled(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<char> data = Load();
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (m_Context.GetDispatchTable().createPipelineCache(&cacheInfo, nullptr, &m_Cache) != VK_SUCCESS) {
+        // The driver may still refuse a blob that passed our checks; fall back to an empty cache
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData = nullptr;
+        m_Stats.loaded = false;
+        m_Stats.rejectReason = "rejected by driver";
+        if (m_Context.GetDispatchTable().createPipelineCache(&cacheInfo, nullptr, &m_Cache) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline cache");
+        }
+    }
+
+    m_Stats.loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+PipelineCache::~PipelineCache() {
+    m_Context.GetDispatchTable().destroyPipelineCache(m_Cache, nullptr);
+}
+
+std::vector<char> PipelineCache::Load() {
+    if (m_Path.empty()) {
+        m_Stats.rejectReason = "persistence disabled";
+        return {};
+    }
+
+    std::ifstream file(m_Path, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        m_Stats.rejectReason = "no cache file";
+        return {};
+    }
+
+    size_t fileSize = static_cast<size_t>(file.tellg());
+    if (fileSize < sizeof(FileHeader)) {
+        m_Stats.rejectReason = "truncated header";
+        return {};
+    }
+
+    FileHeader header{};
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    std::vector<char> data(fileSize - sizeof(FileHeader));
+    file.read(data.data(), static_cast<std::streamsize>(data.size()));
+
+    FileHeader expected = MakeHeader(data);
+    if (header.magic != FILE_MAGIC || header.version != FILE_VERSION) {
+        m_Stats.rejectReason = "unknown file format";
+        return {};
+    }
+    if (header.vendorID != expected.vendorID || header.deviceID != expected.deviceID ||
+        std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        m_Stats.rejectReason = "different device";
+        return {};
+    }
+    if (header.driverVersion != expected.driverVersion) {
+        m_Stats.rejectReason = "different driver version";
+        return {};
+    }
+    if (header.dataSize != data.size() || header.checksum != expected.checksum) {
+        m_Stats.rejectReason = "corrupt data";
+        return {};
+    }
+
+    // Belt and braces: the driver's own header must agree as well
+    VkPipelineCacheHeaderVersionOne driverHeader{};
+    if (data.size() < sizeof(driverHeader)) {
+        m_Stats.rejectReason = "truncated driver header";
+        return {};
+    }
+    std::memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+    if (driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+        driverHeader.vendorID != expected.vendorID || driverHeader.deviceID != expected.deviceID ||
+        std::memcmp(driverHeader.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        m_Stats.rejectReason = "driver header mismatch";
+        return {};
+    }
+
+    m_Stats.loaded = true;
+    m_Stats.rejectReason.clear();
+    m_Stats.loadedBytes = data.size();
+    m_LoadedChecksum = header.checksum;
+    return data;
+}
+
+void PipelineCache::Save() {
+    if (m_Path.empty()) {
+        return;
+    }
+
+    auto& disp = m_Context.GetDispatchTable();
+    size_t size = 0;
+    if (disp.getPipelineCacheData(m_Cache, &size, nullptr) != VK_SUCCESS || size == 0) {
+        return;
+    }
+    std::vector<char> data(size);
+    if (disp.getPipelineCacheData(m_Cache, &size, data.data()) != VK_SUCCESS) {
+        return;
+    }
+    data.resize(size);
+
+    FileHeader header = MakeHeader(data);
+    if (m_Stats.loaded && header.checksum == m_LoadedChecksum) {
+        return;     // Nothing new was compiled
+    }
+
+    // Write next to the target and rename over it, so a crash mid-write
+    // never leaves a half-written cache behind
+    std::string tempPath = m_Path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file.good()) {
+            file.close();
+            std::filesystem::remove(tempPath);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, m_Path, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+    }
+}
+
+PipelineCache::FileHeader PipelineCache::MakeHeader(const std::vector<char>& data) const {
+    const auto& properties = m_Context.GetDevice().physical_device.properties;
+
+    FileHeader header{};
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.dataSize = data.size();
+    header.checksum = Checksum(data);
+    return header;
+}
+
+uint64_t PipelineCache::Checksum(const std::vector<char>& data) {
+    // FNV-1a, enough to catch truncation and bit rot
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : data) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+VkResult PipelineCache::CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& createInfo, VkPipeline* pipeline) {
+    VkGraphicsPipelineCreateInfo info = createInfo;
+
+    VkPipelineCreationFeedback feedback{};
+    VkPipelineCreationFeedbackCreateInfo feedbackInfo{};
+    if (m_FeedbackSupported) {
+        feedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO;
+        feedbackInfo.pNext = info.pNext;
+        feedbackInfo.pPipelineCreationFeedback = &feedback;
+        info.pNext = &feedbackInfo;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    VkResult result = m_Context.GetDispatchTable().createGraphicsPipelines(m_Cache, 1, &info, nullptr, pipeline);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    if (result == VK_SUCCESS) {
+        RecordFeedback(feedback, ms);
+    }
+    return result;
+}
+
+VkResult PipelineCache::CreateComputePipeline(const VkComputePipelineCreateInfo& createInfo, VkPipeline* pipeline) {
+    VkComputePipelineCreateInfo info = createInfo;
+
+    VkPipelineCreationFeedback feedback{};
+    VkPipelineCreationFeedbackCreateInfo feedbackInfo{};
+    if (m_FeedbackSupported) {
+        feedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO;
+        feedbackInfo.pNext = info.pNext;
+        feedbackInfo.pPipelineCreationFeedback = &feedback;
+        info.pNext = &feedbackInfo;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    VkResult result = m_Context.GetDispatchTable().createComputePipelines(m_Cache, 1, &info, nullptr, pipeline);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    if (result == VK_SUCCESS) {
+        RecordFeedback(feedback, ms);
+    }
+    return result;
+}
+
+void PipelineCache::RecordFeedback(const VkPipelineCreationFeedback& feedback, double ms) {
+    m_Stats.pipelinesCreated++;
+    m_Stats.createMs += ms;
+
+    if (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) {
+        if (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT) {
+            m_Stats.cacheHits++;
+        } else {
+            m_Stats.cacheMisses++;
+        }
+    }
+}
+
+void PipelineCache::PrintStats(std::ostream& os) const {
+    // Formatted apart, so the caller's stream keeps its own flags
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(2) << "Pipeline cache: ";
+    if (m_Stats.loaded) {
+        line << "loaded " << m_Stats.loadedBytes / 1024 << " KiB";
+    } else {
+        line << "cold (" << m_Stats.rejectReason << ")";
+    }
+    line << " in " << m_Stats.loadMs << " ms; " << m_Stats.pipelinesCreated << " pipelines in "
+         << m_Stats.createMs << " ms";
+    if (m_FeedbackSupported) {
+        line << " (" << m_Stats.cacheHits << " hits, " << m_Stats.cacheMisses << " misses)";
+    }
+    os << line.str() << std::endl;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "vulkan_context.hpp"
+
+// VkPipelineCache persisted across runs. The blob is loaded at context
+// creation, rejected if it was written by a different device or driver,
+// and written back atomically (temp file + rename) on shutdown.
+class PipelineCache {
+public:
+    struct Stats {
+        bool loaded = false;            // A valid blob was found on disk
+        std::string rejectReason;       // Why the on-disk blob was not used
+        size_t loadedBytes = 0;
+        double loadMs = 0.0;
+
+        uint32_t pipelinesCreated = 0;
+        uint32_t cacheHits = 0;         // From VK_EXT_pipeline_creation_feedback
+        uint32_t cacheMisses = 0;
+        double createMs = 0.0;
+    };
+
+    PipelineCache(VulkanContext& context, const std::string& path);
+    ~PipelineCache();
+
+    VkPipelineCache GetHandle() const { return m_Cache; }
+    const Stats& GetStats() const { return m_Stats; }
+
+    // createGraphicsPipelines through the cache, with timing and hit/miss tracking
+    VkResult CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& createInfo, VkPipeline* pipeline);
+    VkResult CreateComputePipeline(const VkComputePipelineCreateInfo& createInfo, VkPipeline* pipeline);
+
+    void Save();
+    void PrintStats(std::ostream& os) const;
+
+private:
+    static constexpr uint32_t FILE_MAGIC = 0x4350424A;    // "JBPC"
+    static constexpr uint32_t FILE_VERSION = 1;
+
+    // Prefix written before the driver's blob. The driver blob carries its
+    // own header too, but it does not include the driver version.
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t checksum;
+    };
+
+    VulkanContext& m_Context;
+    std::string m_Path;
+    VkPipelineCache m_Cache = VK_NULL_HANDLE;
+    uint64_t m_LoadedChecksum = 0;
+    bool m_FeedbackSupported = false;
+    Stats m_Stats;
+
+    std::vector<char> Load();
+    FileHeader MakeHeader(const std::vector<char>& data) const;
+    void RecordFeedback(const VkPipelineCreationFeedback& feedback, double ms);
+    static uint64_t Checksum(const std::vector<char>& data);
+};
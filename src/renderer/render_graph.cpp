@@ -0,0 +1,611 @@
+#include "../stdafx.h"
+#include "render_graph.hpp"
+#include "deletion_queue.hpp"
+
+#include <algorithm>
+
+namespace {
+    struct UsageInfo {
+        VkPipelineStageFlags stages;
+        VkAccessFlags readAccess;
+        VkAccessFlags writeAccess;
+        VkImageLayout layout;       // Images only
+    };
+
+    UsageInfo GetUsageInfo(ResourceUsage usage) {
+        switch (usage) {
+        case ResourceUsage::ColorAttachment:
+            return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT,
+                    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+        case ResourceUsage::DepthAttachment:
+            return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+        case ResourceUsage::SampledFragment:
+            return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0,
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        case ResourceUsage::StorageReadCompute:
+            return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0, VK_IMAGE_LAYOUT_GENERAL};
+        case ResourceUsage::StorageWriteCompute:
+            return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_GENERAL};
+        case ResourceUsage::VertexInput:
+            return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT, 0,
+                    VK_IMAGE_LAYOUT_UNDEFINED};
+        case ResourceUsage::IndirectRead:
+            return {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, 0,
+                    VK_IMAGE_LAYOUT_UNDEFINED};
+        case ResourceUsage::TransferSrc:
+            return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, 0, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL};
+        case ResourceUsage::TransferDst:
+            return {VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL};
+        }
+        throw std::runtime_error("Unknown render graph resource usage");
+    }
+
+    // Where a resource stands while barriers are planned
+    struct ResourceState {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writeStages = 0;       // Last write (or layout transition)
+        VkAccessFlags writeAccess = 0;
+        VkPipelineStageFlags readStages = 0;        // Reads since then
+        VkPipelineStageFlags visibleStages = 0;     // Stages/accesses the last write is already visible to
+        VkAccessFlags visibleAccess = 0;
+    };
+
+    bool Overlaps(uint32_t firstA, uint32_t lastA, uint32_t firstB, uint32_t lastB) {
+        return firstA <= lastB && firstB <= lastA;
+    }
+}
+
+void RenderGraph::PassBuilder::Read(ResourceId resource, ResourceUsage usage) {
+    if (GetUsageInfo(usage).readAccess == 0) {
+        throw std::runtime_error("Render graph usage cannot be read");
+    }
+    m_Graph.m_Passes[m_Pass].accesses.push_back({resource, usage, false});
+}
+
+void RenderGraph::PassBuilder::Write(ResourceId resource, ResourceUsage usage) {
+    if (GetUsageInfo(usage).writeAccess == 0) {
+        throw std::runtime_error("Render graph usage cannot be written");
+    }
+    m_Graph.m_Passes[m_Pass].accesses.push_back({resource, usage, true});
+}
+
+RenderGraph::RenderGraph(VulkanContext& context)
+    : m_Context(context)
+{
+}
+
+RenderGraph::~RenderGraph() {
+    DestroyTransients();
+}
+
+void RenderGraph::Reset() {
+    DestroyTransients();
+    m_Resources.clear();
+    m_Passes.clear();
+    m_Outputs.clear();
+    m_FinalBarriers = BarrierBatch{};
+    m_Stats = Stats{};
+    m_Compiled = false;
+}
+
+RenderGraph::ResourceId RenderGraph::CreateImage(const char* name, const ImageDesc& desc) {
+    Resource resource;
+    resource.name = name;
+    resource.isImage = true;
+    resource.imageDesc = desc;
+    m_Resources.push_back(resource);
+    return static_cast<ResourceId>(m_Resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::CreateBuffer(const char* name, const BufferDesc& desc) {
+    Resource resource;
+    resource.name = name;
+    resource.bufferDesc = desc;
+    m_Resources.push_back(resource);
+    return static_cast<ResourceId>(m_Resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::ImportImage(const char* name, VkImageAspectFlags aspect, const ImportState& state) {
+    Resource resource;
+    resource.name = name;
+    resource.isImage = true;
+    resource.imported = true;
+    resource.imageDesc.aspect = aspect;
+    resource.importState = state;
+    m_Resources.push_back(resource);
+    return static_cast<ResourceId>(m_Resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::ImportBuffer(const char* name, const ImportState& state) {
+    Resource resource;
+    resource.name = name;
+    resource.imported = true;
+    resource.importState = state;
+    m_Resources.push_back(resource);
+    return static_cast<ResourceId>(m_Resources.size() - 1);
+}
+
+void RenderGraph::AddPass(const char* name, const std::function<void(PassBuilder&)>& setup, ExecuteFn execute) {
+    Pass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    m_Passes.push_back(std::move(pass));
+
+    PassBuilder builder(*this, static_cast<uint32_t>(m_Passes.size() - 1));
+    setup(builder);
+}
+
+void RenderGraph::MarkOutput(ResourceId resource) {
+    m_Outputs.push_back(resource);
+}
+
+void RenderGraph::SetImportedImage(ResourceId resource, VkImage image, VkImageView view) {
+    m_Resources[resource].image = image;
+    m_Resources[resource].view = view;
+}
+
+void RenderGraph::SetImportedBuffer(ResourceId resource, VkBuffer buffer) {
+    m_Resources[resource].buffer = buffer;
+}
+
+void RenderGraph::Compile() {
+    DestroyTransients();
+
+    CullPasses();
+    ComputeLifetimes();
+    CreateTransients();
+    AliasMemory();
+    PlanBarriers();
+
+    m_Compiled = true;
+}
+
+void RenderGraph::CullPasses() {
+    // Walk back from the outputs: a pass lives if it writes something that
+    // is needed, and then everything it touches is needed too (including
+    // what it writes, so earlier writers it builds on stay alive)
+    std::vector<bool> needed(m_Resources.size(), false);
+    for (ResourceId output : m_Outputs) {
+        needed[output] = true;
+    }
+
+    m_Stats.passCount = 0;
+    m_Stats.culledPassCount = 0;
+    for (size_t i = m_Passes.size(); i-- > 0;) {
+        Pass& pass = m_Passes[i];
+        pass.live = std::any_of(pass.accesses.begin(), pass.accesses.end(),
+            [&](const Access& access) { return access.write && needed[access.resource]; });
+
+        if (pass.live) {
+            for (const Access& access : pass.accesses) {
+                needed[access.resource] = true;
+            }
+            m_Stats.passCount++;
+        } else {
+            m_Stats.culledPassCount++;
+        }
+    }
+}
+
+void RenderGraph::ComputeLifetimes() {
+    for (auto& resource : m_Resources) {
+        resource.firstPass = UINT32_MAX;
+        resource.lastPass = 0;
+        resource.lastStages = 0;
+        resource.lastWriteAccess = 0;
+    }
+
+    for (uint32_t i = 0; i < m_Passes.size(); i++) {
+        if (!m_Passes[i].live) {
+            continue;
+        }
+        for (const Access& access : m_Passes[i].accesses) {
+            Resource& resource = m_Resources[access.resource];
+            UsageInfo info = GetUsageInfo(access.usage);
+            if (resource.firstPass == UINT32_MAX) {
+                resource.firstPass = i;
+            }
+            if (i != resource.lastPass) {
+                resource.lastStages = 0;
+                resource.lastWriteAccess = 0;
+            }
+            resource.lastPass = i;
+            resource.lastStages |= info.stages;
+            if (access.write) {
+                resource.lastWriteAccess |= info.writeAccess;
+            }
+        }
+    }
+}
+
+void RenderGraph::CreateTransients() {
+    auto& disp = m_Context.GetDispatchTable();
+
+    for (auto& resource : m_Resources) {
+        if (resource.imported || resource.firstPass == UINT32_MAX) {
+            continue;
+        }
+
+        if (resource.isImage) {
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.format = resource.imageDesc.format;
+            imageInfo.extent = {resource.imageDesc.extent.width, resource.imageDesc.extent.height, 1};
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.usage = resource.imageDesc.usage;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            if (disp.createImage(&imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+                throw std::runtime_error(std::string("Failed to create render graph image ") + resource.name);
+            }
+            disp.getImageMemoryRequirements(resource.image, &resource.requirements);
+        } else {
+            VkBufferCreateInfo bufferInfo{};
+            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size = resource.bufferDesc.size;
+            bufferInfo.usage = resource.bufferDesc.usage;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            if (disp.createBuffer(&bufferInfo, nullptr, &resource.buffer) != VK_SUCCESS) {
+                throw std::runtime_error(std::string("Failed to create render graph buffer ") + resource.name);
+            }
+            disp.getBufferMemoryRequirements(resource.buffer, &resource.requirements);
+        }
+    }
+}
+
+void RenderGraph::AliasMemory() {
+    std::vector<ResourceId> transients;
+    for (ResourceId id = 0; id < m_Resources.size(); id++) {
+        const Resource& resource = m_Resources[id];
+        if (!resource.imported && resource.firstPass != UINT32_MAX) {
+            transients.push_back(id);
+        }
+    }
+
+    // Largest first, so each slot is sized by its first occupant and later
+    // ones only need to fit
+    std::sort(transients.begin(), transients.end(), [&](ResourceId a, ResourceId b) {
+        return m_Resources[a].requirements.size > m_Resources[b].requirements.size;
+    });
+
+    m_Stats.transientCount = static_cast<uint32_t>(transients.size());
+    m_Stats.transientBytes = 0;
+    for (ResourceId id : transients) {
+        Resource& resource = m_Resources[id];
+        const VkMemoryRequirements& requirements = resource.requirements;
+        AllocationKind kind = resource.isImage ? AllocationKind::Optimal : AllocationKind::Linear;
+        m_Stats.transientBytes += requirements.size;
+
+        uint32_t slotIndex = UINT32_MAX;
+        for (uint32_t s = 0; s < m_MemorySlots.size() && slotIndex == UINT32_MAX; s++) {
+            const MemorySlot& slot = m_MemorySlots[s];
+            if (slot.kind != kind || (slot.memoryTypeBits & requirements.memoryTypeBits) == 0 ||
+                slot.size < requirements.size) {
+                continue;
+            }
+            bool free = std::none_of(slot.occupants.begin(), slot.occupants.end(), [&](ResourceId other) {
+                return Overlaps(resource.firstPass, resource.lastPass, m_Resources[other].firstPass, m_Resources[other].lastPass);
+            });
+            if (free) {
+                slotIndex = s;
+            }
+        }
+
+        if (slotIndex == UINT32_MAX) {
+            MemorySlot slot;
+            slot.kind = kind;
+            slot.size = requirements.size;
+            m_MemorySlots.push_back(slot);
+            slotIndex = static_cast<uint32_t>(m_MemorySlots.size() - 1);
+        }
+
+        MemorySlot& slot = m_MemorySlots[slotIndex];
+        slot.alignment = std::max(slot.alignment, requirements.alignment);
+        slot.memoryTypeBits &= requirements.memoryTypeBits;
+        slot.occupants.push_back(id);
+        resource.memorySlot = slotIndex;
+    }
+
+    auto& disp = m_Context.GetDispatchTable();
+    auto& allocator = m_Context.GetAllocator();
+    m_Stats.allocatedBytes = 0;
+
+    for (auto& slot : m_MemorySlots) {
+        VkMemoryRequirements requirements{slot.size, slot.alignment, slot.memoryTypeBits};
+        slot.allocation = allocator.Allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, slot.kind);
+        m_Stats.allocatedBytes += slot.size;
+
+        // Each occupant waits for the one before it; the first waits for the
+        // last, which may still be running from the previous frame
+        std::sort(slot.occupants.begin(), slot.occupants.end(), [&](ResourceId a, ResourceId b) {
+            return m_Resources[a].firstPass < m_Resources[b].firstPass;
+        });
+        for (size_t i = 0; i < slot.occupants.size(); i++) {
+            Resource& resource = m_Resources[slot.occupants[i]];
+            resource.aliasPredecessor = slot.occupants[(i + slot.occupants.size() - 1) % slot.occupants.size()];
+
+            if (resource.isImage) {
+                if (disp.bindImageMemory(resource.image, slot.allocation.memory, slot.allocation.offset) != VK_SUCCESS) {
+                    throw std::runtime_error(std::string("Failed to bind render graph image ") + resource.name);
+                }
+
+                VkImageViewCreateInfo viewInfo{};
+                viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+                viewInfo.image = resource.image;
+                viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+                viewInfo.format = resource.imageDesc.format;
+                viewInfo.subresourceRange = {resource.imageDesc.aspect, 0, 1, 0, 1};
+
+                if (disp.createImageView(&viewInfo, nullptr, &resource.view) != VK_SUCCESS) {
+                    throw std::runtime_error(std::string("Failed to create render graph image view ") + resource.name);
+                }
+            } else if (disp.bindBufferMemory(resource.buffer, slot.allocation.memory, slot.allocation.offset) != VK_SUCCESS) {
+                throw std::runtime_error(std::string("Failed to bind render graph buffer ") + resource.name);
+            }
+        }
+    }
+}
+
+void RenderGraph::PlanBarriers() {
+    std::vector<ResourceState> states(m_Resources.size());
+    for (ResourceId id = 0; id < m_Resources.size(); id++) {
+        const Resource& resource = m_Resources[id];
+        ResourceState& state = states[id];
+        if (resource.imported) {
+            // Whatever happened before the graph counts as a write: it has to
+            // finish, and be made visible, before the first use here. The
+            // default state (top of pipe, no access) has nothing to wait for.
+            state.layout = resource.importState.layout;
+            if (resource.importState.stage != VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT || resource.importState.access != 0) {
+                state.writeStages = resource.importState.stage;
+                state.writeAccess = resource.importState.access;
+            }
+        } else if (resource.aliasPredecessor != UINT32_MAX) {
+            // Contents are discarded, but the previous user of the memory must
+            // be done, and its last writes made available so they cannot land
+            // after the new occupant's (earlier writes were already flushed
+            // by the barriers in front of its later uses)
+            const Resource& predecessor = m_Resources[resource.aliasPredecessor];
+            state.writeStages = predecessor.lastStages;
+            state.writeAccess = predecessor.lastWriteAccess;
+        }
+    }
+
+    m_Stats.barrierCount = 0;
+    m_Stats.imageBarrierCount = 0;
+
+    auto addBarrier = [&](BarrierBatch& batch, ResourceId id, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                          VkPipelineStageFlags dstStages, VkAccessFlags dstAccess, VkImageLayout oldLayout,
+                          VkImageLayout newLayout) {
+        batch.srcStages |= srcStages;
+        batch.dstStages |= dstStages;
+        if (m_Resources[id].isImage) {
+            batch.images.push_back({id, srcAccess, dstAccess, oldLayout, newLayout});
+        } else {
+            batch.memorySrcAccess |= srcAccess;
+            batch.memoryDstAccess |= dstAccess;
+        }
+        batch.needed = true;
+    };
+
+    for (auto& pass : m_Passes) {
+        pass.barriers = BarrierBatch{};
+        if (!pass.live) {
+            continue;
+        }
+
+        // A resource used several ways in one pass is synchronized once for all of them
+        std::vector<Access> merged;
+        std::vector<VkPipelineStageFlags> mergedStages;
+        std::vector<VkAccessFlags> mergedAccess;
+        std::vector<VkImageLayout> mergedLayouts;
+        for (const Access& access : pass.accesses) {
+            UsageInfo info = GetUsageInfo(access.usage);
+            VkAccessFlags accessFlags = info.readAccess | (access.write ? info.writeAccess : 0);
+
+            auto it = std::find_if(merged.begin(), merged.end(),
+                [&](const Access& other) { return other.resource == access.resource; });
+            if (it == merged.end()) {
+                merged.push_back(access);
+                mergedStages.push_back(info.stages);
+                mergedAccess.push_back(accessFlags);
+                mergedLayouts.push_back(info.layout);
+                continue;
+            }
+
+            size_t index = it - merged.begin();
+            if (m_Resources[access.resource].isImage && mergedLayouts[index] != info.layout) {
+                throw std::runtime_error(std::string("Render graph pass ") + pass.name + " uses " +
+                                         m_Resources[access.resource].name + " in two layouts");
+            }
+            it->write = it->write || access.write;
+            mergedStages[index] |= info.stages;
+            mergedAccess[index] |= accessFlags;
+        }
+
+        for (size_t i = 0; i < merged.size(); i++) {
+            ResourceId id = merged[i].resource;
+            bool write = merged[i].write;
+            VkPipelineStageFlags stages = mergedStages[i];
+            VkAccessFlags access = mergedAccess[i];
+            VkImageLayout layout = m_Resources[id].isImage ? mergedLayouts[i] : VK_IMAGE_LAYOUT_UNDEFINED;
+            ResourceState& state = states[id];
+
+            bool transition = m_Resources[id].isImage && state.layout != layout;
+            if (write || transition) {
+                // Write-after-write and write-after-read; a layout change is a write too
+                VkPipelineStageFlags srcStages = state.writeStages | state.readStages;
+                if (srcStages != 0 || transition) {
+                    addBarrier(pass.barriers, id, srcStages, state.writeAccess, stages, access, state.layout, layout);
+                }
+                state.layout = layout;
+                if (write) {
+                    state.writeStages = stages;
+                    state.writeAccess = access & ~(VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                                                   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT);
+                    state.readStages = 0;
+                    state.visibleStages = 0;
+                    state.visibleAccess = 0;
+                } else {
+                    // Read after a transition: later readers chain off this barrier
+                    state.writeStages = stages;
+                    state.writeAccess = 0;
+                    state.readStages = stages;
+                    state.visibleStages = stages;
+                    state.visibleAccess = access;
+                }
+                continue;
+            }
+
+            // Read-after-write, unless an earlier barrier already covered these stages
+            bool covered = (stages & ~state.visibleStages) == 0 && (access & ~state.visibleAccess) == 0;
+            if (state.writeStages != 0 && !covered) {
+                addBarrier(pass.barriers, id, state.writeStages, state.writeAccess, stages, access, layout, layout);
+                state.visibleStages |= stages;
+                state.visibleAccess |= access;
+            }
+            state.readStages |= stages;
+        }
+
+        if (pass.barriers.needed) {
+            m_Stats.barrierCount++;
+            m_Stats.imageBarrierCount += static_cast<uint32_t>(pass.barriers.images.size());
+        }
+    }
+
+    m_FinalBarriers = BarrierBatch{};
+    for (ResourceId id = 0; id < m_Resources.size(); id++) {
+        const Resource& resource = m_Resources[id];
+        const ResourceState& state = states[id];
+        VkImageLayout finalLayout = resource.importState.finalLayout;
+        if (!resource.imported || !resource.isImage || finalLayout == VK_IMAGE_LAYOUT_UNDEFINED ||
+            finalLayout == state.layout) {
+            continue;
+        }
+        addBarrier(m_FinalBarriers, id, state.writeStages | state.readStages, state.writeAccess,
+                   VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, state.layout, finalLayout);
+    }
+    if (m_FinalBarriers.needed) {
+        m_Stats.barrierCount++;
+        m_Stats.imageBarrierCount += static_cast<uint32_t>(m_FinalBarriers.images.size());
+    }
+}
+
+void RenderGraph::RecordBarriers(VkCommandBuffer cmd, const BarrierBatch& batch) {
+    if (!batch.needed) {
+        return;
+    }
+
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = batch.memorySrcAccess;
+    memoryBarrier.dstAccessMask = batch.memoryDstAccess;
+    bool hasMemoryBarrier = batch.memorySrcAccess != 0;
+
+    std::vector<VkImageMemoryBarrier> imageBarriers(batch.images.size());
+    for (size_t i = 0; i < batch.images.size(); i++) {
+        const ImageBarrier& barrier = batch.images[i];
+        const Resource& resource = m_Resources[barrier.resource];
+
+        VkImageMemoryBarrier& imageBarrier = imageBarriers[i];
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = barrier.srcAccess;
+        imageBarrier.dstAccessMask = barrier.dstAccess;
+        imageBarrier.oldLayout = barrier.oldLayout;
+        imageBarrier.newLayout = barrier.newLayout;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = resource.image;
+        imageBarrier.subresourceRange = {resource.imageDesc.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+    }
+
+    // An empty source scope (nothing ran before) still needs a valid stage
+    VkPipelineStageFlags srcStages = batch.srcStages != 0 ? batch.srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    m_Context.GetDispatchTable().cmdPipelineBarrier(cmd, srcStages, batch.dstStages, 0,
+        hasMemoryBarrier ? 1 : 0, &memoryBarrier, 0, nullptr,
+        static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+void RenderGraph::Execute(VkCommandBuffer cmd, GpuProfiler& profiler, uint32_t profilerSlot) {
+    if (!m_Compiled) {
+        throw std::runtime_error("Render graph executed before Compile");
+    }
+
+    for (auto& pass : m_Passes) {
+        if (!pass.live) {
+            continue;
+        }
+        uint32_t zone = profiler.BeginZone(cmd, profilerSlot, pass.name);
+        RecordBarriers(cmd, pass.barriers);
+        pass.execute(cmd);
+        profiler.EndZone(cmd, profilerSlot, zone);
+    }
+    RecordBarriers(cmd, m_FinalBarriers);
+}
+
+void RenderGraph::DestroyTransients() {
+    // A recompile can happen with frames in flight that still use the old
+    // transients, so they are handed to the deletion queue
+    std::vector<VkImageView> views;
+    std::vector<VkImage> images;
+    std::vector<VkBuffer> buffers;
+    std::vector<Allocation> allocations;
+
+    for (auto& resource : m_Resources) {
+        if (resource.imported) {
+            continue;
+        }
+        if (resource.view != VK_NULL_HANDLE) {
+            views.push_back(resource.view);
+        }
+        if (resource.image != VK_NULL_HANDLE) {
+            images.push_back(resource.image);
+        }
+        if (resource.buffer != VK_NULL_HANDLE) {
+            buffers.push_back(resource.buffer);
+        }
+        resource.view = VK_NULL_HANDLE;
+        resource.image = VK_NULL_HANDLE;
+        resource.buffer = VK_NULL_HANDLE;
+        resource.memorySlot = UINT32_MAX;
+        resource.aliasPredecessor = UINT32_MAX;
+    }
+
+    for (auto& slot : m_MemorySlots) {
+        if (slot.allocation.memory != VK_NULL_HANDLE) {
+            allocations.push_back(slot.allocation);
+        }
+    }
+    m_MemorySlots.clear();
+
+    if (views.empty() && images.empty() && buffers.empty() && allocations.empty()) {
+        return;
+    }
+
+    VulkanContext& context = m_Context;
+    context.GetDeletionQueue().Push([&context, views = std::move(views), images = std::move(images),
+                                     buffers = std::move(buffers), allocations = std::move(allocations)]() mutable {
+        auto& disp = context.GetDispatchTable();
+        for (auto view : views) {
+            disp.destroyImageView(view, nullptr);
+        }
+        for (auto image : images) {
+            disp.destroyImage(image, nullptr);
+        }
+        for (auto buffer : buffers) {
+            disp.destroyBuffer(buffer, nullptr);
+        }
+        for (auto& allocation : allocations) {
+            context.GetAllocator().Free(allocation);
+        }
+    });
+}
@@ -0,0 +1,198 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <functional>
+#include <vector>
+#include "vulkan_context.hpp"
+#include "memory_allocator.hpp"
+#include "gpu_profiler.hpp"
+
+// How a pass touches a resource. Each usage maps to the pipeline stages,
+// access flags and, for images, the layout the resource must be in.
+enum class ResourceUsage : uint8_t {
+    ColorAttachment,
+    DepthAttachment,
+    SampledFragment,        // Sampled image or storage/uniform buffer read in the fragment shader
+    StorageReadCompute,
+    StorageWriteCompute,
+    VertexInput,            // Vertex or index buffer
+    IndirectRead,
+    TransferSrc,
+    TransferDst,
+};
+
+// Frame graph: passes declare the images and buffers they read and write,
+// and Compile works out everything in between. Passes whose results never
+// reach an output are culled, each remaining pass gets one
+// vkCmdPipelineBarrier with only the layout transitions and memory
+// dependencies it actually needs, and transient resources whose lifetimes
+// do not overlap share memory.
+//
+// Passes run in the order they were added. The graph is meant to be built
+// once and executed every frame; imported resources (the swapchain image,
+// per-frame buffers) are re-pointed with SetImported* before Execute.
+class RenderGraph {
+public:
+    using ResourceId = uint32_t;
+    using ExecuteFn = std::function<void(VkCommandBuffer cmd)>;
+
+    struct ImageDesc {
+        VkFormat format;
+        VkExtent2D extent;
+        VkImageUsageFlags usage;
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    };
+
+    struct BufferDesc {
+        VkDeviceSize size;
+        VkBufferUsageFlags usage;
+    };
+
+    // Synchronization state of an imported resource at the start of the
+    // graph (what the last user outside it did), and the layout images must
+    // be left in at the end
+    struct ImportState {
+        VkPipelineStageFlags stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        VkAccessFlags access = 0;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;     // UNDEFINED leaves it as the last pass did
+    };
+
+    class PassBuilder {
+    public:
+        void Read(ResourceId resource, ResourceUsage usage);
+        void Write(ResourceId resource, ResourceUsage usage);
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph& graph, uint32_t pass) : m_Graph(graph), m_Pass(pass) {}
+        RenderGraph& m_Graph;
+        uint32_t m_Pass;
+    };
+
+    // Valid after Compile
+    struct Stats {
+        uint32_t passCount = 0;
+        uint32_t culledPassCount = 0;
+        uint32_t barrierCount = 0;          // vkCmdPipelineBarrier calls per Execute
+        uint32_t imageBarrierCount = 0;     // Layout transitions and image dependencies within them
+        uint32_t transientCount = 0;
+        VkDeviceSize transientBytes = 0;    // Sum of transient resource sizes
+        VkDeviceSize allocatedBytes = 0;    // Memory actually allocated for them after aliasing
+    };
+
+    RenderGraph(VulkanContext& context);
+    ~RenderGraph();
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    // Drops all passes and resources. Must not be called while a command
+    // buffer that executed the graph is still pending.
+    void Reset();
+
+    ResourceId CreateImage(const char* name, const ImageDesc& desc);
+    ResourceId CreateBuffer(const char* name, const BufferDesc& desc);
+    ResourceId ImportImage(const char* name, VkImageAspectFlags aspect, const ImportState& state);
+    ResourceId ImportBuffer(const char* name, const ImportState& state = ImportState{});
+
+    void AddPass(const char* name, const std::function<void(PassBuilder&)>& setup, ExecuteFn execute);
+    // Keeps the passes that contribute to resource alive
+    void MarkOutput(ResourceId resource);
+
+    // Culls passes, plans barriers and creates and aliases the transient resources
+    void Compile();
+
+    void SetImportedImage(ResourceId resource, VkImage image, VkImageView view);
+    void SetImportedBuffer(ResourceId resource, VkBuffer buffer);
+
+    // Records the live passes with their barriers, each in a GPU profiler
+    // zone named after the pass
+    void Execute(VkCommandBuffer cmd, GpuProfiler& profiler, uint32_t profilerSlot);
+
+    VkImage GetImage(ResourceId resource) const { return m_Resources[resource].image; }
+    VkImageView GetImageView(ResourceId resource) const { return m_Resources[resource].view; }
+    VkBuffer GetBuffer(ResourceId resource) const { return m_Resources[resource].buffer; }
+    const Stats& GetStats() const { return m_Stats; }
+
+private:
+    struct Resource {
+        const char* name;
+        bool isImage = false;
+        bool imported = false;
+        ImageDesc imageDesc{};
+        BufferDesc bufferDesc{};
+        ImportState importState{};
+
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkBuffer buffer = VK_NULL_HANDLE;
+
+        // Compile results for transient resources
+        uint32_t firstPass = UINT32_MAX;    // Live passes only
+        uint32_t lastPass = 0;
+        VkMemoryRequirements requirements{};
+        uint32_t memorySlot = UINT32_MAX;
+        uint32_t aliasPredecessor = UINT32_MAX;     // Previous user of the same memory, cyclically
+        VkPipelineStageFlags lastStages = 0;        // Stages of its last use in the graph
+        VkAccessFlags lastWriteAccess = 0;          // Writes of that last use
+    };
+
+    struct Access {
+        ResourceId resource;
+        ResourceUsage usage;
+        bool write;
+    };
+
+    struct ImageBarrier {
+        ResourceId resource;
+        VkAccessFlags srcAccess;
+        VkAccessFlags dstAccess;
+        VkImageLayout oldLayout;
+        VkImageLayout newLayout;
+    };
+
+    // Everything a pass waits for, merged into one vkCmdPipelineBarrier
+    struct BarrierBatch {
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        VkAccessFlags memorySrcAccess = 0;      // Buffers share one global memory barrier
+        VkAccessFlags memoryDstAccess = 0;
+        std::vector<ImageBarrier> images;
+        bool needed = false;
+    };
+
+    struct Pass {
+        const char* name;
+        std::vector<Access> accesses;
+        ExecuteFn execute;
+        bool live = false;
+        BarrierBatch barriers;
+    };
+
+    // Memory shared by transient resources with disjoint lifetimes
+    struct MemorySlot {
+        Allocation allocation;
+        AllocationKind kind;
+        VkDeviceSize size = 0;
+        VkDeviceSize alignment = 1;
+        uint32_t memoryTypeBits = ~0u;
+        std::vector<ResourceId> occupants;      // Sorted by firstPass after Compile
+    };
+
+    VulkanContext& m_Context;
+    std::vector<Resource> m_Resources;
+    std::vector<Pass> m_Passes;
+    std::vector<ResourceId> m_Outputs;
+    std::vector<MemorySlot> m_MemorySlots;
+    BarrierBatch m_FinalBarriers;           // Imported images to their final layouts
+    Stats m_Stats;
+    bool m_Compiled = false;
+
+    void DestroyTransients();
+    void CullPasses();
+    void ComputeLifetimes();
+    void CreateTransients();
+    void AliasMemory();
+    void PlanBarriers();
+    void RecordBarriers(VkCommandBuffer cmd, const BarrierBatch& batch);
+};
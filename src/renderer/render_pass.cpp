@@ -1,18 +1,24 @@
 #include "../stdafx.h"
 #include "render_pass.hpp"
 
-RenderPass::RenderPass(VulkanContext& context, SwapChain& swapchain)
-    : m_Context(context), m_Swapchain(swapchain)
+RenderPass::RenderPass(VulkanContext& context, RenderTarget& target)
+    : m_Context(context), m_Target(target), m_ColorFormat(target.GetImageFormat())
 {
+    if (m_Context.IsDynamicRenderingEnabled()) {
+        return;
+    }
+
     VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = swapchain.GetImageFormat();
+    colorAttachment.format = target.GetImageFormat();
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // The render graph moves the image into and out of the attachment layout
+    // and owns the dependencies on either side, so the pass needs none
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment = 0;
@@ -23,22 +29,12 @@ RenderPass::RenderPass(VulkanContext& context, SwapChain& swapchain)
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &colorAttachmentRef;
 
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
     renderPassInfo.attachmentCount = 1;
     renderPassInfo.pAttachments = &colorAttachment;
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
 
     if (m_Context.GetDispatchTable().createRenderPass(&renderPassInfo, nullptr, &m_RenderPass) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create render pass");
@@ -46,5 +42,7 @@ RenderPass::RenderPass(VulkanContext& context, SwapChain& swapchain)
 }
 
 RenderPass::~RenderPass() {
-    m_Context.GetDispatchTable().destroyRenderPass(m_RenderPass, nullptr);
+    if (m_RenderPass != VK_NULL_HANDLE) {
+        m_Context.GetDispatchTable().destroyRenderPass(m_RenderPass, nullptr);
+    }
 }
@@ -1,17 +1,23 @@
 #pragma once
 #include <vulkan/vulkan_core.h>
 #include "vulkan_context.hpp"
-#include "swap_chain.hpp"
+#include "render_target.hpp"
 
+// The main pass's attachment setup. With dynamic rendering enabled there is
+// no VkRenderPass: GetHandle is null and pipelines and command buffers are
+// set up from the color format instead.
 class RenderPass {
 public:
-    RenderPass(VulkanContext& context, SwapChain& swapchain);
+    RenderPass(VulkanContext& context, RenderTarget& target);
     ~RenderPass();
 
     VkRenderPass GetHandle() const { return m_RenderPass; }
+    bool IsDynamic() const { return m_RenderPass == VK_NULL_HANDLE; }
+    VkFormat GetColorFormat() const { return m_ColorFormat; }
 
 private:
     VulkanContext& m_Context;
-    SwapChain& m_Swapchain;
-    VkRenderPass m_RenderPass;
+    RenderTarget& m_Target;
+    VkRenderPass m_RenderPass = VK_NULL_HANDLE;
+    VkFormat m_ColorFormat;
 };
\ No newline at end of file
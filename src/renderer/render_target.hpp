@@ -0,0 +1,19 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vector>
+
+// Anything the renderer can draw into: the window swapchain or the
+// headless offscreen image ring.
+class RenderTarget {
+public:
+    virtual ~RenderTarget() = default;
+
+    virtual const std::vector<VkImage>& GetImages() const = 0;
+    virtual const std::vector<VkImageView>& GetImageViews() const = 0;
+    virtual VkFormat GetImageFormat() const = 0;
+    virtual VkExtent2D GetExtent() const = 0;
+    virtual uint32_t GetImageCount() const = 0;
+
+    // Layout the color attachment is left in at the end of the render pass
+    virtual VkImageLayout GetFinalLayout() const = 0;
+};
@@ -1,124 +1,563 @@
 #include "../stdafx.h"
 #include "renderer.hpp"
 
+#include <algorithm>
 #include <imgui_internal.h>
+#include "../core/profiler.hpp"
+#include "shaders/triangle_vert_spv.h"
+#include "shaders/triangle_frag_spv.h"
 
-Renderer::Renderer(Window& window)
-    : m_Window(window),
-      m_Context(window),
-      m_Swapchain(m_Context),
-      m_RenderPass(m_Context, m_Swapchain),
-      m_Pipeline(m_Context, m_RenderPass, m_Swapchain),
-      m_Framebuffers(m_Context, m_Swapchain, m_RenderPass),
-      m_CommandManager(m_Context, m_Swapchain.GetImageCount()),
-      m_Synchronization(m_Context, m_Swapchain.GetImageCount())
+namespace {
+    const Vertex TRIANGLE_VERTICES[] = {
+        {{0.0f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+        {{0.5f, 0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}},
+        {{-0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}}
+    };
+    const uint32_t TRIANGLE_INDICES[] = {0, 1, 2};
+
+    const ShaderStages TRIANGLE_SHADERS{triangle_vert_spv, "triangle.vert", triangle_frag_spv, "triangle.frag"};
+}
+
+Renderer::Renderer(Window& window, const RendererConfig& config)
+    : m_Window(&window),
+      m_Context(window, config),
+      m_Target(std::make_unique<SwapChain>(m_Context, config.presentMode, config.swapchainImages)),
+      m_Swapchain(static_cast<SwapChain*>(m_Target.get())),
+      m_FrameTracker(m_Context, config.framesInFlight, m_Target->GetImageCount()),
+      m_RenderPass(m_Context, *m_Target),
+      m_Uniforms(m_Context, UniformRing::DEFAULT_CAPACITY_PER_FRAME, m_FrameTracker.GetFrameCount()),
+      m_Pipeline(m_Context, m_RenderPass, *m_Target, TRIANGLE_SHADERS, Vertex::GetLayout(), {m_Uniforms.GetSetLayout()}),
+      m_Framebuffers(m_Context, *m_Target, m_RenderPass),
+      m_GpuProfiler(m_Context, m_FrameTracker.GetFrameCount()),
+      m_Staging(m_Context),
+      m_Uploads(m_Context),
+      m_Textures(m_Context, m_FrameTracker.GetFrameCount(), VkDeviceSize(config.textureBudgetMB) << 20),
+      m_Mesh(m_Context, m_Staging, TRIANGLE_VERTICES, TRIANGLE_INDICES),
+      m_Jobs(config.workerThreads),
+      m_CommandManager(m_Context, m_FrameTracker.GetFrameCount(), m_Jobs.GetThreadCount()),
+      m_Descriptors(m_Context, m_Jobs, m_FrameTracker.GetFrameCount()),
+      m_Graph(m_Context)
 {
-    // Record initial command buffers
-    m_CommandManager.RecordCommands(
-        m_Swapchain,
-        m_RenderPass,
-        m_Framebuffers,
-        m_Pipeline
-    );
+    m_LowLatency = config.lowLatency && m_Context.IsPresentWaitEnabled();
+    if (config.lowLatency && !m_LowLatency) {
+        std::cout << "VK_KHR_present_wait not available, low-latency mode disabled" << std::endl;
+    }
+    CreateOptionalPaths();
+    BuildFrameGraph();
+}
+
+Renderer::Renderer(uint32_t width, uint32_t height, const RendererConfig& config)
+    : m_Window(nullptr),
+      m_Context(config),
+      m_Target(std::make_unique<OffscreenTarget>(m_Context, VkExtent2D{width, height}, OFFSCREEN_IMAGE_COUNT)),
+      m_Swapchain(nullptr),
+      m_FrameTracker(m_Context, config.framesInFlight, m_Target->GetImageCount()),
+      m_RenderPass(m_Context, *m_Target),
+      m_Uniforms(m_Context, UniformRing::DEFAULT_CAPACITY_PER_FRAME, m_FrameTracker.GetFrameCount()),
+      m_Pipeline(m_Context, m_RenderPass, *m_Target, TRIANGLE_SHADERS, Vertex::GetLayout(), {m_Uniforms.GetSetLayout()}),
+      m_Framebuffers(m_Context, *m_Target, m_RenderPass),
+      m_GpuProfiler(m_Context, m_FrameTracker.GetFrameCount()),
+      m_Staging(m_Context),
+      m_Uploads(m_Context),
+      m_Textures(m_Context, m_FrameTracker.GetFrameCount(), VkDeviceSize(config.textureBudgetMB) << 20),
+      m_Mesh(m_Context, m_Staging, TRIANGLE_VERTICES, TRIANGLE_INDICES),
+      m_Jobs(config.workerThreads),
+      m_CommandManager(m_Context, m_FrameTracker.GetFrameCount(), m_Jobs.GetThreadCount()),
+      m_Descriptors(m_Context, m_Jobs, m_FrameTracker.GetFrameCount()),
+      m_Graph(m_Context)
+{
+    CreateOptionalPaths();
+    BuildFrameGraph();
 }
 
 Renderer::~Renderer() {
     // Resources are cleaned up in reverse order of creation via destructors
 }
 
+// Paths whose shaders or device features may be missing; the renderer
+// falls back to one draw call per visible draw without them
+void Renderer::CreateOptionalPaths() {
+    if (GpuScene::IsSupported(m_Context)) {
+        m_GpuScene = std::make_unique<GpuScene>(m_Context, m_Staging, m_Descriptors, m_RenderPass, *m_Target,
+                                                m_Uniforms.GetSetLayout(), GpuScene::DEFAULT_MAX_OBJECTS,
+                                                m_FrameTracker.GetFrameCount());
+
+        // Culling then runs on the compute queue; its timestamps are placed
+        // relative to the graphics ones so the overlap shows in traces
+        if (AsyncCompute::IsSupported(m_Context)) {
+            m_AsyncCompute = std::make_unique<AsyncCompute>(m_Context, m_FrameTracker.GetFrameCount());
+            m_ComputeProfiler = std::make_unique<GpuProfiler>(m_Context, m_FrameTracker.GetFrameCount(),
+                                                              m_Context.GetComputeQueueIndex(),
+                                                              ProfileTrack::GpuCompute, &m_GpuProfiler);
+        }
+    }
+    if (BindlessTable::IsSupported(m_Context)) {
+        m_Bindless = std::make_unique<BindlessTable>(m_Context, m_FrameTracker.GetFrameCount());
+        m_Textures.SetBindless(m_Bindless.get());
+    }
+    if (InstanceBatcher::IsSupported()) {
+        m_Instancer = std::make_unique<InstanceBatcher>(m_Context, m_RenderPass, *m_Target, m_Uniforms.GetSetLayout(),
+                                                        m_Bindless.get(), InstanceBatcher::DEFAULT_CAPACITY_PER_FRAME,
+                                                        m_FrameTracker.GetFrameCount());
+    }
+}
+
+// The frame's passes and what they touch; the graph works out the barriers
+// and layout transitions between them. Rebuilt when the target changes.
+void Renderer::BuildFrameGraph() {
+    m_Graph.Reset();
+
+    // The acquire semaphore is waited on at COLOR_ATTACHMENT_OUTPUT, and the
+    // previous contents are cleared anyway
+    RenderGraph::ImportState backbufferState{};
+    backbufferState.stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    backbufferState.finalLayout = m_Target->GetFinalLayout();
+    m_Backbuffer = m_Graph.ImportImage("Backbuffer", VK_IMAGE_ASPECT_COLOR_BIT, backbufferState);
+
+    // With async compute the buffers arrive from the compute queue through
+    // an ownership acquire recorded ahead of the graph, so only the main
+    // pass sees them here
+    if (m_GpuScene) {
+        m_GpuDrawCommands = m_Graph.ImportBuffer("GpuDrawCommands");
+        m_GpuDrawCounts = m_Graph.ImportBuffer("GpuDrawCounts");
+    }
+    if (m_GpuScene && !m_AsyncCompute) {
+        m_Graph.AddPass("GpuCull",
+            [&](RenderGraph::PassBuilder& pass) {
+                pass.Write(m_GpuDrawCommands, ResourceUsage::StorageWriteCompute);
+                pass.Write(m_GpuDrawCounts, ResourceUsage::StorageWriteCompute);
+            },
+            [this](VkCommandBuffer cmd) {
+                if (m_Frame.gpuDriven) {
+                    m_GpuScene->RecordCull(cmd, m_Frame.frameIndex, m_Frame.frustum);
+                }
+            });
+    }
+
+    m_Graph.AddPass("MainPass",
+        [&](RenderGraph::PassBuilder& pass) {
+            pass.Write(m_Backbuffer, ResourceUsage::ColorAttachment);
+            if (m_GpuScene) {
+                pass.Read(m_GpuDrawCommands, ResourceUsage::IndirectRead);
+                pass.Read(m_GpuDrawCounts, ResourceUsage::IndirectRead);
+            }
+        },
+        [this](VkCommandBuffer cmd) {
+            m_CommandManager.RecordMainPass(cmd, m_Frame.frameIndex, m_Frame.imageIndex, *m_Target, m_RenderPass,
+                                            m_Framebuffers);
+        });
+
+    m_Graph.MarkOutput(m_Backbuffer);
+    m_Graph.Compile();
+}
+
 void Renderer::WaitIdle() {
     m_Context.GetDispatchTable().deviceWaitIdle();
 }
 
 int Renderer::RecreateSwapchain() {
-    WaitIdle();
-    
-    // Recreate necessary components
-    m_Swapchain.Recreate();
+    JB_PROFILE_ZONE("RecreateSwapchain");
+
+    // No device idle: the old swapchain, framebuffers and present semaphores
+    // go through the deletion queue while frames in flight finish with them
+    m_Swapchain->Recreate();
     m_Framebuffers.Recreate();
-    m_CommandManager.RecordCommands(
-        m_Swapchain,
+    m_FrameTracker.OnImageCountChanged(m_Target->GetImageCount());
+    BuildFrameGraph();
+
+    // Present ids belong to the old swapchain and can no longer be waited on
+    m_LastPresentId = 0;
+    m_PendingLatency.clear();
+    
+    return 0;
+}
+
+void Renderer::PaceFrame() {
+    if (!m_LowLatency || m_LastPresentId == 0) {
+        return;
+    }
+
+    // Waiting for the present rather than for a free frame slot keeps the
+    // queue of finished frames ahead of the display at zero. A timeout or an
+    // out-of-date swapchain just lets the frame start early.
+    JB_PROFILE_ZONE("WaitForPresent");
+    m_Context.GetDispatchTable().waitForPresentKHR(m_Swapchain->GetHandle(), m_LastPresentId, PRESENT_WAIT_TIMEOUT_NS);
+}
+
+void Renderer::MarkInput() {
+    m_InputTime = Clock::now();
+    m_InputMarked = true;
+}
+
+void Renderer::DrainLatencySamples(std::vector<double>& samples) {
+    CollectLatency();
+    samples.insert(samples.end(), m_LatencySamples.begin(), m_LatencySamples.end());
+    m_LatencySamples.clear();
+}
+
+void Renderer::OnFrameSubmitted(uint64_t frame) {
+    if (!m_InputMarked) {
+        return;
+    }
+    m_InputMarked = false;
+
+    // Frames that never complete (e.g. presents timing out while minimized)
+    // are dropped rather than piling up
+    if (m_PendingLatency.size() == MAX_PENDING_LATENCY) {
+        m_PendingLatency.pop_front();
+    }
+    m_PendingLatency.push_back({frame, m_InputTime});
+}
+
+void Renderer::CollectLatency() {
+    auto& disp = m_Context.GetDispatchTable();
+    bool toPresent = IsLatencyToPresent();
+
+    while (!m_PendingLatency.empty()) {
+        const PendingLatency& pending = m_PendingLatency.front();
+        bool measured;
+        if (toPresent) {
+            // A zero timeout polls; errors mean the present was never shown
+            VkResult result = disp.waitForPresentKHR(m_Swapchain->GetHandle(), pending.frame, 0);
+            if (result == VK_TIMEOUT) {
+                break;
+            }
+            measured = result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR;
+        } else {
+            if (!m_FrameTracker.IsFrameComplete(pending.frame)) {
+                break;
+            }
+            measured = true;
+        }
+
+        // Polled once per frame, so a sample can be late by up to the time
+        // between polls
+        if (measured) {
+            if (m_LatencySamples.size() == MAX_LATENCY_SAMPLES) {
+                m_LatencySamples.erase(m_LatencySamples.begin());
+            }
+            m_LatencySamples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - pending.input).count());
+        }
+        m_PendingLatency.pop_front();
+    }
+}
+
+void Renderer::UpdateCamera(Camera& camera) {
+    m_Textures.SetView(camera, GetExtent().height);
+    if (!camera.updated) {
+        return;
+    }
+
+    m_CameraData.projection = camera.matrices.perspective;
+    m_CameraData.view = camera.matrices.view;
+    m_CameraDirtyFrames = m_FrameTracker.GetFrameCount();
+    camera.updated = false;
+}
+
+void Renderer::SubmitDraw(const Mesh& mesh, const glm::mat4& model, const glm::vec4& color, const glm::vec4& custom,
+                          BindlessTable::Handle texture) {
+    m_DrawList.push_back({&mesh, model, color, custom, texture});
+}
+
+std::span<const uint32_t> Renderer::CullDraws(const Frustum& frustum) {
+    JB_PROFILE_ZONE("Cull");
+
+    uint32_t drawCount = static_cast<uint32_t>(m_DrawList.size());
+    m_Culler.Resize(drawCount);
+
+    // Mesh bounds to world space: the box through |M| (Arvo), the sphere
+    // scaled by the largest axis scale
+    m_Jobs.ParallelFor(drawCount, FrustumCuller::BATCH_SIZE, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            const DrawItem& draw = m_DrawList[i];
+            const glm::mat4& m = draw.model;
+            glm::vec3 center = glm::vec3(m * glm::vec4(draw.mesh->GetBoundsCenter(), 1.0f));
+            glm::vec3 extents = draw.mesh->GetBoundsExtents();
+            glm::vec3 worldExtents(
+                std::abs(m[0][0]) * extents.x + std::abs(m[1][0]) * extents.y + std::abs(m[2][0]) * extents.z,
+                std::abs(m[0][1]) * extents.x + std::abs(m[1][1]) * extents.y + std::abs(m[2][1]) * extents.z,
+                std::abs(m[0][2]) * extents.x + std::abs(m[1][2]) * extents.y + std::abs(m[2][2]) * extents.z);
+            float scale = std::max({glm::length(glm::vec3(m[0])), glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))});
+            m_Culler.SetBounds(i, center, worldExtents, draw.mesh->GetBoundsRadius() * scale);
+        }
+    });
+
+    return m_Culler.Cull(frustum, m_Jobs);
+}
+
+void Renderer::RecordFrame(uint32_t frameIndex, uint32_t imageIndex) {
+    JB_PROFILE_ZONE("Record");
+
+    // The frame's previous submission is complete, so its timestamps can be
+    // read back without blocking, its uniform slot rewritten and its
+    // descriptor pools reset
+    m_GpuProfiler.Resolve(frameIndex);
+    if (m_ComputeProfiler) {
+        m_ComputeProfiler->Resolve(frameIndex);
+    }
+    // Without instancing every draw pushes its own ObjectUniforms, so the
+    // ring is grown up front instead of running out mid-recording. A grown
+    // ring holds no camera data yet.
+    if (!m_Instancer) {
+        VkDeviceSize drawCount = std::max<size_t>(m_DrawList.size(), 1);
+        if (m_Uniforms.Reserve(m_Uniforms.GetAllocationSize(sizeof(CameraUniforms)) +
+                               drawCount * m_Uniforms.GetAllocationSize(sizeof(ObjectUniforms)))) {
+            m_CameraDirtyFrames = m_FrameTracker.GetFrameCount();
+        }
+    }
+    m_Uniforms.BeginFrame(frameIndex);
+    m_Descriptors.BeginFrame(frameIndex);
+
+    // The camera block is always the frame's first allocation, so a slot that
+    // already holds the current matrices can be left untouched
+    uint32_t cameraOffset = m_Uniforms.Push(m_CameraDirtyFrames > 0 ? &m_CameraData : nullptr, sizeof(CameraUniforms));
+    if (m_CameraDirtyFrames > 0) {
+        m_CameraDirtyFrames--;
+    }
+
+    bool gpuDriven = m_GpuScene && m_GpuScene->GetObjectCount() > 0;
+    if (m_DrawList.empty() && !gpuDriven) {
+        m_DrawList.push_back({&m_Mesh, glm::mat4(1.0f), glm::vec4(1.0f), glm::vec4(0.0f)});
+    }
+
+    m_Frame.frameIndex = frameIndex;
+    m_Frame.imageIndex = imageIndex;
+    m_Frame.frustum = Frustum::FromMatrix(m_CameraData.projection * m_CameraData.view);
+    m_Frame.gpuDriven = gpuDriven;
+    std::span<const uint32_t> visible = CullDraws(m_Frame.frustum);
+    m_VisibleDrawCount = static_cast<uint32_t>(visible.size());
+
+    auto& disp = m_Context.GetDispatchTable();
+    VkPipelineLayout layout = m_Pipeline.GetLayout();
+    VkDescriptorSet descriptorSet = m_Uniforms.GetSet();
+
+    // GPU scene: upload what changed; the graph's GpuCull pass (or the
+    // compute queue) culls it and the main pass draws everything from one
+    // extra secondary
+    CommandManager::RecordCommandsFn recordGpuDraws;
+    if (gpuDriven) {
+        m_GpuScene->Upload();
+        if (m_AsyncCompute) {
+            RecordAsyncCull(frameIndex);
+        }
+        recordGpuDraws = [&](VkCommandBuffer cmd) {
+            m_GpuScene->RecordDraws(cmd, frameIndex, descriptorSet, cameraOffset);
+        };
+    }
+
+    // Instancing turns the visible draws into one draw call per mesh, so the
+    // ranges handed to the recording jobs are batches rather than draws
+    if (m_Instancer) {
+        JB_PROFILE_ZONE("Batch");
+        m_Instancer->BeginFrame(frameIndex);
+        m_Instancer->Build(m_DrawList, visible, m_Jobs);
+        m_DrawCallCount = m_Instancer->GetBatchCount();
+    } else {
+        m_DrawCallCount = m_VisibleDrawCount;
+    }
+
+    m_CommandManager.RecordSecondaries(
+        frameIndex,
+        imageIndex,
+        *m_Target,
         m_RenderPass,
         m_Framebuffers,
-        m_Pipeline
+        m_Instancer ? m_Instancer->GetPipeline() : m_Pipeline,
+        m_Jobs,
+        m_DrawCallCount,
+        [&](VkCommandBuffer cmd, uint32_t begin, uint32_t end) {
+            if (m_Instancer) {
+                m_Instancer->RecordBatches(cmd, begin, end, descriptorSet, cameraOffset);
+                return;
+            }
+
+            const Mesh* boundMesh = nullptr;
+            for (uint32_t i = begin; i < end; i++) {
+                const DrawItem& draw = m_DrawList[visible[i]];
+
+                uint32_t dynamicOffsets[] = {cameraOffset, m_Uniforms.Push(ObjectUniforms{draw.model})};
+                disp.cmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &descriptorSet,
+                                           2, dynamicOffsets);
+
+                if (draw.mesh != boundMesh) {
+                    VkBuffer vertexBuffers[] = {draw.mesh->GetVertexBuffer()};
+                    VkDeviceSize offsets[] = {0};
+                    disp.cmdBindVertexBuffers(cmd, 0, 1, vertexBuffers, offsets);
+                    disp.cmdBindIndexBuffer(cmd, draw.mesh->GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+                    boundMesh = draw.mesh;
+                }
+                disp.cmdDrawIndexed(cmd, draw.mesh->GetIndexCount(), 1, 0, 0, 0);
+            }
+        },
+        recordGpuDraws
     );
-    
-    return 0;
+
+    m_Graph.SetImportedImage(m_Backbuffer, m_Target->GetImages()[imageIndex], m_Target->GetImageViews()[imageIndex]);
+    if (m_GpuScene) {
+        m_Graph.SetImportedBuffer(m_GpuDrawCommands, m_GpuScene->GetCommandBuffer(frameIndex));
+        m_Graph.SetImportedBuffer(m_GpuDrawCounts, m_GpuScene->GetCountBuffer(frameIndex));
+    }
+
+    VkCommandBuffer cmd = m_CommandManager.BeginPrimary(frameIndex);
+    m_GpuProfiler.BeginRecording(cmd, frameIndex);
+
+    // Streamed resources that have landed (or that this frame requires) join
+    // the graphics queue here; the submit waits on exactly their upload
+    uint64_t uploadValue = m_Uploads.RecordAcquires(cmd, m_RequiredUpload);
+    m_RequiredUpload = 0;
+    if (uploadValue != 0) {
+        m_FrameTracker.AddWait(m_Uploads.GetTimeline(), uploadValue, UploadService::CONSUMER_STAGES);
+    }
+    if (m_Frame.asyncCull) {
+        m_GpuScene->RecordAcquire(cmd, frameIndex, *m_AsyncCompute);
+    }
+    m_Textures.RecordUpdates(cmd, frameIndex);
+    // The secondaries bound this slot's set already; update-after-bind lets
+    // the new views land before the submit
+    if (m_Bindless) {
+        m_Bindless->Flush(frameIndex);
+    }
+    uint32_t frameZone = m_GpuProfiler.BeginZone(cmd, frameIndex, "Frame");
+    m_Graph.Execute(cmd, m_GpuProfiler, frameIndex);
+    m_GpuProfiler.EndZone(cmd, frameIndex, frameZone);
+    m_CommandManager.EndPrimary(frameIndex);
+
+    m_DrawList.clear();
+}
+
+void Renderer::RecordAsyncCull(uint32_t frameIndex) {
+    VkCommandBuffer cmd = m_AsyncCompute->Begin(frameIndex);
+    m_ComputeProfiler->BeginRecording(cmd, frameIndex);
+    uint32_t zone = m_ComputeProfiler->BeginZone(cmd, frameIndex, "GpuCull");
+    m_GpuScene->RecordCull(cmd, frameIndex, m_Frame.frustum);
+    m_ComputeProfiler->EndZone(cmd, frameIndex, zone);
+    m_GpuScene->RecordRelease(cmd, frameIndex, *m_AsyncCompute);
+    m_Frame.asyncCull = true;
+}
+
+// Between the staging flush and the frame's submit: culling reads the
+// objects the flush just wrote, the next flush must not overwrite them
+// while culling still runs, and the draws wait for its results
+void Renderer::SubmitAsyncCompute() {
+    if (!m_Frame.asyncCull) {
+        return;
+    }
+    m_Frame.asyncCull = false;
+
+    if (m_Staging.GetSubmittedValue() != 0) {
+        m_AsyncCompute->AddWait(m_Staging.GetTimeline(), m_Staging.GetSubmittedValue(),
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+    uint64_t value = m_AsyncCompute->Submit(m_Frame.frameIndex);
+    m_ComputeProfiler->OnSubmit(m_Frame.frameIndex, Profiler::Get().GetFrameIndex());
+
+    m_Staging.AddWait(m_AsyncCompute->GetTimeline(), value);
+    m_FrameTracker.AddWait(m_AsyncCompute->GetTimeline(), value, GpuScene::CONSUMER_STAGES);
 }
 
 void Renderer::DrawFrame() {
+    if (IsHeadless()) {
+        DrawFrameHeadless();
+        return;
+    }
+
     auto& disp = m_Context.GetDispatchTable();
-    auto currentFrame = m_Synchronization.GetCurrentFrame();
-    auto& inFlightFences = m_Synchronization.GetInFlightFences();
-    auto& imageInFlightFences = m_Synchronization.GetImageInFlightFences();
-    auto& availableSemaphores = m_Synchronization.GetAvailableSemaphores();
-    auto& finishedSemaphores = m_Synchronization.GetFinishedSemaphores();
-    
-    disp.waitForFences(1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    CollectLatency();
+    m_FrameTracker.BeginFrame();
+    m_Uploads.Update();
     
     uint32_t imageIndex;
-    VkResult result = disp.acquireNextImageKHR(
-        m_Swapchain.GetHandle(), 
-        UINT64_MAX, 
-        availableSemaphores[currentFrame], 
-        VK_NULL_HANDLE, 
-        &imageIndex
-    );
+    VkResult result;
+    {
+        JB_PROFILE_ZONE("Acquire");
+        result = disp.acquireNextImageKHR(
+            m_Swapchain->GetHandle(), 
+            UINT64_MAX, 
+            m_FrameTracker.GetAcquireSemaphore(), 
+            VK_NULL_HANDLE, 
+            &imageIndex
+        );
+    }
     
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         RecreateSwapchain();
+        m_DrawList.clear();
         return;
     } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
         throw std::runtime_error("Failed to acquire swapchain image");
     }
     
-    if (imageInFlightFences[imageIndex] != VK_NULL_HANDLE) {
-        disp.waitForFences(1, &imageInFlightFences[imageIndex], VK_TRUE, UINT64_MAX);
-    }
-    imageInFlightFences[imageIndex] = inFlightFences[currentFrame];
-    
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    
-    VkSemaphore waitSemaphores[] = {availableSemaphores[currentFrame]};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
-    
-    auto& commandBuffers = m_CommandManager.GetBuffers();
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
-    
-    VkSemaphore signalSemaphores[] = {finishedSemaphores[currentFrame]};
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
-    
-    disp.resetFences(1, &inFlightFences[currentFrame]);
+    m_FrameTracker.BeginImage(imageIndex);
+    uint32_t frameIndex = m_FrameTracker.GetFrameIndex();
+    RecordFrame(frameIndex, imageIndex);
+
+    // Copies queued since the last frame go out in one submit ahead of the draw
+    m_Staging.Flush();
+    SubmitAsyncCompute();
     
-    // Submit to the graphics queue passing a wait fence
-    if (disp.queueSubmit(m_Context.GetGraphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to submit draw command buffer");
+    // Frame numbers double as present ids: unique and increasing
+    uint64_t frameNumber = m_FrameTracker.GetFrameNumber();
+    {
+        JB_PROFILE_ZONE("Submit");
+        m_GpuProfiler.OnSubmit(frameIndex, Profiler::Get().GetFrameIndex());
+        m_FrameTracker.Submit(m_CommandManager.GetBuffers()[frameIndex], imageIndex, true);
     }
     
+    VkSemaphore presentSemaphore = m_FrameTracker.GetPresentSemaphore(imageIndex);
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+
+    VkPresentIdKHR presentId{};
+    presentId.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    presentId.swapchainCount = 1;
+    presentId.pPresentIds = &frameNumber;
+    if (m_Context.IsPresentWaitEnabled()) {
+        presentInfo.pNext = &presentId;
+    }
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
+    presentInfo.pWaitSemaphores = &presentSemaphore;
     
-    VkSwapchainKHR swapchains[] = {m_Swapchain.GetHandle()};
+    VkSwapchainKHR swapchains[] = {m_Swapchain->GetHandle()};
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = swapchains;
     presentInfo.pImageIndices = &imageIndex;
     
-    result = disp.queuePresentKHR(m_Context.GetPresentQueue(), &presentInfo);
+    {
+        JB_PROFILE_ZONE("Present");
+        result = disp.queuePresentKHR(m_Context.GetPresentQueue(), &presentInfo);
+    }
+
+    if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+        m_LastPresentId = m_Context.IsPresentWaitEnabled() ? frameNumber : 0;
+        OnFrameSubmitted(frameNumber);
+    }
     
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
         RecreateSwapchain();
     } else if (result != VK_SUCCESS) {
         throw std::runtime_error("Failed to present swapchain image");
     }
-    
-    // Select the next frame to render to, based on the max. no. of concurrent frames
-    m_Synchronization.NextFrame();
+}
+
+void Renderer::DrawFrameHeadless() {
+    CollectLatency();
+    m_FrameTracker.BeginFrame();
+    m_Uploads.Update();
+
+    // No acquire: walk the offscreen ring in order
+    uint32_t imageIndex = m_OffscreenIndex;
+    m_OffscreenIndex = (m_OffscreenIndex + 1) % m_Target->GetImageCount();
+
+    m_FrameTracker.BeginImage(imageIndex);
+    uint32_t frameIndex = m_FrameTracker.GetFrameIndex();
+    RecordFrame(frameIndex, imageIndex);
+    m_Staging.Flush();
+    SubmitAsyncCompute();
+
+    {
+        JB_PROFILE_ZONE("Submit");
+        m_GpuProfiler.OnSubmit(frameIndex, Profiler::Get().GetFrameIndex());
+        m_FrameTracker.Submit(m_CommandManager.GetBuffers()[frameIndex], imageIndex, false);
+    }
+    OnFrameSubmitted(m_FrameTracker.GetFrameNumber() - 1);
 }
@@ -3,32 +3,196 @@
 #include "../stdafx.h"
 
 #pragma once
+#include <algorithm>
+#include <deque>
+#include "renderer_config.hpp"
 #include "vulkan_context.hpp"
+#include "pipeline_cache.hpp"
 #include "swap_chain.hpp"
+#include "offscreen_target.hpp"
 #include "render_pass.hpp"
 #include "shader_module.hpp"
 #include "pipeline.hpp"
 #include "framebuffer.hpp"
+#include "gpu_profiler.hpp"
+#include "staging_ring.hpp"
+#include "upload_service.hpp"
+#include "texture_streamer.hpp"
+#include "uniform_ring.hpp"
+#include "mesh.hpp"
+#include "gpu_scene.hpp"
+#include "async_compute.hpp"
+#include "bindless_table.hpp"
+#include "instance_batcher.hpp"
 #include "command_manager.hpp"
-#include "synchronization.hpp"
+#include "descriptor_allocator.hpp"
+#include "render_graph.hpp"
+#include "frame_tracker.hpp"
+#include "../core/job_system.hpp"
+#include "../scene/camera.hpp"
+#include "../scene/frustum_culler.hpp"
 
 class Renderer {
 public:
-    Renderer(Window& window);
+    Renderer(Window& window, const RendererConfig& config = RendererConfig{});
+    // Headless renderer drawing into an offscreen image ring
+    Renderer(uint32_t width, uint32_t height, const RendererConfig& config = RendererConfig{});
     ~Renderer();
 
+    // Copies the camera matrices when camera.updated is set, then clears it
+    void UpdateCamera(Camera& camera);
+    // Queues a draw for the next DrawFrame. Draws outside the camera frustum
+    // are culled, and the rest are instanced per mesh when the build has
+    // instanced.vert (color and custom are only used then). texture is a
+    // bindless image handle, sampled only when IsBindless. With nothing
+    // queued the default mesh is drawn once at the origin.
+    void SubmitDraw(const Mesh& mesh, const glm::mat4& model, const glm::vec4& color = glm::vec4(1.0f),
+                    const glm::vec4& custom = glm::vec4(0.0f),
+                    BindlessTable::Handle texture = BindlessTable::INVALID_HANDLE);
     void DrawFrame();
     void WaitIdle();
 
+    // Low-latency mode: blocks until the last submitted frame has been
+    // presented, so the caller polls input and records as late as possible.
+    // Call before polling input; a no-op otherwise.
+    void PaceFrame();
+    // Stamps the input the next DrawFrame will render; latency is measured
+    // from here to present (or to GPU completion without present wait)
+    void MarkInput();
+    // Moves the input-to-present latencies (ms) measured since the last call
+    // into samples; only the latest MAX_LATENCY_SAMPLES are kept in between
+    void DrainLatencySamples(std::vector<double>& samples);
+
+    bool IsHeadless() const { return m_Window == nullptr; }
+    VkExtent2D GetExtent() const { return m_Target->GetExtent(); }
+    uint32_t GetImageCount() const { return m_Target->GetImageCount(); }
+    const VulkanContext& GetContext() const { return m_Context; }
+    StagingRing& GetStaging() { return m_Staging; }
+    // Streams new resources in on the transfer queue; the frame picks them up
+    // once their copies have completed
+    UploadService& GetUploads() { return m_Uploads; }
+    // Makes the next frame wait on the GPU for ticket, for a resource it
+    // cannot draw without
+    void RequireUpload(UploadService::Ticket ticket) { m_RequiredUpload = std::max(m_RequiredUpload, ticket); }
+    // KTX2 textures whose mips stream in from their on-screen size; Touch
+    // the ones drawn each frame before DrawFrame
+    TextureStreamer& GetTextures() { return m_Textures; }
+    const Mesh& GetDefaultMesh() const { return m_Mesh; }
+    JobSystem& GetJobs() { return m_Jobs; }
+    // Descriptor sets that last until their frame slot comes around again,
+    // for bindings that do not go through the bindless table (GpuScene's
+    // culling sets, for one). Reset at the start of each frame's recording.
+    DescriptorAllocator& GetDescriptors() { return m_Descriptors; }
+    uint32_t GetWorkerThreadCount() const { return m_Jobs.GetThreadCount(); }
+    const FrustumCuller& GetCuller() const { return m_Culler; }
+    uint32_t GetVisibleDrawCount() const { return m_VisibleDrawCount; }
+    // Draw calls recorded for the submitted draws last frame; below the
+    // visible count when instancing merged them
+    uint32_t GetDrawCallCount() const { return m_DrawCallCount; }
+    bool IsInstancing() const { return m_Instancer != nullptr; }
+    // Instanced draws sample textures by handle from one descriptor set.
+    // Streamed textures are registered in it (TextureStreamer::GetHandle).
+    bool IsBindless() const { return m_Instancer && m_Instancer->IsBindless(); }
+    // Null without descriptor indexing or bindless.frag
+    BindlessTable* GetBindless() { return m_Bindless.get(); }
+    // Persistent objects culled and drawn on the GPU alongside the submitted
+    // draws. Null when the device or the build does not support it.
+    GpuScene* GetGpuScene() { return m_GpuScene.get(); }
+    // GPU scene culling runs on the compute queue, overlapping the graphics
+    // submission up to its indirect draws
+    bool IsAsyncCompute() const { return m_AsyncCompute != nullptr; }
+    // Frame numbers and waits on the GPU timeline, e.g. to know when
+    // resources used by a given frame can be released
+    FrameTracker& GetFrameTracker() { return m_FrameTracker; }
+    uint32_t GetFramesInFlight() const { return m_FrameTracker.GetFrameCount(); }
+    const RenderGraph::Stats& GetRenderGraphStats() const { return m_Graph.GetStats(); }
+    // FIFO when headless
+    VkPresentModeKHR GetPresentMode() const {
+        return m_Swapchain ? m_Swapchain->GetPresentMode() : VK_PRESENT_MODE_FIFO_KHR;
+    }
+    bool IsLowLatency() const { return m_LowLatency; }
+    // Latency samples end at the actual present rather than GPU completion
+    bool IsLatencyToPresent() const { return m_Swapchain && m_Context.IsPresentWaitEnabled(); }
+
 private:
-    Window& m_Window;
+    static constexpr uint32_t OFFSCREEN_IMAGE_COUNT = 3;
+    // Bounds PaceFrame's wait, e.g. while the window is occluded
+    static constexpr uint64_t PRESENT_WAIT_TIMEOUT_NS = 100'000'000;
+    static constexpr size_t MAX_PENDING_LATENCY = 64;
+    // Samples kept until DrainLatencySamples, oldest dropped first
+    static constexpr size_t MAX_LATENCY_SAMPLES = 1024;
+
+    using Clock = std::chrono::steady_clock;
+
+    Window* m_Window;
     VulkanContext m_Context;
-    SwapChain m_Swapchain;
+    std::unique_ptr<RenderTarget> m_Target;
+    SwapChain* m_Swapchain;             // Null when headless
+    FrameTracker m_FrameTracker;
     RenderPass m_RenderPass;
+    UniformRing m_Uniforms;
     Pipeline m_Pipeline;
     Framebuffer m_Framebuffers;
+    GpuProfiler m_GpuProfiler;
+    StagingRing m_Staging;
+    UploadService m_Uploads;
+    TextureStreamer m_Textures;
+    Mesh m_Mesh;
+    JobSystem m_Jobs;
     CommandManager m_CommandManager;
-    Synchronization m_Synchronization;
+    DescriptorAllocator m_Descriptors;
+    std::unique_ptr<GpuScene> m_GpuScene;
+    std::unique_ptr<AsyncCompute> m_AsyncCompute;     // Null without a separate compute family
+    std::unique_ptr<GpuProfiler> m_ComputeProfiler;   // Timestamps on the compute queue
+    std::unique_ptr<BindlessTable> m_Bindless;        // Null without descriptor indexing
+    std::unique_ptr<InstanceBatcher> m_Instancer;     // Null without instanced.vert
+    RenderGraph m_Graph;
+
+    RenderGraph::ResourceId m_Backbuffer = 0;
+    RenderGraph::ResourceId m_GpuDrawCommands = 0;
+    RenderGraph::ResourceId m_GpuDrawCounts = 0;
+
+    // What the graph's pass callbacks need from the frame being recorded
+    struct FrameContext {
+        uint32_t frameIndex = 0;
+        uint32_t imageIndex = 0;
+        Frustum frustum{};
+        bool gpuDriven = false;
+        bool asyncCull = false;         // Culling recorded on the compute queue, waiting for SubmitAsyncCompute
+    };
+    FrameContext m_Frame;
+
+    uint32_t m_OffscreenIndex = 0;
+    UploadService::Ticket m_RequiredUpload = 0;
+    std::vector<DrawItem> m_DrawList;
+    FrustumCuller m_Culler;
+    uint32_t m_VisibleDrawCount = 0;
+    uint32_t m_DrawCallCount = 0;
+
+    CameraUniforms m_CameraData{glm::mat4(1.0f), glm::mat4(1.0f)};
+    uint32_t m_CameraDirtyFrames = MAX_FRAMES_IN_FLIGHT;   // Frame slots still holding stale camera data
+
+    // Frames whose input was stamped, oldest first, waiting for their
+    // present. Present ids are the frame numbers.
+    struct PendingLatency {
+        uint64_t frame;
+        Clock::time_point input;
+    };
+    bool m_LowLatency = false;
+    bool m_InputMarked = false;
+    Clock::time_point m_InputTime{};
+    uint64_t m_LastPresentId = 0;       // 0 when nothing was presented on the current swapchain
+    std::deque<PendingLatency> m_PendingLatency;
+    std::vector<double> m_LatencySamples;
 
     int RecreateSwapchain();
+    void RecordFrame(uint32_t frameIndex, uint32_t imageIndex);
+    void CreateOptionalPaths();
+    void BuildFrameGraph();
+    std::span<const uint32_t> CullDraws(const Frustum& frustum);
+    void RecordAsyncCull(uint32_t frameIndex);
+    void SubmitAsyncCompute();
+    void DrawFrameHeadless();
+    void OnFrameSubmitted(uint64_t frame);
+    void CollectLatency();
 };
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vulkan/vulkan_core.h>
+
+// Startup options threaded from the command line down to the renderer's
+// subsystems.
+struct RendererConfig {
+    // On-disk VkPipelineCache blob, empty disables persistence
+    std::string pipelineCachePath = "pipeline_cache.bin";
+
+    // Job system workers, including the main thread. 0 uses one per
+    // hardware core.
+    uint32_t workerThreads = 0;
+
+    // Frames the CPU may record ahead of the GPU, 1 to MAX_FRAMES_IN_FLIGHT.
+    // More trades latency for throughput.
+    uint32_t framesInFlight = 2;
+
+    // Render without VkRenderPass/VkFramebuffer objects when the device has
+    // VK_KHR_dynamic_rendering. False forces the render pass path.
+    bool dynamicRendering = true;
+
+    // Swapchain present mode; FIFO (always supported) is used when the
+    // surface lacks it
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    // Swapchain images to ask for, 0 for the minimum plus one
+    uint32_t swapchainImages = 0;
+    // Wait for the previous frame to be presented before starting the next
+    // (VK_KHR_present_wait), so input is sampled as late as possible
+    bool lowLatency = false;
+
+    // Run compute work (GPU scene culling) on a compute-only queue family
+    // when the device has one, overlapping the graphics queue
+    bool asyncCompute = true;
+
+    // Reference textures by handle from one bindless descriptor set when the
+    // device has descriptor indexing. False keeps instanced draws untextured.
+    bool bindless = true;
+
+    // Khronos validation layers and their debug messenger. They cost CPU
+    // time on every call, so benchmarks turn them off.
+    bool validation = true;
+
+    // Device memory streamed texture mips may occupy, in MiB
+    uint32_t textureBudgetMB = 256;
+};
@@ -1,23 +1,53 @@
 #include "../stdafx.h"
 #include "shader_module.hpp"
 
+#include <cstdlib>
+#include <filesystem>
+
 ShaderModule::ShaderModule(VulkanContext& context, const std::string& filepath)
     : m_Context(context)
 {
     auto code = ReadFile(filepath);
-    
+    Create(reinterpret_cast<const uint32_t*>(code.data()), code.size());
+}
+
+ShaderModule::ShaderModule(VulkanContext& context, std::span<const uint32_t> code, const std::string& name)
+    : m_Context(context)
+{
+    std::string overridePath = FindOverride(name);
+    if (!overridePath.empty()) {
+        auto overrideCode = ReadFile(overridePath);
+        Create(reinterpret_cast<const uint32_t*>(overrideCode.data()), overrideCode.size());
+        return;
+    }
+
+    Create(code.data(), code.size_bytes());
+}
+
+ShaderModule::~ShaderModule() {
+    m_Context.GetDispatchTable().destroyShaderModule(m_ShaderModule, nullptr);
+}
+
+void ShaderModule::Create(const uint32_t* code, size_t codeSize) {
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    createInfo.codeSize = codeSize;
+    createInfo.pCode = code;
 
     if (m_Context.GetDispatchTable().createShaderModule(&createInfo, nullptr, &m_ShaderModule) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create shader module");
     }
 }
 
-ShaderModule::~ShaderModule() {
-    m_Context.GetDispatchTable().destroyShaderModule(m_ShaderModule, nullptr);
+std::string ShaderModule::FindOverride(const std::string& name) {
+    const char* dir = std::getenv("JBRENDERER_SHADER_DIR");
+    if (name.empty() || !dir || !*dir) {
+        return {};
+    }
+
+    std::filesystem::path path = std::filesystem::path(dir) / (name + ".spv");
+    std::error_code ec;
+    return std::filesystem::exists(path, ec) ? path.string() : std::string{};
 }
 
 std::vector<char> ShaderModule::ReadFile(const std::string& filename) {
@@ -35,4 +65,4 @@ std::vector<char> ShaderModule::ReadFile(const std::string& filename) {
     file.close();
 
     return buffer;
-}
\ No newline at end of file
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <vulkan/vulkan_core.h>
+#include <span>
 #include <string>
 #include <vector>
 #include "vulkan_context.hpp"
@@ -7,6 +8,10 @@
 class ShaderModule {
 public:
     ShaderModule(VulkanContext& context, const std::string& filepath);
+    // SPIR-V embedded in the binary, passed to the driver without a copy.
+    // If JBRENDERER_SHADER_DIR is set and contains <name>.spv, that file is
+    // loaded instead so shaders can be iterated on without relinking.
+    ShaderModule(VulkanContext& context, std::span<const uint32_t> code, const std::string& name = {});
     ~ShaderModule();
 
     VkShaderModule GetHandle() const { return m_ShaderModule; }
@@ -15,4 +20,7 @@ public:
 private:
     VulkanContext& m_Context;
     VkShaderModule m_ShaderModule;
-};
\ No newline at end of file
+
+    void Create(const uint32_t* code, size_t codeSize);
+    static std::string FindOverride(const std::string& name);
+};
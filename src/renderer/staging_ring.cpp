@@ -0,0 +1,281 @@
+#include "../stdafx.h"
+#include "staging_ring.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+StagingRing::StagingRing(VulkanContext& context, VkDeviceSize capacity)
+    : m_Context(context), m_Capacity(capacity)
+{
+    auto& disp = m_Context.GetDispatchTable();
+
+    m_Buffer = m_Context.GetAllocator().CreateBuffer(m_Capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = m_Context.GetGraphicsQueueIndex();
+
+    if (disp.createCommandPool(&poolInfo, nullptr, &m_CommandPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create staging command pool");
+    }
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_CommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    for (auto& batch : m_Batches) {
+        if (disp.allocateCommandBuffers(&allocInfo, &batch.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate staging command buffer");
+        }
+        if (disp.createFence(&fenceInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create staging fence");
+        }
+    }
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (disp.createSemaphore(&semaphoreInfo, nullptr, &m_Timeline) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create staging timeline");
+    }
+}
+
+StagingRing::~StagingRing() {
+    WaitIdle();
+
+    auto& disp = m_Context.GetDispatchTable();
+    for (auto& batch : m_Batches) {
+        disp.destroyFence(batch.fence, nullptr);
+    }
+    disp.destroySemaphore(m_Timeline, nullptr);
+    disp.destroyCommandPool(m_CommandPool, nullptr);
+    m_Context.GetAllocator().DestroyBuffer(m_Buffer);
+}
+
+void StagingRing::Upload(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+    const char* src = static_cast<const char*>(data);
+    char* mapped = static_cast<char*>(m_Buffer.allocation.mapped);
+
+    // Chunks of half the ring keep one chunk copying while the next is written
+    VkDeviceSize maxChunk = m_Capacity / 2;
+    while (size > 0) {
+        VkDeviceSize chunk = std::min(size, maxChunk);
+        VkDeviceSize offset = Reserve(chunk);
+
+        if (m_Pending.empty()) {
+            m_PendingStart = std::chrono::steady_clock::now();
+        }
+        std::memcpy(mapped + offset, src, chunk);
+        m_Pending.push_back({dst, {offset, dstOffset, chunk}});
+        m_PendingBytes += chunk;
+
+        src += chunk;
+        dstOffset += chunk;
+        size -= chunk;
+    }
+}
+
+VkDeviceSize StagingRing::Reserve(VkDeviceSize size) {
+    for (;;) {
+        uint64_t start = (m_Head + COPY_ALIGNMENT - 1) & ~(COPY_ALIGNMENT - 1);
+        if (start % m_Capacity + size > m_Capacity) {
+            start = (start / m_Capacity + 1) * m_Capacity;      // Don't straddle the end of the ring
+        }
+
+        if (start + size - m_Tail <= m_Capacity) {
+            m_Head = start + size;
+            return start % m_Capacity;
+        }
+
+        // Out of space: push out what we have and wait for the oldest batch
+        Flush();
+        Retire(true);
+
+        bool idle = std::none_of(m_Batches.begin(), m_Batches.end(), [](const Batch& b) { return b.inFlight; });
+        if (idle) {
+            m_Head = m_Tail = 0;
+        }
+    }
+}
+
+bool StagingRing::Flush() {
+    Retire(false);
+    if (m_Pending.empty()) {
+        return false;
+    }
+
+    auto& disp = m_Context.GetDispatchTable();
+
+    // The next slot is always the oldest, so waiting on it keeps retirement in order
+    Batch& batch = m_Batches[m_NextBatch];
+    if (batch.inFlight) {
+        disp.waitForFences(1, &batch.fence, VK_TRUE, UINT64_MAX);
+        RetireBatch(batch);
+    }
+
+    disp.resetFences(1, &batch.fence);
+    disp.resetCommandBuffer(batch.commandBuffer, 0);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (disp.beginCommandBuffer(batch.commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording staging command buffer");
+    }
+
+    // Copies may overwrite buffers that earlier frames still read (GPU scene
+    // objects updated in place), so they wait for all prior shader and
+    // vertex work; write-after-read only needs the execution dependency
+    disp.cmdPipelineBarrier(batch.commandBuffer,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+    // One vkCmdCopyBuffer per run of copies into the same destination
+    std::vector<VkBufferCopy> regions;
+    regions.reserve(m_Pending.size());
+    for (size_t i = 0; i < m_Pending.size();) {
+        regions.clear();
+        size_t j = i;
+        for (; j < m_Pending.size() && m_Pending[j].dst == m_Pending[i].dst; j++) {
+            regions.push_back(m_Pending[j].region);
+        }
+        disp.cmdCopyBuffer(batch.commandBuffer, m_Buffer.buffer, m_Pending[i].dst,
+                           static_cast<uint32_t>(regions.size()), regions.data());
+        i = j;
+    }
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                            VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT |
+                            VK_ACCESS_SHADER_READ_BIT;
+
+    disp.cmdPipelineBarrier(batch.commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    if (disp.endCommandBuffer(batch.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record staging command buffer");
+    }
+
+    uint64_t signalValue = m_SubmittedValue + 1;
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = m_WaitSemaphore ? 1 : 0;
+    timelineInfo.pWaitSemaphoreValues = &m_WaitValue;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = m_WaitSemaphore ? 1 : 0;
+    submitInfo.pWaitSemaphores = &m_WaitSemaphore;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_Timeline;
+
+    if (disp.queueSubmit(m_Context.GetGraphicsQueue(), 1, &submitInfo, batch.fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit staging copies");
+    }
+    m_SubmittedValue = signalValue;
+    m_WaitSemaphore = VK_NULL_HANDLE;
+    m_WaitValue = 0;
+
+    batch.head = m_Head;
+    batch.bytes = m_PendingBytes;
+    batch.inFlight = true;
+
+    if (m_Stats.submitCount == 0) {
+        m_FirstStart = m_PendingStart;
+    }
+    m_Stats.copyCount += static_cast<uint32_t>(m_Pending.size());
+    m_Stats.submitCount++;
+    m_Pending.clear();
+    m_PendingBytes = 0;
+    m_NextBatch = (m_NextBatch + 1) % MAX_BATCHES;
+    return true;
+}
+
+void StagingRing::WaitIdle() {
+    Flush();
+    for (uint32_t i = 0; i < MAX_BATCHES; i++) {
+        Retire(true);
+    }
+}
+
+void StagingRing::AddWait(VkSemaphore timeline, uint64_t value) {
+    if (m_WaitSemaphore != VK_NULL_HANDLE && m_WaitSemaphore != timeline) {
+        throw std::runtime_error("Staging copies can only wait on one timeline");
+    }
+    m_WaitSemaphore = timeline;
+    m_WaitValue = std::max(m_WaitValue, value);
+}
+
+void StagingRing::Retire(bool wait) {
+    auto& disp = m_Context.GetDispatchTable();
+
+    // Walk from the oldest slot; the first unfinished batch stops the walk
+    for (uint32_t i = 0; i < MAX_BATCHES; i++) {
+        Batch& batch = m_Batches[(m_NextBatch + i) % MAX_BATCHES];
+        if (!batch.inFlight) {
+            continue;
+        }
+
+        if (wait) {
+            disp.waitForFences(1, &batch.fence, VK_TRUE, UINT64_MAX);
+            wait = false;
+        } else if (disp.getFenceStatus(batch.fence) != VK_SUCCESS) {
+            return;
+        }
+        RetireBatch(batch);
+    }
+}
+
+void StagingRing::RetireBatch(Batch& batch) {
+    m_Tail = batch.head;
+    m_Stats.bytesUploaded += batch.bytes;
+    m_Stats.busyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_FirstStart).count();
+    batch.inFlight = false;
+}
+
+StagingRing::Stats StagingRing::GetStats() {
+    Retire(false);
+    return m_Stats;
+}
+
+void StagingRing::PrintStats(std::ostream& os) {
+    Stats stats = GetStats();
+    // Formatted apart, so the caller's stream keeps its own flags
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(2) << "Uploads: " << stats.bytesUploaded / (1024.0 * 1024.0) << " MiB in "
+         << stats.copyCount << " copies, " << stats.submitCount << " submits, " << stats.GetMBps() << " MB/s";
+    os << line.str() << std::endl;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <array>
+#include <chrono>
+#include <ostream>
+#include <vector>
+#include "vulkan_context.hpp"
+#include "memory_allocator.hpp"
+
+// Host-visible ring buffer feeding device-local buffers. Upload copies the
+// data into the ring and queues a vkCmdCopyBuffer; Flush records every queued
+// copy into one command buffer and submits it once, followed by a barrier
+// that makes the data visible to vertex input and shaders. Ring space is
+// reclaimed as the fences of earlier flushes signal. Each flush also signals
+// a timeline semaphore, for work on other queues that reads what it wrote.
+class StagingRing {
+public:
+    static constexpr VkDeviceSize DEFAULT_CAPACITY = 16ull << 20;
+
+    struct Stats {
+        uint64_t bytesUploaded = 0;     // Completed on the GPU
+        uint32_t copyCount = 0;
+        uint32_t submitCount = 0;
+        double busyMs = 0.0;            // First Upload until the last batch was seen complete, so
+                                        // batches in flight together count once
+
+        double GetMBps() const { return busyMs > 0.0 ? bytesUploaded / (1024.0 * 1024.0) / (busyMs / 1000.0) : 0.0; }
+    };
+
+    StagingRing(VulkanContext& context, VkDeviceSize capacity = DEFAULT_CAPACITY);
+    ~StagingRing();
+
+    StagingRing(const StagingRing&) = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+
+    // Data larger than the ring is split into several copies, flushing and
+    // waiting for space as needed
+    void Upload(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+    // Submits all queued copies; returns false when there was nothing to do
+    bool Flush();
+    void WaitIdle();
+
+    // Makes the next Flush wait for value first, for destinations that work
+    // on another queue may still be reading
+    void AddWait(VkSemaphore timeline, uint64_t value);
+    // Signalled by the latest Flush; 0 before the first one
+    VkSemaphore GetTimeline() const { return m_Timeline; }
+    uint64_t GetSubmittedValue() const { return m_SubmittedValue; }
+
+    // Retires finished batches first, so the numbers include everything that completed
+    Stats GetStats();
+    void PrintStats(std::ostream& os);
+
+private:
+    static constexpr uint32_t MAX_BATCHES = 4;
+    static constexpr VkDeviceSize COPY_ALIGNMENT = 16;
+
+    struct PendingCopy {
+        VkBuffer dst;
+        VkBufferCopy region;
+    };
+
+    struct Batch {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        uint64_t head = 0;              // Ring position after this batch's data
+        uint64_t bytes = 0;
+        bool inFlight = false;
+    };
+
+    VulkanContext& m_Context;
+    AllocatedBuffer m_Buffer;
+    VkDeviceSize m_Capacity;
+    VkCommandPool m_CommandPool = VK_NULL_HANDLE;
+    VkSemaphore m_Timeline = VK_NULL_HANDLE;
+    uint64_t m_SubmittedValue = 0;
+    VkSemaphore m_WaitSemaphore = VK_NULL_HANDLE;
+    uint64_t m_WaitValue = 0;
+
+    // Monotonic positions, wrapped with % m_Capacity
+    uint64_t m_Head = 0;
+    uint64_t m_Tail = 0;
+
+    std::vector<PendingCopy> m_Pending;
+    uint64_t m_PendingBytes = 0;
+    std::chrono::steady_clock::time_point m_PendingStart;
+    std::chrono::steady_clock::time_point m_FirstStart{};
+
+    std::array<Batch, MAX_BATCHES> m_Batches;
+    uint32_t m_NextBatch = 0;
+    Stats m_Stats;
+
+    VkDeviceSize Reserve(VkDeviceSize size);
+    void Retire(bool wait);
+    void RetireBatch(Batch& batch);
+};
@@ -1,8 +1,9 @@
 #include "../stdafx.h"
 #include "swap_chain.hpp"
+#include "deletion_queue.hpp"
 
-SwapChain::SwapChain(VulkanContext& context)
-    : m_Context(context)
+SwapChain::SwapChain(VulkanContext& context, VkPresentModeKHR presentMode, uint32_t imageCount)
+    : m_Context(context), m_DesiredPresentMode(presentMode), m_DesiredImageCount(imageCount)
 {
     Initialize();
 }
@@ -16,19 +17,51 @@ void SwapChain::Cleanup() {
     vkb::destroy_swapchain(m_Swapchain);
 }
 
+const char* SwapChain::GetPresentModeName(VkPresentModeKHR mode) {
+    switch (mode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+        case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo_relaxed";
+        default: return "fifo";
+    }
+}
+
+bool SwapChain::ParsePresentMode(const std::string& name, VkPresentModeKHR& mode) {
+    for (VkPresentModeKHR candidate : {VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+                                       VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR}) {
+        if (name == GetPresentModeName(candidate)) {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
 void SwapChain::Initialize() {
     vkb::SwapchainBuilder swapchainBuilder{m_Context.GetDevice()};
-    auto swapchainRet = swapchainBuilder
+    swapchainBuilder
         .set_old_swapchain(m_Swapchain)
-        .build();
+        .set_desired_present_mode(m_DesiredPresentMode)
+        .add_fallback_present_mode(VK_PRESENT_MODE_FIFO_KHR);
+    if (m_DesiredImageCount != 0) {
+        // Clamped to what the surface allows
+        swapchainBuilder.set_desired_min_image_count(m_DesiredImageCount);
+    }
+    auto swapchainRet = swapchainBuilder.build();
     
     if (!swapchainRet) {
         throw std::runtime_error("Failed to create swapchain: " + 
                                swapchainRet.error().message());
     }
     
-    // Clean up old swapchain
-    vkb::destroy_swapchain(m_Swapchain);
+    // The old swapchain is retired by the new one but frames in flight may
+    // still render to or present its images
+    if (m_Swapchain.swapchain != VK_NULL_HANDLE) {
+        m_Context.GetDeletionQueue().Push([oldSwapchain = m_Swapchain, imageViews = m_ImageViews]() mutable {
+            oldSwapchain.destroy_image_views(imageViews);
+            vkb::destroy_swapchain(oldSwapchain);
+        });
+    }
     
     // Set new swapchain
     m_Swapchain = swapchainRet.value();
@@ -48,6 +81,5 @@ void SwapChain::Initialize() {
 }
 
 void SwapChain::Recreate() {
-    Cleanup();
     Initialize();
 }
\ No newline at end of file
@@ -1,29 +1,45 @@
 #pragma once
 #include <vulkan/vulkan_core.h>
 #include <VkBootstrap.h>
+#include <string>
 #include <vector>
 #include "vulkan_context.hpp"
+#include "render_target.hpp"
 
-class SwapChain {
+class SwapChain : public RenderTarget {
 public:
-    SwapChain(VulkanContext& context);
+    // presentMode falls back to FIFO when the surface does not support it;
+    // imageCount 0 asks for the surface minimum plus one
+    SwapChain(VulkanContext& context, VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR, uint32_t imageCount = 0);
     ~SwapChain();
 
+    // Builds a new swapchain from the old one, which is destroyed through the
+    // deletion queue once its frames complete
     void Recreate();
-    
+
     const vkb::Swapchain& GetHandle() const { return m_Swapchain; }
-    const std::vector<VkImage>& GetImages() const { return m_Images; }
-    const std::vector<VkImageView>& GetImageViews() const { return m_ImageViews; }
-    VkFormat GetImageFormat() const { return m_Swapchain.image_format; }
-    VkExtent2D GetExtent() const { return m_Swapchain.extent; }
-    uint32_t GetImageCount() const { return m_Swapchain.image_count; }
+    const std::vector<VkImage>& GetImages() const override { return m_Images; }
+    const std::vector<VkImageView>& GetImageViews() const override { return m_ImageViews; }
+    VkFormat GetImageFormat() const override { return m_Swapchain.image_format; }
+    VkExtent2D GetExtent() const override { return m_Swapchain.extent; }
+    uint32_t GetImageCount() const override { return m_Swapchain.image_count; }
+    VkImageLayout GetFinalLayout() const override { return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; }
+    // The mode actually in use, after any fallback
+    VkPresentModeKHR GetPresentMode() const { return m_Swapchain.present_mode; }
+
+    // "fifo", "mailbox", "immediate" or "fifo_relaxed"
+    static const char* GetPresentModeName(VkPresentModeKHR mode);
+    // Inverse of GetPresentModeName; false for an unknown name
+    static bool ParsePresentMode(const std::string& name, VkPresentModeKHR& mode);
 
 private:
     VulkanContext& m_Context;
+    VkPresentModeKHR m_DesiredPresentMode;
+    uint32_t m_DesiredImageCount;
     vkb::Swapchain m_Swapchain;
     std::vector<VkImage> m_Images;
     std::vector<VkImageView> m_ImageViews;
-    
+
     void Cleanup();
     void Initialize();
 };
\ No newline at end of file
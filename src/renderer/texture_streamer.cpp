@@ -0,0 +1,554 @@
+#include "../stdafx.h"
+#include "texture_streamer.hpp"
+#include "deletion_queue.hpp"
+#include "../core/profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+    constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+    // Keeps textures around the eye from asking for infinite resolution
+    constexpr float MIN_DISTANCE = 0.01f;
+
+    constexpr VkPipelineStageFlags SHADER_STAGES =
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+    VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+TextureStreamer::TextureStreamer(VulkanContext& context, uint32_t frameCount, VkDeviceSize budget,
+                                 VkDeviceSize stagingPerFrame)
+    : m_Context(context), m_FrameCount(frameCount), m_Budget(budget), m_StagingPerFrame(stagingPerFrame)
+{
+    // Each frame slot stages into its own range, which is free again once
+    // the slot's previous submission has completed
+    m_Staging = m_Context.GetAllocator().CreateBuffer(m_StagingPerFrame * frameCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (m_Context.GetDispatchTable().createSampler(&samplerInfo, nullptr, &m_Sampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create texture sampler");
+    }
+
+    for (uint32_t i = 0; i < DECODE_THREADS; i++) {
+        m_Threads.emplace_back(&TextureStreamer::DecodeLoop, this);
+    }
+}
+
+TextureStreamer::~TextureStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Wake.notify_all();
+    for (auto& thread : m_Threads) {
+        thread.join();
+    }
+
+    auto& disp = m_Context.GetDispatchTable();
+    auto& allocator = m_Context.GetAllocator();
+    for (auto& texture : m_Textures) {
+        if (texture.view != VK_NULL_HANDLE) {
+            disp.destroyImageView(texture.view, nullptr);
+            allocator.DestroyImage(texture.image);
+        }
+    }
+    disp.destroySampler(m_Sampler, nullptr);
+    allocator.DestroyBuffer(m_Staging);
+}
+
+TextureStreamer::TextureId TextureStreamer::Load(const std::string& path) {
+    auto file = std::make_shared<const Ktx2File>(path);
+
+    VkFormatProperties properties;
+    m_Context.GetInstanceDispatch().getPhysicalDeviceFormatProperties(
+        m_Context.GetDevice().physical_device.physical_device, file->GetFormat(), &properties);
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT |
+                                    VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+    if ((properties.optimalTilingFeatures & required) != required) {
+        throw std::runtime_error("Texture format " + std::to_string(file->GetFormat()) + " is not supported: " + path);
+    }
+
+    Texture texture;
+    texture.file = file;
+    texture.levelCount = file->GetLevelCount();
+
+    // The tail is the small levels, or at least the coarsest one when the
+    // file has no mips that small
+    texture.tailLevel = texture.levelCount - 1;
+    for (uint32_t i = 0; i < texture.levelCount; i++) {
+        VkExtent2D extent = file->GetLevel(i).extent;
+        if (std::max(extent.width, extent.height) <= MIP_TAIL_SIZE) {
+            texture.tailLevel = i;
+            break;
+        }
+    }
+    texture.minLevel = texture.tailLevel;
+    while (texture.minLevel > 0 && file->GetLevel(texture.minLevel - 1).size <= m_StagingPerFrame) {
+        texture.minLevel--;
+    }
+
+    VkDeviceSize tailBytes = GetLevelBytes(texture, texture.tailLevel, texture.levelCount);
+    if (tailBytes > m_StagingPerFrame) {
+        throw std::runtime_error("Texture mip tail does not fit in the staging area: " + path);
+    }
+
+    texture.residentLevel = texture.levelCount;
+    texture.targetLevel = texture.levelCount;
+    texture.wantedLevel = texture.tailLevel;
+    texture.pendingLevel = texture.tailLevel;
+    if (m_Bindless) {
+        texture.handle = m_Bindless->AddImage(VK_NULL_HANDLE);
+    }
+
+    TextureId id;
+    if (!m_FreeIds.empty()) {
+        id = m_FreeIds.back();
+        m_FreeIds.pop_back();
+        texture.generation = m_Textures[id].generation;
+        m_Textures[id] = std::move(texture);
+    } else {
+        id = static_cast<TextureId>(m_Textures.size());
+        m_Textures.push_back(std::move(texture));
+    }
+
+    // Tails go ahead of everything else: nothing can be drawn without one
+    m_PendingBytes += tailBytes;
+    QueueDecode(id, m_Textures[id].tailLevel, m_Textures[id].levelCount, true);
+    return id;
+}
+
+void TextureStreamer::Release(TextureId id) {
+    Texture& texture = m_Textures[id];
+    if (texture.pendingLevel != NO_LEVEL) {
+        m_PendingBytes -= GetLevelBytes(texture, texture.pendingLevel, texture.residentLevel);
+    }
+    m_ResidentBytes -= GetLevelBytes(texture, texture.residentLevel, texture.levelCount);
+    DestroyImage(texture);
+    if (texture.handle != BindlessTable::INVALID_HANDLE) {
+        m_Bindless->RemoveImage(texture.handle);
+    }
+
+    // Decodes still in flight see the new generation and are dropped
+    uint32_t generation = texture.generation + 1;
+    texture = Texture{};
+    texture.generation = generation;
+    m_FreeIds.push_back(id);
+}
+
+void TextureStreamer::SetView(const Camera& camera, uint32_t viewportHeight) {
+    m_Eye = glm::vec3(glm::inverse(camera.matrices.view)[3]);
+    float halfFov = glm::radians(camera.getFov()) * 0.5f;
+    m_PixelsPerUnit = static_cast<float>(viewportHeight) / (2.0f * std::tan(halfFov));
+}
+
+void TextureStreamer::Touch(TextureId id, const glm::vec3& center, float radius) {
+    Texture& texture = m_Textures[id];
+
+    // Pixels across the sphere against texels across the texture: each
+    // halving of the ratio drops a level
+    float distance = std::max(glm::length(center - m_Eye) - radius, MIN_DISTANCE);
+    float pixels = std::max(2.0f * radius / distance * m_PixelsPerUnit, 1.0f);
+    VkExtent2D extent = texture.file->GetExtent();
+    float texels = static_cast<float>(std::max(extent.width, extent.height));
+    uint32_t level = pixels >= texels ? 0 : static_cast<uint32_t>(std::floor(std::log2(texels / pixels)));
+    level = std::clamp(level, texture.minLevel, texture.tailLevel);
+
+    if (texture.lastTouched != m_UpdateIndex) {
+        texture.lastTouched = m_UpdateIndex;
+        texture.wantedLevel = level;
+    } else {
+        texture.wantedLevel = std::min(texture.wantedLevel, level);
+    }
+}
+
+VkDeviceSize TextureStreamer::GetLevelBytes(const Texture& texture, uint32_t first, uint32_t last) const {
+    VkDeviceSize bytes = 0;
+    for (uint32_t i = first; i < last; i++) {
+        bytes += texture.file->GetLevel(i).size;
+    }
+    return bytes;
+}
+
+void TextureStreamer::QueueDecode(TextureId id, uint32_t first, uint32_t last, bool urgent) {
+    const Texture& texture = m_Textures[id];
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        DecodeRequest request{id, texture.generation, first, last, texture.file};
+        if (urgent) {
+            m_Requests.push_front(std::move(request));
+        } else {
+            m_Requests.push_back(std::move(request));
+        }
+        m_PendingDecodes++;
+    }
+    m_Wake.notify_one();
+}
+
+void TextureStreamer::DecodeLoop() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    for (;;) {
+        m_Wake.wait(lock, [this]() { return m_Stop || !m_Requests.empty(); });
+        if (m_Stop) {
+            return;
+        }
+        DecodeRequest request = std::move(m_Requests.front());
+        m_Requests.pop_front();
+        lock.unlock();
+
+        // Payloads are stored as-is; a transcoder (Basis, zstd) would run here
+        DecodeResult result{request.id, request.generation, request.first, request.last, {}};
+        auto start = std::chrono::steady_clock::now();
+        {
+            JB_PROFILE_ZONE("DecodeTexture");
+            try {
+                request.file->ReadLevels(request.first, request.last, result.data);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                result.data.clear();
+            }
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        m_DecodeMs += ms;
+        m_Results.push_back(std::move(result));
+    }
+}
+
+// Gives up finest levels, least recently touched texture first, until
+// needed more bytes fit in the budget. Textures touched this frame only
+// lose levels finer than they asked for.
+bool TextureStreamer::Evict(VkDeviceSize needed) {
+    while (m_ResidentBytes + m_PendingBytes + needed > m_Budget) {
+        Texture* victim = nullptr;
+        for (auto& texture : m_Textures) {
+            bool evictable = texture.file && texture.pendingLevel == NO_LEVEL &&
+                             texture.targetLevel >= texture.residentLevel &&     // Not growing this frame
+                             texture.targetLevel < texture.tailLevel;
+            bool spare = texture.lastTouched != m_UpdateIndex || texture.targetLevel < texture.wantedLevel;
+            if (evictable && spare && (!victim || texture.lastTouched < victim->lastTouched)) {
+                victim = &texture;
+            }
+        }
+        if (!victim) {
+            return false;
+        }
+
+        VkDeviceSize bytes = victim->file->GetLevel(victim->targetLevel).size;
+        victim->targetLevel++;
+        m_ResidentBytes -= bytes;
+        m_Stats.levelsEvicted++;
+        m_Stats.bytesEvicted += bytes;
+    }
+    return true;
+}
+
+void TextureStreamer::RecordUpdates(VkCommandBuffer cmd, uint32_t frameIndex) {
+    m_Changed.clear();
+    if (m_Textures.size() == m_FreeIds.size()) {
+        m_UpdateIndex++;
+        return;
+    }
+
+    JB_PROFILE_ZONE("Textures");
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_PendingDecodes -= static_cast<uint32_t>(m_Results.size());
+        for (auto& result : m_Results) {
+            m_Ready.push_back(std::move(result));
+        }
+        m_Results.clear();
+    }
+
+    for (auto& texture : m_Textures) {
+        texture.targetLevel = texture.residentLevel;
+    }
+
+    // Finished decodes, oldest first, while this frame's staging range has
+    // room; the rest wait for the next frame
+    char* staging = static_cast<char*>(m_Staging.allocation.mapped);
+    VkDeviceSize stagingBase = frameIndex * m_StagingPerFrame;
+    VkDeviceSize stagingUsed = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < m_Ready.size(); i++) {
+        DecodeResult& result = m_Ready[i];
+        Texture& texture = m_Textures[result.id];
+        if (!texture.file || texture.generation != result.generation) {
+            continue;
+        }
+        if (result.data.empty()) {
+            m_PendingBytes -= GetLevelBytes(texture, result.first, result.last);
+            texture.pendingLevel = NO_LEVEL;
+            continue;
+        }
+
+        // Each level starts aligned, so the copies can address it directly
+        VkDeviceSize size = 0;
+        for (uint32_t level = result.first; level < result.last; level++) {
+            size = AlignUp(size, STAGING_ALIGNMENT) + texture.file->GetLevel(level).size;
+        }
+        if (AlignUp(stagingUsed, STAGING_ALIGNMENT) + size > m_StagingPerFrame) {
+            if (kept != i) {
+                m_Ready[kept] = std::move(result);
+            }
+            kept++;
+            continue;
+        }
+
+        Change change{result.id, texture.residentLevel, result.first, {}, VK_NULL_HANDLE, {}};
+        const uint8_t* src = result.data.data();
+        for (uint32_t level = result.first; level < result.last; level++) {
+            const Ktx2File::Level& info = texture.file->GetLevel(level);
+            stagingUsed = AlignUp(stagingUsed, STAGING_ALIGNMENT);
+            std::memcpy(staging + stagingBase + stagingUsed, src, info.size);
+
+            VkBufferImageCopy copy{};
+            copy.bufferOffset = stagingBase + stagingUsed;
+            copy.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - result.first, 0, 1};
+            copy.imageExtent = {info.extent.width, info.extent.height, 1};
+            change.copies.push_back(copy);
+
+            src += info.size;
+            stagingUsed += info.size;
+        }
+        m_Changes.push_back(std::move(change));
+
+        VkDeviceSize bytes = result.data.size();
+        m_PendingBytes -= bytes;
+        m_ResidentBytes += bytes;
+        m_Stats.levelsStreamedIn += result.last - result.first;
+        m_Stats.bytesStreamedIn += bytes;
+        texture.pendingLevel = NO_LEVEL;
+        texture.targetLevel = result.first;
+    }
+    m_Ready.resize(kept);
+
+    // Budget lowered, or tails loaded on top of a full budget
+    Evict(0);
+
+    // One level finer for whatever is drawn coarser than it asked for,
+    // biggest shortfall first
+    std::vector<TextureId> requests;
+    for (TextureId id = 0; id < m_Textures.size(); id++) {
+        const Texture& texture = m_Textures[id];
+        if (texture.file && texture.lastTouched == m_UpdateIndex && texture.pendingLevel == NO_LEVEL &&
+            texture.targetLevel == texture.residentLevel && texture.wantedLevel < texture.residentLevel &&
+            texture.residentLevel <= texture.tailLevel) {
+            requests.push_back(id);
+        }
+    }
+    std::sort(requests.begin(), requests.end(), [&](TextureId a, TextureId b) {
+        const Texture& ta = m_Textures[a];
+        const Texture& tb = m_Textures[b];
+        return ta.residentLevel - ta.wantedLevel > tb.residentLevel - tb.wantedLevel;
+    });
+    for (TextureId id : requests) {
+        if (m_PendingDecodes + m_Ready.size() >= MAX_PENDING_DECODES) {
+            break;
+        }
+        Texture& texture = m_Textures[id];
+        if (texture.targetLevel != texture.residentLevel) {
+            continue;                   // Lost levels to an earlier request
+        }
+        uint32_t level = texture.residentLevel - 1;
+        VkDeviceSize bytes = texture.file->GetLevel(level).size;
+        if (!Evict(bytes)) {
+            break;
+        }
+        texture.pendingLevel = level;
+        m_PendingBytes += bytes;
+        QueueDecode(id, level, level + 1, false);
+    }
+
+    for (TextureId id = 0; id < m_Textures.size(); id++) {
+        const Texture& texture = m_Textures[id];
+        if (texture.file && texture.targetLevel > texture.residentLevel) {
+            m_Changes.push_back({id, texture.residentLevel, texture.targetLevel, {}, VK_NULL_HANDLE, {}});
+        }
+    }
+
+    if (!m_Changes.empty()) {
+        RecordChanges(cmd);
+    }
+    m_UpdateIndex++;
+}
+
+void TextureStreamer::CreateImage(const Texture& texture, uint32_t level, AllocatedImage& image, VkImageView& view) {
+    VkExtent2D extent = texture.file->GetLevel(level).extent;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = texture.file->GetFormat();
+    imageInfo.extent = {extent.width, extent.height, 1};
+    imageInfo.mipLevels = texture.levelCount - level;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    image = m_Context.GetAllocator().CreateImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = imageInfo.format;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, imageInfo.mipLevels, 0, 1};
+
+    if (m_Context.GetDispatchTable().createImageView(&viewInfo, nullptr, &view) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create texture image view");
+    }
+}
+
+void TextureStreamer::DestroyImage(Texture& texture) {
+    if (texture.view == VK_NULL_HANDLE) {
+        return;
+    }
+
+    // Frames in flight may still sample it
+    auto& disp = m_Context.GetDispatchTable();
+    auto& allocator = m_Context.GetAllocator();
+    m_Context.GetDeletionQueue().Push([&disp, &allocator, image = texture.image, view = texture.view]() mutable {
+        disp.destroyImageView(view, nullptr);
+        allocator.DestroyImage(image);
+    });
+    texture.image = AllocatedImage{};
+    texture.view = VK_NULL_HANDLE;
+}
+
+void TextureStreamer::RecordChanges(VkCommandBuffer cmd) {
+    auto& disp = m_Context.GetDispatchTable();
+
+    // New images to TRANSFER_DST, old ones with levels to keep to TRANSFER_SRC
+    std::vector<VkImageMemoryBarrier> barriers;
+    for (auto& change : m_Changes) {
+        const Texture& texture = m_Textures[change.id];
+        CreateImage(texture, change.newLevel, change.image, change.view);
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = change.image.image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.levelCount - change.newLevel, 0, 1};
+        barriers.push_back(barrier);
+
+        if (texture.view != VK_NULL_HANDLE) {
+            // Earlier frames' sampling has to finish first; nothing to make visible
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.image = texture.image.image;
+            barrier.subresourceRange.levelCount = texture.levelCount - change.oldLevel;
+            barriers.push_back(barrier);
+        }
+    }
+    disp.cmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT | SHADER_STAGES, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    std::vector<VkImageCopy> regions;
+    for (auto& change : m_Changes) {
+        const Texture& texture = m_Textures[change.id];
+
+        // Levels both images hold move over on the GPU
+        regions.clear();
+        if (texture.view != VK_NULL_HANDLE) {
+            for (uint32_t level = std::max(change.oldLevel, change.newLevel); level < texture.levelCount; level++) {
+                VkExtent2D extent = texture.file->GetLevel(level).extent;
+                VkImageCopy region{};
+                region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - change.oldLevel, 0, 1};
+                region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - change.newLevel, 0, 1};
+                region.extent = {extent.width, extent.height, 1};
+                regions.push_back(region);
+            }
+        }
+        if (!regions.empty()) {
+            disp.cmdCopyImage(cmd, texture.image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                              change.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                              static_cast<uint32_t>(regions.size()), regions.data());
+        }
+        if (!change.copies.empty()) {
+            disp.cmdCopyBufferToImage(cmd, m_Staging.buffer, change.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                      static_cast<uint32_t>(change.copies.size()), change.copies.data());
+        }
+    }
+
+    barriers.clear();
+    for (auto& change : m_Changes) {
+        const Texture& texture = m_Textures[change.id];
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = change.image.image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.levelCount - change.newLevel, 0, 1};
+        barriers.push_back(barrier);
+    }
+    disp.cmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, SHADER_STAGES,
+                            0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    // The old images were read by the copies above, so they go with this frame
+    for (auto& change : m_Changes) {
+        Texture& texture = m_Textures[change.id];
+        DestroyImage(texture);
+        texture.image = change.image;
+        texture.view = change.view;
+        texture.residentLevel = change.newLevel;
+        if (texture.handle != BindlessTable::INVALID_HANDLE) {
+            m_Bindless->SetImage(texture.handle, texture.view);
+        }
+        m_Changed.push_back(change.id);
+    }
+    m_Changes.clear();
+}
+
+TextureStreamer::Stats TextureStreamer::GetStats() {
+    Stats stats = m_Stats;
+    stats.textureCount = static_cast<uint32_t>(m_Textures.size() - m_FreeIds.size());
+    stats.residentBytes = m_ResidentBytes;
+    stats.budgetBytes = m_Budget;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    stats.pendingDecodes = m_PendingDecodes + static_cast<uint32_t>(m_Ready.size());
+    stats.decodeMs = m_DecodeMs;
+    return stats;
+}
+
+void TextureStreamer::PrintStats(std::ostream& os) {
+    Stats stats = GetStats();
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(2) << "Textures: " << stats.textureCount << " loaded, "
+         << stats.residentBytes / (1024.0 * 1024.0) << " / " << stats.budgetBytes / (1024.0 * 1024.0)
+         << " MiB resident, " << stats.bytesStreamedIn / (1024.0 * 1024.0) << " MiB in (" << stats.levelsStreamedIn
+         << " levels), " << stats.bytesEvicted / (1024.0 * 1024.0) << " MiB evicted (" << stats.levelsEvicted
+         << " levels), " << stats.decodeMs << " ms decoding";
+    os << line.str() << std::endl;
+}
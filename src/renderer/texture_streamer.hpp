@@ -0,0 +1,185 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "vulkan_context.hpp"
+#include "memory_allocator.hpp"
+#include "frame_tracker.hpp"
+#include "ktx2_file.hpp"
+#include "bindless_table.hpp"
+#include "../scene/camera.hpp"
+
+// KTX2 textures whose mips stream in and out under a VRAM budget. Loading a
+// texture reads its header and decodes the mip tail (every level of
+// MIP_TAIL_SIZE or less), which then stays resident. Finer levels are
+// requested from the screen-space size of what the texture is drawn on
+// (Touch, against the camera from SetView), one level at a time, and read by
+// background decode threads. When a request does not fit in the budget, the
+// least recently touched textures give up their finest levels first.
+//
+// A texture's image only holds its resident levels, so changing them
+// creates a new image: levels still needed are copied over on the GPU, the
+// new ones come from a per-frame staging area, and the old image goes
+// through the deletion queue. Everything is recorded into the frame's
+// command buffer. Main thread only, apart from the decode threads.
+class TextureStreamer {
+public:
+    using TextureId = uint32_t;
+
+    static constexpr VkDeviceSize DEFAULT_BUDGET = 256ull << 20;
+    static constexpr VkDeviceSize DEFAULT_STAGING_PER_FRAME = 16ull << 20;
+    static constexpr uint32_t MIP_TAIL_SIZE = 64;
+    static constexpr uint32_t DECODE_THREADS = 2;
+    static constexpr uint32_t MAX_PENDING_DECODES = 16;
+
+    struct Stats {
+        uint32_t textureCount = 0;
+        VkDeviceSize residentBytes = 0;     // Level data of resident mips, tails included
+        VkDeviceSize budgetBytes = 0;
+        uint64_t levelsStreamedIn = 0;
+        uint64_t bytesStreamedIn = 0;
+        uint64_t levelsEvicted = 0;
+        uint64_t bytesEvicted = 0;
+        uint32_t pendingDecodes = 0;
+        double decodeMs = 0.0;              // Summed over the decode threads
+    };
+
+    TextureStreamer(VulkanContext& context, uint32_t frameCount = DEFAULT_FRAMES_IN_FLIGHT,
+                    VkDeviceSize budget = DEFAULT_BUDGET, VkDeviceSize stagingPerFrame = DEFAULT_STAGING_PER_FRAME);
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // Reads the KTX2 header and queues the mip tail. The texture has no
+    // image until IsResident. Throws for files or formats that cannot be used.
+    TextureId Load(const std::string& path);
+    // The id may be reused by a later Load
+    void Release(TextureId id);
+
+    // Viewpoint that Touch measures screen-space sizes from
+    void SetView(const Camera& camera, uint32_t viewportHeight);
+    // The texture is drawn this frame, mapped once across a sphere of
+    // radius around center
+    void Touch(TextureId id, const glm::vec3& center, float radius);
+
+    // Once per frame at the start of cmd, after the frame slot's previous
+    // submission has completed: applies finished decodes, evicts under
+    // budget pressure and queues new decodes for what was touched
+    void RecordUpdates(VkCommandBuffer cmd, uint32_t frameIndex);
+
+    bool IsResident(TextureId id) const { return m_Textures[id].view != VK_NULL_HANDLE; }
+    // In SHADER_READ_ONLY_OPTIMAL; changes whenever resident levels do
+    VkImageView GetView(TextureId id) const { return m_Textures[id].view; }
+    // Finest resident level, in the file's numbering
+    uint32_t GetResidentLevel(TextureId id) const { return m_Textures[id].residentLevel; }
+    // Textures whose view changed in the last RecordUpdates
+    const std::vector<TextureId>& GetChanged() const { return m_Changed; }
+    // Trilinear, repeat; mip 0 of a view is its finest resident level
+    VkSampler GetSampler() const { return m_Sampler; }
+
+    // Registers every texture's view in table, kept current as levels
+    // change. Before the first Load; table must outlive the streamer's use.
+    void SetBindless(BindlessTable* table) { m_Bindless = table; }
+    // Bindless image handle, INVALID_HANDLE until the texture is resident
+    BindlessTable::Handle GetHandle(TextureId id) const {
+        return IsResident(id) ? m_Textures[id].handle : BindlessTable::INVALID_HANDLE;
+    }
+
+    void SetBudget(VkDeviceSize budget) { m_Budget = budget; }
+    Stats GetStats();
+    void PrintStats(std::ostream& os);
+
+private:
+    static constexpr uint32_t NO_LEVEL = UINT32_MAX;
+
+    struct Texture {
+        std::shared_ptr<const Ktx2File> file;   // Null for free slots
+        AllocatedImage image;
+        VkImageView view = VK_NULL_HANDLE;
+        uint32_t generation = 0;                // Bumped by Release, to drop stale decodes
+        uint32_t levelCount = 0;
+        uint32_t tailLevel = 0;                 // First level of the mip tail
+        uint32_t minLevel = 0;                  // Finest level that fits in the staging area
+        uint32_t residentLevel = 0;             // levelCount while nothing is resident
+        uint32_t targetLevel = 0;               // residentLevel after this frame's changes
+        uint32_t wantedLevel = 0;               // From this frame's touches
+        uint32_t pendingLevel = NO_LEVEL;       // First level of the decode in flight
+        uint64_t lastTouched = 0;               // Update index
+        BindlessTable::Handle handle = BindlessTable::INVALID_HANDLE;
+    };
+
+    struct DecodeRequest {
+        TextureId id;
+        uint32_t generation;
+        uint32_t first;
+        uint32_t last;
+        std::shared_ptr<const Ktx2File> file;
+    };
+
+    struct DecodeResult {
+        TextureId id;
+        uint32_t generation;
+        uint32_t first;
+        uint32_t last;
+        std::vector<uint8_t> data;              // Levels [first, last), finest first; empty on failure
+    };
+
+    // One recreated image, applied in RecordUpdates
+    struct Change {
+        TextureId id;
+        uint32_t oldLevel;
+        uint32_t newLevel;
+        AllocatedImage image;
+        VkImageView view;
+        std::vector<VkBufferImageCopy> copies;  // Levels [newLevel, oldLevel) from staging when growing
+    };
+
+    VulkanContext& m_Context;
+    uint32_t m_FrameCount;
+    VkDeviceSize m_Budget;
+    VkDeviceSize m_StagingPerFrame;
+    AllocatedBuffer m_Staging;
+    VkSampler m_Sampler = VK_NULL_HANDLE;
+    BindlessTable* m_Bindless = nullptr;
+
+    std::vector<Texture> m_Textures;
+    std::vector<TextureId> m_FreeIds;
+    std::vector<TextureId> m_Changed;
+    std::vector<Change> m_Changes;
+    uint64_t m_UpdateIndex = 1;
+    VkDeviceSize m_ResidentBytes = 0;
+    VkDeviceSize m_PendingBytes = 0;            // Level data of decodes in flight
+
+    glm::vec3 m_Eye{0.0f};
+    float m_PixelsPerUnit = 1.0f;               // Screen pixels per world unit at distance 1
+
+    // Decode threads
+    std::vector<std::thread> m_Threads;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::deque<DecodeRequest> m_Requests;
+    std::vector<DecodeResult> m_Results;
+    std::vector<DecodeResult> m_Ready;          // Finished, waiting for staging space
+    double m_DecodeMs = 0.0;
+    bool m_Stop = false;
+    uint32_t m_PendingDecodes = 0;
+
+    Stats m_Stats;
+
+    void DecodeLoop();
+    void QueueDecode(TextureId id, uint32_t first, uint32_t last, bool urgent);
+    VkDeviceSize GetLevelBytes(const Texture& texture, uint32_t first, uint32_t last) const;
+    bool Evict(VkDeviceSize needed);
+    void CreateImage(const Texture& texture, uint32_t level, AllocatedImage& image, VkImageView& view);
+    void DestroyImage(Texture& texture);
+    void RecordChanges(VkCommandBuffer cmd);
+};
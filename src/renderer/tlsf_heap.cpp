@@ -0,0 +1,235 @@
+#include "../stdafx.h"
+#include "tlsf_heap.hpp"
+
+#include <algorithm>
+#include <bit>
+
+TlsfHeap::TlsfHeap(uint64_t size)
+    : m_Size(size & ~(MIN_BLOCK_SIZE - 1))
+{
+    for (auto& heads : m_FreeHeads) {
+        std::fill(std::begin(heads), std::end(heads), INVALID);
+    }
+
+    uint32_t index = NewNode();
+    m_Blocks[index].offset = 0;
+    m_Blocks[index].size = m_Size;
+    InsertFree(index);
+}
+
+void TlsfHeap::Mapping(uint64_t size, uint32_t& fl, uint32_t& sl) {
+    if (size < SL_COUNT) {
+        fl = 0;
+        sl = static_cast<uint32_t>(size);
+        return;
+    }
+
+    uint32_t log2 = static_cast<uint32_t>(std::bit_width(size)) - 1;
+    fl = log2 - SL_BITS + 1;
+    sl = static_cast<uint32_t>(size >> (log2 - SL_BITS)) - SL_COUNT;
+}
+
+uint32_t TlsfHeap::FindSuitable(uint64_t size) const {
+    // Round up to the next list boundary so every block in the list found fits
+    if (size >= SL_COUNT) {
+        uint32_t log2 = static_cast<uint32_t>(std::bit_width(size)) - 1;
+        uint64_t round = (1ull << (log2 - SL_BITS)) - 1;
+        if (size > UINT64_MAX - round) {
+            return INVALID;
+        }
+        size += round;
+    }
+
+    uint32_t fl, sl;
+    Mapping(size, fl, sl);
+    if (fl >= FL_COUNT) {
+        return INVALID;
+    }
+
+    uint32_t slMap = m_SlBitmap[fl] & (~0u << sl);
+    if (slMap == 0) {
+        uint64_t flMap = fl + 1 < FL_COUNT ? m_FlBitmap & (~0ull << (fl + 1)) : 0;
+        if (flMap == 0) {
+            return INVALID;
+        }
+        fl = static_cast<uint32_t>(std::countr_zero(flMap));
+        slMap = m_SlBitmap[fl];
+    }
+    sl = static_cast<uint32_t>(std::countr_zero(slMap));
+    return m_FreeHeads[fl][sl];
+}
+
+uint32_t TlsfHeap::NewNode() {
+    if (!m_UnusedNodes.empty()) {
+        uint32_t index = m_UnusedNodes.back();
+        m_UnusedNodes.pop_back();
+        m_Blocks[index] = Block{};
+        return index;
+    }
+
+    m_Blocks.emplace_back();
+    return static_cast<uint32_t>(m_Blocks.size() - 1);
+}
+
+void TlsfHeap::InsertFree(uint32_t index) {
+    Block& block = m_Blocks[index];
+    uint32_t fl, sl;
+    Mapping(block.size, fl, sl);
+
+    block.free = true;
+    block.prevFree = INVALID;
+    block.nextFree = m_FreeHeads[fl][sl];
+    if (block.nextFree != INVALID) {
+        m_Blocks[block.nextFree].prevFree = index;
+    }
+    m_FreeHeads[fl][sl] = index;
+
+    m_FlBitmap |= 1ull << fl;
+    m_SlBitmap[fl] |= 1u << sl;
+}
+
+void TlsfHeap::RemoveFree(uint32_t index) {
+    Block& block = m_Blocks[index];
+    uint32_t fl, sl;
+    Mapping(block.size, fl, sl);
+
+    if (block.prevFree != INVALID) {
+        m_Blocks[block.prevFree].nextFree = block.nextFree;
+    } else {
+        m_FreeHeads[fl][sl] = block.nextFree;
+    }
+    if (block.nextFree != INVALID) {
+        m_Blocks[block.nextFree].prevFree = block.prevFree;
+    }
+
+    if (m_FreeHeads[fl][sl] == INVALID) {
+        m_SlBitmap[fl] &= ~(1u << sl);
+        if (m_SlBitmap[fl] == 0) {
+            m_FlBitmap &= ~(1ull << fl);
+        }
+    }
+
+    block.free = false;
+    block.prevFree = INVALID;
+    block.nextFree = INVALID;
+}
+
+// Carves everything past size off the (non-free) block at index into a new free block
+void TlsfHeap::Split(uint32_t index, uint64_t size) {
+    if (m_Blocks[index].size - size < MIN_BLOCK_SIZE) {
+        return;
+    }
+
+    uint32_t rest = NewNode();
+    Block& block = m_Blocks[index];
+    Block& remainder = m_Blocks[rest];
+    remainder.offset = block.offset + size;
+    remainder.size = block.size - size;
+    remainder.prevPhys = index;
+    remainder.nextPhys = block.nextPhys;
+    if (block.nextPhys != INVALID) {
+        m_Blocks[block.nextPhys].prevPhys = rest;
+    }
+    block.nextPhys = rest;
+    block.size = size;
+
+    InsertFree(rest);
+}
+
+// Coalesces the block at index with free physical neighbours, returns the surviving node
+uint32_t TlsfHeap::Merge(uint32_t index) {
+    uint32_t next = m_Blocks[index].nextPhys;
+    if (next != INVALID && m_Blocks[next].free) {
+        RemoveFree(next);
+        m_Blocks[index].size += m_Blocks[next].size;
+        m_Blocks[index].nextPhys = m_Blocks[next].nextPhys;
+        if (m_Blocks[next].nextPhys != INVALID) {
+            m_Blocks[m_Blocks[next].nextPhys].prevPhys = index;
+        }
+        m_UnusedNodes.push_back(next);
+    }
+
+    uint32_t prev = m_Blocks[index].prevPhys;
+    if (prev != INVALID && m_Blocks[prev].free) {
+        RemoveFree(prev);
+        m_Blocks[prev].size += m_Blocks[index].size;
+        m_Blocks[prev].nextPhys = m_Blocks[index].nextPhys;
+        if (m_Blocks[index].nextPhys != INVALID) {
+            m_Blocks[m_Blocks[index].nextPhys].prevPhys = prev;
+        }
+        m_UnusedNodes.push_back(index);
+        index = prev;
+    }
+
+    return index;
+}
+
+uint32_t TlsfHeap::Allocate(uint64_t size, uint64_t alignment, uint64_t& offset) {
+    // Block offsets and sizes stay MIN_BLOCK_SIZE-aligned, so only larger
+    // alignments need slack in the search size
+    size = std::max<uint64_t>((size + MIN_BLOCK_SIZE - 1) & ~(MIN_BLOCK_SIZE - 1), MIN_BLOCK_SIZE);
+    alignment = std::max<uint64_t>(alignment, MIN_BLOCK_SIZE);
+    uint64_t searchSize = size + (alignment - MIN_BLOCK_SIZE);
+
+    uint32_t index = FindSuitable(searchSize);
+    if (index == INVALID) {
+        return INVALID;
+    }
+    RemoveFree(index);
+
+    uint64_t aligned = (m_Blocks[index].offset + alignment - 1) & ~(alignment - 1);
+    uint64_t padding = aligned - m_Blocks[index].offset;
+    if (padding > 0) {
+        // Give the alignment gap back as its own free block. The block we
+        // took was free, so its previous neighbour is in use and cannot merge.
+        uint32_t front = NewNode();
+        Block& block = m_Blocks[index];
+        Block& gap = m_Blocks[front];
+        gap.offset = block.offset;
+        gap.size = padding;
+        gap.prevPhys = block.prevPhys;
+        gap.nextPhys = index;
+        if (block.prevPhys != INVALID) {
+            m_Blocks[block.prevPhys].nextPhys = front;
+        }
+        block.prevPhys = front;
+        block.offset = aligned;
+        block.size -= padding;
+        InsertFree(front);
+    }
+
+    Split(index, size);
+
+    m_UsedBytes += m_Blocks[index].size;
+    m_AllocationCount++;
+    offset = m_Blocks[index].offset;
+    return index;
+}
+
+void TlsfHeap::Free(uint32_t handle) {
+    if (handle == INVALID || handle >= m_Blocks.size() || m_Blocks[handle].free) {
+        return;
+    }
+
+    m_UsedBytes -= m_Blocks[handle].size;
+    m_AllocationCount--;
+    InsertFree(Merge(handle));
+}
+
+TlsfHeap::Stats TlsfHeap::GetStats() const {
+    Stats stats;
+    stats.size = m_Size;
+    stats.usedBytes = m_UsedBytes;
+    stats.freeBytes = m_Size - m_UsedBytes;
+    stats.allocationCount = m_AllocationCount;
+
+    for (uint32_t fl = 0; fl < FL_COUNT; fl++) {
+        for (uint32_t sl = 0; sl < SL_COUNT; sl++) {
+            for (uint32_t i = m_FreeHeads[fl][sl]; i != INVALID; i = m_Blocks[i].nextFree) {
+                stats.freeBlockCount++;
+                stats.largestFreeBlock = std::max(stats.largestFreeBlock, m_Blocks[i].size);
+            }
+        }
+    }
+    return stats;
+}
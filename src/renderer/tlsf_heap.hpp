@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Two-level segregated fit allocator over an abstract [0, size) range. It
+// only hands out offsets, so the same code manages any VkDeviceMemory block.
+// Allocation and free are O(1): a first-level bitmap picks the power-of-two
+// class, a second-level bitmap picks one of SL_COUNT linear subdivisions.
+class TlsfHeap {
+public:
+    static constexpr uint32_t INVALID = UINT32_MAX;
+
+    struct Stats {
+        uint64_t size = 0;
+        uint64_t usedBytes = 0;
+        uint64_t freeBytes = 0;
+        uint64_t largestFreeBlock = 0;
+        uint32_t allocationCount = 0;
+        uint32_t freeBlockCount = 0;
+    };
+
+    explicit TlsfHeap(uint64_t size);
+
+    // Returns a handle for Free, or INVALID when no free block fits.
+    // alignment must be a power of two.
+    uint32_t Allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+    void Free(uint32_t handle);
+
+    uint64_t GetSize() const { return m_Size; }
+    bool IsEmpty() const { return m_AllocationCount == 0; }
+    Stats GetStats() const;
+
+private:
+    static constexpr uint32_t SL_BITS = 4;
+    static constexpr uint32_t SL_COUNT = 1u << SL_BITS;
+    static constexpr uint32_t FL_COUNT = 64;
+    static constexpr uint64_t MIN_BLOCK_SIZE = 16;
+
+    struct Block {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t prevPhys = INVALID;
+        uint32_t nextPhys = INVALID;
+        uint32_t prevFree = INVALID;
+        uint32_t nextFree = INVALID;
+        bool free = false;
+    };
+
+    uint64_t m_Size;
+    uint64_t m_UsedBytes = 0;
+    uint32_t m_AllocationCount = 0;
+
+    std::vector<Block> m_Blocks;
+    std::vector<uint32_t> m_UnusedNodes;
+    uint64_t m_FlBitmap = 0;
+    uint32_t m_SlBitmap[FL_COUNT] = {};
+    uint32_t m_FreeHeads[FL_COUNT][SL_COUNT];
+
+    static void Mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+    uint32_t FindSuitable(uint64_t size) const;
+    uint32_t NewNode();
+    void InsertFree(uint32_t index);
+    void RemoveFree(uint32_t index);
+    void Split(uint32_t index, uint64_t size);
+    uint32_t Merge(uint32_t index);
+};
@@ -0,0 +1,126 @@
+#include "../stdafx.h"
+#include "uniform_ring.hpp"
+#include "deletion_queue.hpp"
+
+#include <cstring>
+
+UniformRing::UniformRing(VulkanContext& context, VkDeviceSize capacityPerFrame, uint32_t frameCount)
+    : m_Context(context),
+      m_Arena(std::make_unique<LinearArena>(context.GetAllocator(), capacityPerFrame, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                            frameCount)),
+      m_Alignment(context.GetDevice().physical_device.properties.limits.minUniformBufferOffsetAlignment),
+      m_FrameCount(frameCount)
+{
+    auto& disp = m_Context.GetDispatchTable();
+
+    VkDescriptorSetLayoutBinding bindings[2]{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
+
+    if (disp.createDescriptorSetLayout(&layoutInfo, nullptr, &m_SetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create uniform descriptor set layout");
+    }
+
+    CreateSet();
+}
+
+UniformRing::~UniformRing() {
+    auto& disp = m_Context.GetDispatchTable();
+    disp.destroyDescriptorPool(m_DescriptorPool, nullptr);
+    disp.destroyDescriptorSetLayout(m_SetLayout, nullptr);
+}
+
+void UniformRing::CreateSet() {
+    auto& disp = m_Context.GetDispatchTable();
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSize.descriptorCount = 2;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    if (disp.createDescriptorPool(&poolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create uniform descriptor pool");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_SetLayout;
+
+    if (disp.allocateDescriptorSets(&allocInfo, &m_Set) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate uniform descriptor set");
+    }
+
+    // Written once per buffer: every frame only changes the dynamic offsets
+    VkDescriptorBufferInfo bufferInfos[2]{};
+    bufferInfos[0] = {m_Arena->GetBuffer(), 0, sizeof(CameraUniforms)};
+    bufferInfos[1] = {m_Arena->GetBuffer(), 0, sizeof(ObjectUniforms)};
+
+    VkWriteDescriptorSet writes[2]{};
+    for (uint32_t i = 0; i < 2; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_Set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    disp.updateDescriptorSets(2, writes, 0, nullptr);
+}
+
+bool UniformRing::Reserve(VkDeviceSize bytesPerFrame) {
+    VkDeviceSize capacity = m_Arena->GetCapacityPerFrame();
+    if (bytesPerFrame <= capacity) {
+        return false;
+    }
+    while (capacity < bytesPerFrame) {
+        capacity *= 2;
+    }
+
+    // Frames in flight still read the old buffer through the old set, so
+    // both are dropped through the deletion queue rather than rewritten
+    auto& disp = m_Context.GetDispatchTable();
+    std::shared_ptr<LinearArena> oldArena = std::move(m_Arena);
+    m_Context.GetDeletionQueue().Push([&disp, pool = m_DescriptorPool, oldArena]() {
+        disp.destroyDescriptorPool(pool, nullptr);
+    });
+
+    m_Arena = std::make_unique<LinearArena>(m_Context.GetAllocator(), capacity, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                            m_FrameCount);
+    CreateSet();
+    return true;
+}
+
+void UniformRing::BeginFrame(uint32_t frameIndex) {
+    m_Arena->BeginFrame(frameIndex);
+}
+
+uint32_t UniformRing::Push(const void* data, VkDeviceSize size) {
+    LinearArena::Slice slice = m_Arena->Allocate(size, m_Alignment);
+    if (slice.buffer == VK_NULL_HANDLE) {
+        throw std::runtime_error("Uniform ring is full (" + std::to_string(m_Arena->GetCapacityPerFrame() >> 10) +
+                                 " KiB per frame); Reserve room before recording");
+    }
+
+    if (data != nullptr) {
+        std::memcpy(slice.mapped, data, size);
+    }
+    return static_cast<uint32_t>(slice.offset);
+}
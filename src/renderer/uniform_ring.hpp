@@ -0,0 +1,69 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include "vulkan_context.hpp"
+#include "linear_arena.hpp"
+#include "frame_tracker.hpp"
+
+// Uniform blocks read by triangle.vert (set 0, bindings 0 and 1)
+struct CameraUniforms {
+    glm::mat4 projection;
+    glm::mat4 view;
+};
+
+struct ObjectUniforms {
+    glm::mat4 model;
+};
+
+// Per-frame-in-flight uniform storage behind a single descriptor set. Data is
+// written straight into persistently mapped memory and addressed with dynamic
+// offsets, so a frame costs no map/unmap, allocation or descriptor update.
+// Reserve grows it, with a new buffer and set, for frames that need more.
+class UniformRing {
+public:
+    static constexpr VkDeviceSize DEFAULT_CAPACITY_PER_FRAME = 8ull << 20;
+
+    UniformRing(VulkanContext& context, VkDeviceSize capacityPerFrame = DEFAULT_CAPACITY_PER_FRAME,
+                uint32_t frameCount = DEFAULT_FRAMES_IN_FLIGHT);
+    ~UniformRing();
+
+    UniformRing(const UniformRing&) = delete;
+    UniformRing& operator=(const UniformRing&) = delete;
+
+    // Must only be called once the frame's previous submission has completed
+    void BeginFrame(uint32_t frameIndex);
+
+    // Returns the dynamic offset of the block. A null data pointer reserves
+    // the space without writing it, leaving whatever this frame slot held
+    // last time; allocations made in the same order land at the same offset.
+    // Safe to call from several recording threads at once.
+    uint32_t Push(const void* data, VkDeviceSize size);
+
+    template<typename T>
+    uint32_t Push(const T& value) { return Push(&value, sizeof(T)); }
+
+    // Space a Push of size takes up, alignment included
+    VkDeviceSize GetAllocationSize(VkDeviceSize size) const { return (size + m_Alignment - 1) & ~(m_Alignment - 1); }
+    // Grows every frame's region to at least bytesPerFrame, doubling. Frames
+    // already recorded keep the old buffer and set until they complete; the
+    // new regions start out undefined. Returns true when it grew. Call
+    // before BeginFrame.
+    bool Reserve(VkDeviceSize bytesPerFrame);
+
+    VkDescriptorSetLayout GetSetLayout() const { return m_SetLayout; }
+    // Changes when Reserve grows the ring
+    VkDescriptorSet GetSet() const { return m_Set; }
+
+private:
+    VulkanContext& m_Context;
+    std::unique_ptr<LinearArena> m_Arena;
+    VkDeviceSize m_Alignment;
+    uint32_t m_FrameCount;
+    VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_Set = VK_NULL_HANDLE;
+
+    // Pool and set pointing at the current arena
+    void CreateSet();
+};
@@ -0,0 +1,397 @@
+#include "../stdafx.h"
+#include "upload_service.hpp"
+#include "../core/profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+UploadService::UploadService(VulkanContext& context, VkDeviceSize capacity, VkDeviceSize frameBudget)
+    : m_Context(context), m_Capacity(capacity), m_FrameBudget(frameBudget),
+      m_TransferOwnership(context.HasSeparateTransferQueue())
+{
+    auto& disp = m_Context.GetDispatchTable();
+
+    m_Buffer = m_Context.GetAllocator().CreateBuffer(m_Capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = m_Context.GetTransferQueueIndex();
+
+    if (disp.createCommandPool(&poolInfo, nullptr, &m_CommandPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create upload command pool");
+    }
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_CommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    for (auto& batch : m_Batches) {
+        if (disp.allocateCommandBuffers(&allocInfo, &batch.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate upload command buffer");
+        }
+    }
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (disp.createSemaphore(&semaphoreInfo, nullptr, &m_Timeline) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create upload timeline");
+    }
+}
+
+UploadService::~UploadService() {
+    // Queued requests are dropped; only what was submitted is waited for
+    for (uint32_t i = 0; i < MAX_BATCHES; i++) {
+        Retire(true);
+    }
+
+    auto& disp = m_Context.GetDispatchTable();
+    disp.destroySemaphore(m_Timeline, nullptr);
+    disp.destroyCommandPool(m_CommandPool, nullptr);
+    m_Context.GetAllocator().DestroyBuffer(m_Buffer);
+}
+
+UploadService::Ticket UploadService::Upload(VkBuffer dst, VkDeviceSize dstOffset, std::vector<uint8_t> data) {
+    return Upload(dst, dstOffset, std::make_shared<const std::vector<uint8_t>>(std::move(data)));
+}
+
+UploadService::Ticket UploadService::Upload(VkBuffer dst, VkDeviceSize dstOffset,
+                                            std::shared_ptr<const std::vector<uint8_t>> data) {
+    Ticket ticket = m_NextTicket++;
+    m_Stats.bytesQueued += data->size();
+    m_QueuedPerBuffer[dst]++;
+    m_Requests.push_back({ticket, dst, dstOffset, std::move(data)});
+    return ticket;
+}
+
+void UploadService::Update() {
+    if (m_Requests.empty()) {
+        Retire(false);
+        return;
+    }
+
+    JB_PROFILE_ZONE("Uploads");
+    Retire(false);
+    // Every batch still in flight: submitting would wait for the oldest, so
+    // staging resumes on a later Update instead
+    if (m_Batches[m_NextBatch].inFlight) {
+        return;
+    }
+    Stage(m_FrameBudget, 0, false);
+    Submit();
+}
+
+void UploadService::Stage(VkDeviceSize budget, Ticket until, bool wait) {
+    char* mapped = static_cast<char*>(m_Buffer.allocation.mapped);
+
+    while (!m_Requests.empty()) {
+        Request& request = m_Requests.front();
+        if (until != 0 && request.ticket > until) {
+            break;
+        }
+
+        VkDeviceSize remaining = request.data->size() - request.staged;
+        if (remaining > 0) {
+            if (budget == 0) {
+                break;
+            }
+
+            // Chunks of half the ring keep one chunk copying while the next is written
+            VkDeviceSize chunk = std::min({remaining, budget, m_Capacity / 2});
+            VkDeviceSize offset;
+            if (!TryReserve(chunk, offset)) {
+                if (!wait) {
+                    break;
+                }
+                Submit();
+                Retire(true);
+                continue;
+            }
+
+            std::memcpy(mapped + offset, request.data->data() + request.staged, chunk);
+            m_Pending.push_back({request.dst, {offset, request.dstOffset + request.staged, chunk}});
+            request.staged += chunk;
+            m_PendingBytes += chunk;
+            m_Stats.bytesQueued -= chunk;
+            budget -= chunk;
+            if (request.staged < request.data->size()) {
+                continue;
+            }
+        }
+
+        // Fully staged. Once no other request targets the destination its
+        // ownership can go to the graphics family.
+        auto it = m_QueuedPerBuffer.find(request.dst);
+        if (--it->second == 0) {
+            m_QueuedPerBuffer.erase(it);
+            if (m_TransferOwnership) {
+                m_PendingReleases.push_back(request.dst);
+            }
+        }
+        m_StagedTicket = request.ticket;
+        m_Requests.pop_front();
+    }
+}
+
+bool UploadService::TryReserve(VkDeviceSize size, VkDeviceSize& offset) {
+    uint64_t start = (m_Head + COPY_ALIGNMENT - 1) & ~(COPY_ALIGNMENT - 1);
+    if (start % m_Capacity + size > m_Capacity) {
+        start = (start / m_Capacity + 1) * m_Capacity;      // Don't straddle the end of the ring
+    }
+    if (start + size - m_Tail > m_Capacity) {
+        return false;
+    }
+    m_Head = start + size;
+    offset = start % m_Capacity;
+    return true;
+}
+
+void UploadService::Submit() {
+    if (m_Pending.empty() && m_PendingReleases.empty()) {
+        return;
+    }
+
+    auto& disp = m_Context.GetDispatchTable();
+
+    // The next slot is always the oldest, so waiting on it keeps retirement in order
+    Batch& batch = m_Batches[m_NextBatch];
+    if (batch.inFlight) {
+        Retire(true);
+    }
+
+    disp.resetCommandBuffer(batch.commandBuffer, 0);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (disp.beginCommandBuffer(batch.commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording upload command buffer");
+    }
+
+    // One vkCmdCopyBuffer per run of copies into the same destination
+    std::vector<VkBufferCopy> regions;
+    regions.reserve(m_Pending.size());
+    for (size_t i = 0; i < m_Pending.size();) {
+        regions.clear();
+        size_t j = i;
+        for (; j < m_Pending.size() && m_Pending[j].dst == m_Pending[i].dst; j++) {
+            regions.push_back(m_Pending[j].region);
+        }
+        disp.cmdCopyBuffer(batch.commandBuffer, m_Buffer.buffer, m_Pending[i].dst,
+                           static_cast<uint32_t>(regions.size()), regions.data());
+        i = j;
+    }
+
+    // Release half of the queue family ownership transfers; RecordAcquires
+    // records the matching acquires. The barrier also covers copies into the
+    // same buffer from earlier batches on this queue.
+    uint64_t value = m_NextValue++;
+    if (!m_PendingReleases.empty()) {
+        std::vector<VkBufferMemoryBarrier> releases(m_PendingReleases.size());
+        for (size_t i = 0; i < m_PendingReleases.size(); i++) {
+            VkBufferMemoryBarrier& barrier = releases[i];
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+            barrier.srcQueueFamilyIndex = m_Context.GetTransferQueueIndex();
+            barrier.dstQueueFamilyIndex = m_Context.GetGraphicsQueueIndex();
+            barrier.buffer = m_PendingReleases[i];
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+            m_Acquires.push_back({value, m_PendingReleases[i]});
+        }
+        disp.cmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                0, 0, nullptr, static_cast<uint32_t>(releases.size()), releases.data(), 0, nullptr);
+    }
+
+    if (disp.endCommandBuffer(batch.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record upload command buffer");
+    }
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &value;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_Timeline;
+
+    if (disp.queueSubmit(m_Context.GetTransferQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit uploads");
+    }
+
+    batch.value = value;
+    batch.head = m_Head;
+    batch.bytes = m_PendingBytes;
+    batch.ticket = m_StagedTicket;
+    batch.inFlight = true;
+
+    if (m_Stats.submitCount == 0) {
+        m_FirstSubmit = std::chrono::steady_clock::now();
+    }
+    m_Stats.submitCount++;
+    m_Pending.clear();
+    m_PendingReleases.clear();
+    m_PendingBytes = 0;
+    m_NextBatch = (m_NextBatch + 1) % MAX_BATCHES;
+}
+
+void UploadService::Retire(bool wait) {
+    auto& disp = m_Context.GetDispatchTable();
+    if (disp.getSemaphoreCounterValue(m_Timeline, &m_CompletedValue) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to read upload timeline");
+    }
+
+    // Walk from the oldest slot; the first unfinished batch stops the walk
+    for (uint32_t i = 0; i < MAX_BATCHES; i++) {
+        Batch& batch = m_Batches[(m_NextBatch + i) % MAX_BATCHES];
+        if (!batch.inFlight) {
+            continue;
+        }
+
+        if (batch.value > m_CompletedValue) {
+            if (!wait) {
+                return;
+            }
+
+            VkSemaphoreWaitInfo waitInfo{};
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &m_Timeline;
+            waitInfo.pValues = &batch.value;
+            if (disp.waitSemaphores(&waitInfo, UINT64_MAX) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to wait for uploads");
+            }
+            m_CompletedValue = batch.value;
+            wait = false;
+        }
+        RetireBatch(batch);
+    }
+}
+
+void UploadService::RetireBatch(Batch& batch) {
+    m_Tail = batch.head;
+    m_CompletedTicket = std::max(m_CompletedTicket, batch.ticket);
+    m_Stats.bytesUploaded += batch.bytes;
+    m_Stats.busyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_FirstSubmit).count();
+    batch.inFlight = false;
+}
+
+bool UploadService::IsComplete(Ticket ticket) {
+    if (ticket <= m_CompletedTicket) {
+        return true;
+    }
+    Retire(false);
+    return ticket <= m_CompletedTicket;
+}
+
+void UploadService::Wait(Ticket ticket) {
+    if (IsComplete(ticket)) {
+        return;
+    }
+
+    JB_PROFILE_ZONE("WaitForUpload");
+    if (ticket > m_StagedTicket) {
+        Stage(UINT64_MAX, ticket, true);
+    }
+    Submit();
+    while (ticket > m_CompletedTicket) {
+        Retire(true);
+    }
+}
+
+void UploadService::WaitIdle() {
+    if (m_NextTicket > 1) {
+        Wait(m_NextTicket - 1);
+    }
+}
+
+uint64_t UploadService::GetValueFor(Ticket ticket) const {
+    // Batches hold increasing tickets, so the oldest one that reaches it
+    for (uint32_t i = 0; i < MAX_BATCHES; i++) {
+        const Batch& batch = m_Batches[(m_NextBatch + i) % MAX_BATCHES];
+        if (batch.inFlight && batch.ticket >= ticket) {
+            return batch.value;
+        }
+    }
+    return m_CompletedValue;
+}
+
+uint64_t UploadService::RecordAcquires(VkCommandBuffer cmd, Ticket required) {
+    Retire(false);
+    uint64_t target = m_CompletedValue;
+    if (required > m_CompletedTicket) {
+        if (required > m_StagedTicket) {
+            Stage(UINT64_MAX, required, true);
+            Submit();
+        }
+        target = std::max(m_CompletedValue, GetValueFor(required));
+    }
+
+    // Values already waited on by an earlier frame need no new wait. A
+    // completed value still gets one: it costs nothing and gives the frame a
+    // proper dependency on the copies.
+    if (target <= m_AcquiredValue) {
+        return 0;
+    }
+
+    m_AcquireBarriers.clear();
+    while (!m_Acquires.empty() && m_Acquires.front().value <= target) {
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                                VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT |
+                                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.srcQueueFamilyIndex = m_Context.GetTransferQueueIndex();
+        barrier.dstQueueFamilyIndex = m_Context.GetGraphicsQueueIndex();
+        barrier.buffer = m_Acquires.front().buffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        m_AcquireBarriers.push_back(barrier);
+        m_Acquires.pop_front();
+    }
+
+    if (!m_AcquireBarriers.empty()) {
+        // The frame waits for the timeline at CONSUMER_STAGES, which this
+        // barrier's first scope picks up
+        m_Context.GetDispatchTable().cmdPipelineBarrier(cmd, CONSUMER_STAGES, CONSUMER_STAGES, 0, 0, nullptr,
+            static_cast<uint32_t>(m_AcquireBarriers.size()), m_AcquireBarriers.data(), 0, nullptr);
+    }
+
+    m_AcquiredValue = target;
+    return target;
+}
+
+UploadService::Stats UploadService::GetStats() {
+    Retire(false);
+    return m_Stats;
+}
+
+void UploadService::PrintStats(std::ostream& os) {
+    Stats stats = GetStats();
+    // Formatted apart, so the caller's stream keeps its own flags
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(2) << "Streaming: " << stats.bytesUploaded / (1024.0 * 1024.0) << " MiB in "
+         << stats.submitCount << " submits on the " << (m_Context.HasSeparateTransferQueue() ? "transfer" : "graphics")
+         << " queue, " << stats.GetMBps() << " MB/s";
+    os << line.str() << std::endl;
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include "vulkan_context.hpp"
+#include "memory_allocator.hpp"
+
+// Streams data into new resources on the transfer queue, away from the
+// frame's submissions. Upload only queues the data; Update, once per frame,
+// copies up to a byte budget of it into a host-visible staging ring and
+// submits the copies on command buffers from the service's own pool. Each
+// submit signals the service's timeline semaphore with the next value, so a
+// frame that needs an upload waits on exactly that value rather than on the
+// whole transfer queue.
+//
+// Destinations are meant to be filled once before their first use (streamed
+// assets). When the transfer queue is a separate family, ownership of each
+// destination is released after its last queued upload and acquired by
+// RecordAcquires on the graphics side. Buffers rewritten while in use go
+// through the StagingRing instead.
+class UploadService {
+public:
+    static constexpr VkDeviceSize DEFAULT_CAPACITY = 64ull << 20;
+    static constexpr VkDeviceSize DEFAULT_FRAME_BUDGET = 8ull << 20;
+
+    // Increasing per Upload call; complete once every byte of that call and
+    // of all earlier calls has landed
+    using Ticket = uint64_t;
+
+    struct Stats {
+        uint64_t bytesQueued = 0;       // Waiting for staging space or budget
+        uint64_t bytesUploaded = 0;     // Completed on the GPU
+        uint32_t submitCount = 0;
+        double busyMs = 0.0;            // First submit until the last completion seen, so
+                                        // batches in flight together count once
+
+        double GetMBps() const { return busyMs > 0.0 ? bytesUploaded / (1024.0 * 1024.0) / (busyMs / 1000.0) : 0.0; }
+    };
+
+    UploadService(VulkanContext& context, VkDeviceSize capacity = DEFAULT_CAPACITY,
+                  VkDeviceSize frameBudget = DEFAULT_FRAME_BUDGET);
+    ~UploadService();
+
+    UploadService(const UploadService&) = delete;
+    UploadService& operator=(const UploadService&) = delete;
+
+    // Queues data for dst at dstOffset. The data is copied into staging
+    // memory over the following Updates.
+    Ticket Upload(VkBuffer dst, VkDeviceSize dstOffset, std::vector<uint8_t> data);
+    // Same, for data shared between several uploads
+    Ticket Upload(VkBuffer dst, VkDeviceSize dstOffset, std::shared_ptr<const std::vector<uint8_t>> data);
+
+    // Stages and submits up to the frame budget of queued data without ever
+    // blocking; call once per frame
+    void Update();
+
+    bool IsComplete(Ticket ticket);
+    // Blocks until ticket has completed, submitting whatever it needs first
+    void Wait(Ticket ticket);
+    void WaitIdle();
+
+    // Graphics side, at the start of a frame's command buffer: takes over the
+    // destinations whose uploads have completed, plus those needed by
+    // required (0 for none), which is submitted now if it was still queued.
+    // Returns the timeline value the frame's submission must wait for, or 0.
+    uint64_t RecordAcquires(VkCommandBuffer cmd, Ticket required = 0);
+    // Stages at which RecordAcquires' resources become readable
+    static constexpr VkPipelineStageFlags CONSUMER_STAGES =
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    VkSemaphore GetTimeline() const { return m_Timeline; }
+    Stats GetStats();
+    void PrintStats(std::ostream& os);
+
+private:
+    static constexpr uint32_t MAX_BATCHES = 4;
+    static constexpr VkDeviceSize COPY_ALIGNMENT = 16;
+
+    struct Request {
+        Ticket ticket;
+        VkBuffer dst;
+        VkDeviceSize dstOffset;
+        std::shared_ptr<const std::vector<uint8_t>> data;
+        VkDeviceSize staged = 0;        // Bytes already copied into the ring
+    };
+
+    struct PendingCopy {
+        VkBuffer dst;
+        VkBufferCopy region;
+    };
+
+    struct Batch {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        uint64_t value = 0;             // Timeline value signalled on completion
+        uint64_t head = 0;              // Ring position after this batch's data
+        uint64_t bytes = 0;
+        Ticket ticket = 0;              // Last ticket fully contained in this or an earlier batch
+        bool inFlight = false;
+    };
+
+    // Released destinations waiting for the graphics side to acquire them
+    struct PendingAcquire {
+        uint64_t value;
+        VkBuffer buffer;
+    };
+
+    VulkanContext& m_Context;
+    AllocatedBuffer m_Buffer;
+    VkDeviceSize m_Capacity;
+    VkDeviceSize m_FrameBudget;
+    VkCommandPool m_CommandPool = VK_NULL_HANDLE;
+    VkSemaphore m_Timeline = VK_NULL_HANDLE;
+    bool m_TransferOwnership;           // Transfer and graphics are different families
+
+    // Monotonic positions, wrapped with % m_Capacity
+    uint64_t m_Head = 0;
+    uint64_t m_Tail = 0;
+
+    std::deque<Request> m_Requests;
+    std::unordered_map<VkBuffer, uint32_t> m_QueuedPerBuffer;   // Requests not yet fully staged
+    Ticket m_NextTicket = 1;
+    Ticket m_StagedTicket = 0;          // Last ticket fully staged
+    Ticket m_CompletedTicket = 0;
+
+    std::vector<PendingCopy> m_Pending;
+    std::vector<VkBuffer> m_PendingReleases;
+    uint64_t m_PendingBytes = 0;
+
+    std::array<Batch, MAX_BATCHES> m_Batches;
+    uint32_t m_NextBatch = 0;
+    uint64_t m_NextValue = 1;
+    uint64_t m_CompletedValue = 0;
+    uint64_t m_AcquiredValue = 0;       // Covered by a graphics wait already
+    std::deque<PendingAcquire> m_Acquires;
+    std::vector<VkBufferMemoryBarrier> m_AcquireBarriers;
+    Stats m_Stats;
+    std::chrono::steady_clock::time_point m_FirstSubmit{};
+
+    // Copies queued data into the ring, up to budget bytes and stopping
+    // after ticket until. With wait it submits and blocks for ring space
+    // instead of stopping when the ring is full.
+    void Stage(VkDeviceSize budget, Ticket until, bool wait);
+    bool TryReserve(VkDeviceSize size, VkDeviceSize& offset);
+    void Submit();
+    void Retire(bool wait);
+    void RetireBatch(Batch& batch);
+    uint64_t GetValueFor(Ticket ticket) const;
+};
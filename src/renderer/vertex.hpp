@@ -0,0 +1,24 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Vertex input state handed to Pipeline: one entry per bound vertex buffer
+// plus the attributes read from them.
+struct VertexLayout {
+    std::vector<VkVertexInputBindingDescription> bindings;
+    std::vector<VkVertexInputAttributeDescription> attributes;
+};
+
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 color;
+
+    static VertexLayout GetLayout() {
+        VertexLayout layout;
+        layout.bindings.push_back({0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX});
+        layout.attributes.push_back({0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position)});
+        layout.attributes.push_back({1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color)});
+        return layout;
+    }
+};
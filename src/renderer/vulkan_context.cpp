@@ -1,12 +1,29 @@
 #include "../stdafx.h"
 #include "vulkan_context.hpp"
+#include "pipeline_cache.hpp"
+#include "memory_allocator.hpp"
+#include "deletion_queue.hpp"
 
-VulkanContext::VulkanContext(Window& window) {
-    // Create instance
+#include <algorithm>
+
+VulkanContext::VulkanContext(Window& window, const RendererConfig& config) {
+    Initialize(&window, config);
+}
+
+VulkanContext::VulkanContext(const RendererConfig& config) {
+    Initialize(nullptr, config);
+}
+
+void VulkanContext::Initialize(Window* window, const RendererConfig& config) {
+    // Create instance. Without a window no surface extensions are needed,
+    // which lets us run on hosts without a display server.
     vkb::InstanceBuilder instanceBuilder;
+    if (config.validation) {
+        instanceBuilder.use_default_debug_messenger().request_validation_layers();
+    }
     auto instanceRet = instanceBuilder
-        .use_default_debug_messenger()
-        .request_validation_layers()
+        .require_api_version(1, 2, 0)
+        .set_headless(window == nullptr)
         .build();
     
     if (!instanceRet) {
@@ -17,30 +34,89 @@ VulkanContext::VulkanContext(Window& window) {
     m_InstanceDispatch = m_Instance.make_table();
 
     // Create surface
-    VkSurfaceKHR surface = VK_NULL_HANDLE;
-    VkResult err = glfwCreateWindowSurface(m_Instance, 
-                                          window.GetHandle(), 
-                                          nullptr, 
-                                          &surface);
-    if (err) {
-        const char* errorMsg;
-        int ret = glfwGetError(&errorMsg);
-        throw std::runtime_error("Failed to create window surface");
-    }
-    m_Surface = surface;
+    if (window) {
+        VkSurfaceKHR surface = VK_NULL_HANDLE;
+        VkResult err = glfwCreateWindowSurface(m_Instance, 
+                                              window->GetHandle(), 
+                                              nullptr, 
+                                              &surface);
+        if (err) {
+            const char* errorMsg;
+            int ret = glfwGetError(&errorMsg);
+            throw std::runtime_error("Failed to create window surface");
+        }
+        m_Surface = surface;
+    }
 
     // Select physical device and create logical device
     vkb::PhysicalDeviceSelector physDeviceSelector(m_Instance);
-    auto physDeviceRet = physDeviceSelector
-        .set_surface(m_Surface)
-        .select();
+    if (m_Surface != VK_NULL_HANDLE) {
+        physDeviceSelector.set_surface(m_Surface);
+    }
+    // Frame tracking runs on a timeline semaphore
+    VkPhysicalDeviceVulkan12Features features12{};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.timelineSemaphore = VK_TRUE;
+    physDeviceSelector.set_required_features_12(features12);
+
+    auto physDeviceRet = physDeviceSelector.select();
     
     if (!physDeviceRet) {
         throw std::runtime_error("Failed to select physical device: " + 
                                physDeviceRet.error().message());
     }
     
-    vkb::DeviceBuilder deviceBuilder{physDeviceRet.value()};
+    vkb::PhysicalDevice physDevice = physDeviceRet.value();
+    // Lets the pipeline cache report hits and misses
+    physDevice.enable_extension_if_present(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+
+    // GPU-driven rendering: many indirect draws per call, the object index
+    // passed through firstInstance, and the draw count read from a buffer
+    VkPhysicalDeviceFeatures indirectFeatures{};
+    indirectFeatures.multiDrawIndirect = VK_TRUE;
+    indirectFeatures.drawIndirectFirstInstance = VK_TRUE;
+    physDevice.enable_features_if_present(indirectFeatures);
+    physDevice.enable_extension_if_present(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+    // Rendering straight into image views, without render pass and
+    // framebuffer objects to rebuild on resize. Its dependencies are core
+    // in 1.2.
+    if (config.dynamicRendering && physDevice.enable_extension_if_present(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)) {
+        VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+        dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+        dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+        m_DynamicRendering = physDevice.enable_extension_features_if_present(dynamicRenderingFeatures);
+    }
+
+    // Bindless resources: large partially bound arrays, written after the
+    // set is bound and indexed per instance. Core in 1.2, but optional.
+    if (config.bindless) {
+        VkPhysicalDeviceVulkan12Features indexingFeatures{};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+        indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+        indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        indexingFeatures.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+        m_DescriptorIndexing = physDevice.enable_extension_features_if_present(indexingFeatures);
+    }
+
+    // Lets the renderer see when a frame actually reached the display, for
+    // low-latency pacing and latency measurement
+    if (window && physDevice.enable_extension_if_present(VK_KHR_PRESENT_ID_EXTENSION_NAME)) {
+        VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+        presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+        presentIdFeatures.presentId = VK_TRUE;
+        VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+        presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+        presentWaitFeatures.presentWait = VK_TRUE;
+        m_PresentWait = physDevice.enable_extension_features_if_present(presentIdFeatures) &&
+                        physDevice.enable_extension_if_present(VK_KHR_PRESENT_WAIT_EXTENSION_NAME) &&
+                        physDevice.enable_extension_features_if_present(presentWaitFeatures);
+    }
+
+    vkb::DeviceBuilder deviceBuilder{physDevice};
     auto deviceRet = deviceBuilder.build();
     
     if (!deviceRet) {
@@ -50,6 +126,11 @@ VulkanContext::VulkanContext(Window& window) {
     
     m_Device = deviceRet.value();
     m_DispatchTable = m_Device.make_table();
+    m_EnabledExtensions = m_Device.physical_device.get_extensions();
+
+    m_PipelineCache = std::make_unique<PipelineCache>(*this, config.pipelineCachePath);
+    m_Allocator = std::make_unique<MemoryAllocator>(*this);
+    m_DeletionQueue = std::make_unique<DeletionQueue>();
 
     // Get queues
     auto graphicsQueueRet = m_Device.get_queue(vkb::QueueType::graphics);
@@ -59,6 +140,47 @@ VulkanContext::VulkanContext(Window& window) {
     }
     m_GraphicsQueue = graphicsQueueRet.value();
 
+    // Uploads go to their own queue when there is one, so they do not
+    // queue up behind rendering
+    m_TransferQueue = m_GraphicsQueue;
+    m_TransferQueueIndex = GetGraphicsQueueIndex();
+    auto dedicatedQueueRet = m_Device.get_dedicated_queue(vkb::QueueType::transfer);
+    auto dedicatedIndexRet = m_Device.get_dedicated_queue_index(vkb::QueueType::transfer);
+    if (dedicatedQueueRet && dedicatedIndexRet) {
+        m_TransferQueue = dedicatedQueueRet.value();
+        m_TransferQueueIndex = dedicatedIndexRet.value();
+    } else {
+        auto separateQueueRet = m_Device.get_queue(vkb::QueueType::transfer);
+        auto separateIndexRet = m_Device.get_queue_index(vkb::QueueType::transfer);
+        if (separateQueueRet && separateIndexRet) {
+            m_TransferQueue = separateQueueRet.value();
+            m_TransferQueueIndex = separateIndexRet.value();
+        }
+    }
+
+    // Same for compute: a family without graphics runs alongside it
+    m_ComputeQueue = m_GraphicsQueue;
+    m_ComputeQueueIndex = GetGraphicsQueueIndex();
+    if (config.asyncCompute) {
+        auto dedicatedComputeRet = m_Device.get_dedicated_queue(vkb::QueueType::compute);
+        auto dedicatedComputeIndexRet = m_Device.get_dedicated_queue_index(vkb::QueueType::compute);
+        if (dedicatedComputeRet && dedicatedComputeIndexRet) {
+            m_ComputeQueue = dedicatedComputeRet.value();
+            m_ComputeQueueIndex = dedicatedComputeIndexRet.value();
+        } else {
+            auto separateComputeRet = m_Device.get_queue(vkb::QueueType::compute);
+            auto separateComputeIndexRet = m_Device.get_queue_index(vkb::QueueType::compute);
+            if (separateComputeRet && separateComputeIndexRet) {
+                m_ComputeQueue = separateComputeRet.value();
+                m_ComputeQueueIndex = separateComputeIndexRet.value();
+            }
+        }
+    }
+
+    if (IsHeadless()) {
+        return;
+    }
+
     auto presentQueueRet = m_Device.get_queue(vkb::QueueType::present);
     if (!presentQueueRet) {
         throw std::runtime_error("Failed to get present queue: " + 
@@ -68,11 +190,37 @@ VulkanContext::VulkanContext(Window& window) {
 }
 
 VulkanContext::~VulkanContext() {
+    // Deferred destroys may still free memory, so they go before the allocator
+    m_DispatchTable.deviceWaitIdle();
+    m_DeletionQueue.reset();
+
+    m_PipelineCache->Save();
+    m_PipelineCache.reset();
+    m_Allocator.reset();
+
     vkb::destroy_device(m_Device);
-    vkb::destroy_surface(m_Instance, m_Surface);
+    if (m_Surface != VK_NULL_HANDLE) {
+        vkb::destroy_surface(m_Instance, m_Surface);
+    }
     vkb::destroy_instance(m_Instance);
 }
 
 uint32_t VulkanContext::GetGraphicsQueueIndex() const {
     return m_Device.get_queue_index(vkb::QueueType::graphics).value();
+}
+
+bool VulkanContext::IsExtensionEnabled(const char* name) const {
+    return std::find(m_EnabledExtensions.begin(), m_EnabledExtensions.end(), name) != m_EnabledExtensions.end();
+}
+
+uint32_t VulkanContext::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    const auto& memProperties = m_Device.physical_device.memory_properties;
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1u << i)) &&
+            (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type");
 }
\ No newline at end of file
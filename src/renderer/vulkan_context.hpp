@@ -1,11 +1,21 @@
 #pragma once
 #include <vulkan/vulkan_core.h>
 #include <VkBootstrap.h>
+#include <memory>
+#include <string>
+#include <vector>
 #include "../core/window.hpp"
+#include "renderer_config.hpp"
+
+class PipelineCache;
+class MemoryAllocator;
+class DeletionQueue;
 
 class VulkanContext {
 public:
-    VulkanContext(Window& window);
+    VulkanContext(Window& window, const RendererConfig& config = RendererConfig{});
+    // Headless context: no surface and no present queue
+    VulkanContext(const RendererConfig& config = RendererConfig{});
     ~VulkanContext();
 
     const vkb::Instance& GetInstance() const { return m_Instance; }
@@ -16,13 +26,56 @@ public:
     VkQueue GetGraphicsQueue() const { return m_GraphicsQueue; }
     VkQueue GetPresentQueue() const { return m_PresentQueue; }
     uint32_t GetGraphicsQueueIndex() const;
+    // A transfer-only family when the device has one, then any family
+    // without graphics, then the graphics queue itself
+    VkQueue GetTransferQueue() const { return m_TransferQueue; }
+    uint32_t GetTransferQueueIndex() const { return m_TransferQueueIndex; }
+    bool HasSeparateTransferQueue() const { return m_TransferQueueIndex != GetGraphicsQueueIndex(); }
+    // A compute-only family when the device has one (and the config allows
+    // it), otherwise the graphics queue
+    VkQueue GetComputeQueue() const { return m_ComputeQueue; }
+    uint32_t GetComputeQueueIndex() const { return m_ComputeQueueIndex; }
+    bool HasAsyncCompute() const { return m_ComputeQueueIndex != GetGraphicsQueueIndex(); }
+    bool IsHeadless() const { return m_Surface == VK_NULL_HANDLE; }
+
+    bool IsExtensionEnabled(const char* name) const;
+    const VkPhysicalDeviceFeatures& GetEnabledFeatures() const { return m_Device.physical_device.features; }
+    // VK_KHR_dynamic_rendering is enabled and was not turned off in the config
+    bool IsDynamicRenderingEnabled() const { return m_DynamicRendering; }
+    // VK_KHR_present_id and VK_KHR_present_wait are enabled (windowed only)
+    bool IsPresentWaitEnabled() const { return m_PresentWait; }
+    // Descriptor indexing features for bindless arrays are enabled and were
+    // not turned off in the config
+    bool IsDescriptorIndexingEnabled() const { return m_DescriptorIndexing; }
+
+    uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+    // Shared by all pipeline creation
+    PipelineCache& GetPipelineCache() const { return *m_PipelineCache; }
+    // Shared by all buffer and image creation
+    MemoryAllocator& GetAllocator() const { return *m_Allocator; }
+    // Destroys objects once the frames that may use them have completed
+    DeletionQueue& GetDeletionQueue() const { return *m_DeletionQueue; }
 
 private:
     vkb::Instance m_Instance;
     vkb::InstanceDispatchTable m_InstanceDispatch;
-    VkSurfaceKHR m_Surface;
+    VkSurfaceKHR m_Surface = VK_NULL_HANDLE;
     vkb::Device m_Device;
     vkb::DispatchTable m_DispatchTable;
-    VkQueue m_GraphicsQueue;
-    VkQueue m_PresentQueue;
+    VkQueue m_GraphicsQueue = VK_NULL_HANDLE;
+    VkQueue m_PresentQueue = VK_NULL_HANDLE;
+    VkQueue m_TransferQueue = VK_NULL_HANDLE;
+    uint32_t m_TransferQueueIndex = 0;
+    VkQueue m_ComputeQueue = VK_NULL_HANDLE;
+    uint32_t m_ComputeQueueIndex = 0;
+    std::vector<std::string> m_EnabledExtensions;
+    bool m_DynamicRendering = false;
+    bool m_PresentWait = false;
+    bool m_DescriptorIndexing = false;
+    std::unique_ptr<PipelineCache> m_PipelineCache;
+    std::unique_ptr<MemoryAllocator> m_Allocator;
+    std::unique_ptr<DeletionQueue> m_DeletionQueue;
+
+    void Initialize(Window* window, const RendererConfig& config);
 };
\ No newline at end of file
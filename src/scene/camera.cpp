@@ -49,6 +49,11 @@ float Camera::getFarClip() const
 	return zfar;
 }
 
+float Camera::getFov() const
+{
+	return fov;
+}
+
 void Camera::setPerspective(float fov, float aspect, float znear, float zfar)
 {
 	glm::mat4 currentMatrix = matrices.perspective;
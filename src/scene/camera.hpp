@@ -45,6 +45,9 @@ public:
 
 	float getFarClip() const;
 
+	// Vertical field of view in degrees
+	float getFov() const;
+
 	void setPerspective(float fov, float aspect, float znear, float zfar);
 
 	void updateAspectRatio(float aspect);
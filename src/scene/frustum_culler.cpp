@@ -0,0 +1,278 @@
+#include "../stdafx.h"
+#include "frustum_culler.hpp"
+#include "../core/job_system.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JB_CULL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang need the AVX2 functions marked; MSVC emits any intrinsic
+#if defined(JB_CULL_X86) && (defined(__GNUC__) || defined(__clang__))
+#define JB_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define JB_TARGET_AVX2
+#endif
+
+namespace {
+    // Padding and unset objects have a NaN center, which fails every
+    // ordered comparison and so is never visible
+    constexpr float EMPTY = std::numeric_limits<float>::quiet_NaN();
+
+    uint32_t PadToGroup(uint32_t count) {
+        return (count + 7) & ~7u;
+    }
+
+    uint32_t EmitIndices(uint32_t mask, uint32_t base, uint32_t* out) {
+        uint32_t written = 0;
+        while (mask) {
+            out[written++] = base + static_cast<uint32_t>(std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+        return written;
+    }
+
+    // Plane normals with their absolute values, for projecting the box
+    struct PlaneData {
+        float nx[Frustum::PLANE_COUNT], ny[Frustum::PLANE_COUNT], nz[Frustum::PLANE_COUNT], d[Frustum::PLANE_COUNT];
+        float ax[Frustum::PLANE_COUNT], ay[Frustum::PLANE_COUNT], az[Frustum::PLANE_COUNT];
+    };
+
+    PlaneData MakePlaneData(const Frustum& frustum) {
+        PlaneData data;
+        for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+            const glm::vec4& plane = frustum.planes[p];
+            data.nx[p] = plane.x;
+            data.ny[p] = plane.y;
+            data.nz[p] = plane.z;
+            data.d[p] = plane.w;
+            data.ax[p] = std::abs(plane.x);
+            data.ay[p] = std::abs(plane.y);
+            data.az[p] = std::abs(plane.z);
+        }
+        return data;
+    }
+
+    struct BoundsView {
+        const float* cx;
+        const float* cy;
+        const float* cz;
+        const float* ex;
+        const float* ey;
+        const float* ez;
+        const float* r;
+    };
+
+    // Same shape as the SIMD paths, branch-free per lane so compilers can
+    // auto-vectorize it on targets without a hand-written path
+    uint32_t CullScalar(const PlaneData& planes, const BoundsView& b, uint32_t begin, uint32_t end, uint32_t* out) {
+        uint32_t written = 0;
+        for (uint32_t i = begin; i < end; i += 8) {
+            uint32_t mask = 0;
+            for (uint32_t lane = 0; lane < 8; lane++) {
+                uint32_t j = i + lane;
+                bool visible = true;
+                for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+                    float distance = b.cx[j] * planes.nx[p] + b.cy[j] * planes.ny[p] + b.cz[j] * planes.nz[p] + planes.d[p];
+                    float reach = std::min(b.r[j], b.ex[j] * planes.ax[p] + b.ey[j] * planes.ay[p] + b.ez[j] * planes.az[p]);
+                    visible &= distance + reach >= 0.0f;
+                }
+                mask |= static_cast<uint32_t>(visible) << lane;
+            }
+            written += EmitIndices(mask, i, out + written);
+        }
+        return written;
+    }
+
+#if defined(JB_CULL_X86)
+    // SSE2 is part of x86-64, so this path needs no runtime check
+    uint32_t CullSSE(const PlaneData& planes, const BoundsView& b, uint32_t begin, uint32_t end, uint32_t* out) {
+        uint32_t written = 0;
+        const __m128 zero = _mm_setzero_ps();
+
+        for (uint32_t i = begin; i < end; i += 8) {
+            uint32_t mask = 0;
+            for (uint32_t half = 0; half < 8; half += 4) {
+                uint32_t j = i + half;
+                __m128 cx = _mm_loadu_ps(b.cx + j);
+                __m128 cy = _mm_loadu_ps(b.cy + j);
+                __m128 cz = _mm_loadu_ps(b.cz + j);
+                __m128 ex = _mm_loadu_ps(b.ex + j);
+                __m128 ey = _mm_loadu_ps(b.ey + j);
+                __m128 ez = _mm_loadu_ps(b.ez + j);
+                __m128 r = _mm_loadu_ps(b.r + j);
+
+                __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+                    __m128 distance = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(planes.nx[p])), _mm_mul_ps(cy, _mm_set1_ps(planes.ny[p]))),
+                        _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(planes.nz[p])), _mm_set1_ps(planes.d[p])));
+                    __m128 reach = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(planes.ax[p])), _mm_mul_ps(ey, _mm_set1_ps(planes.ay[p]))),
+                        _mm_mul_ps(ez, _mm_set1_ps(planes.az[p])));
+                    reach = _mm_min_ps(r, reach);
+                    visible = _mm_and_ps(visible, _mm_cmpge_ps(_mm_add_ps(distance, reach), zero));
+                }
+                mask |= static_cast<uint32_t>(_mm_movemask_ps(visible)) << half;
+            }
+            written += EmitIndices(mask, i, out + written);
+        }
+        return written;
+    }
+
+    JB_TARGET_AVX2
+    uint32_t CullAVX2(const PlaneData& planes, const BoundsView& b, uint32_t begin, uint32_t end, uint32_t* out) {
+        uint32_t written = 0;
+        const __m256 zero = _mm256_setzero_ps();
+
+        for (uint32_t i = begin; i < end; i += 8) {
+            __m256 cx = _mm256_loadu_ps(b.cx + i);
+            __m256 cy = _mm256_loadu_ps(b.cy + i);
+            __m256 cz = _mm256_loadu_ps(b.cz + i);
+            __m256 ex = _mm256_loadu_ps(b.ex + i);
+            __m256 ey = _mm256_loadu_ps(b.ey + i);
+            __m256 ez = _mm256_loadu_ps(b.ez + i);
+            __m256 r = _mm256_loadu_ps(b.r + i);
+
+            __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+                __m256 distance = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(planes.nx[p])), _mm256_mul_ps(cy, _mm256_set1_ps(planes.ny[p]))),
+                    _mm256_add_ps(_mm256_mul_ps(cz, _mm256_set1_ps(planes.nz[p])), _mm256_set1_ps(planes.d[p])));
+                __m256 reach = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(ex, _mm256_set1_ps(planes.ax[p])), _mm256_mul_ps(ey, _mm256_set1_ps(planes.ay[p]))),
+                    _mm256_mul_ps(ez, _mm256_set1_ps(planes.az[p])));
+                reach = _mm256_min_ps(r, reach);
+                // Ordered compare: NaN (empty) lanes come out false
+                visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_add_ps(distance, reach), zero, _CMP_GE_OQ));
+            }
+            written += EmitIndices(static_cast<uint32_t>(_mm256_movemask_ps(visible)), i, out + written);
+        }
+        return written;
+    }
+
+    bool HasAVX2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int regs[4];
+        __cpuid(regs, 1);
+        bool osxsave = (regs[2] & (1 << 27)) != 0;
+        bool avx = (regs[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+            return false;
+        }
+        __cpuidex(regs, 7, 0);
+        return (regs[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+}
+
+Frustum Frustum::FromMatrix(const glm::mat4& m) {
+    // Gribb/Hartmann: each plane is a sum or difference of the matrix rows.
+    // Clip depth is [0, 1], so the near plane is row 2 on its own.
+    auto row = [&](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+
+    Frustum frustum;
+    frustum.planes[Left] = row(3) + row(0);
+    frustum.planes[Right] = row(3) - row(0);
+    frustum.planes[Bottom] = row(3) + row(1);
+    frustum.planes[Top] = row(3) - row(1);
+    frustum.planes[Near] = row(2);
+    frustum.planes[Far] = row(3) - row(2);
+
+    for (auto& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+FrustumCuller::FrustumCuller()
+    : m_Path(Path::Scalar)
+{
+#if defined(JB_CULL_X86)
+    m_Path = HasAVX2() ? Path::AVX2 : Path::SSE;
+#endif
+}
+
+const char* FrustumCuller::GetPathName(Path path) {
+    switch (path) {
+        case Path::AVX2: return "avx2";
+        case Path::SSE: return "sse";
+        default: return "scalar";
+    }
+}
+
+void FrustumCuller::Resize(uint32_t count) {
+    uint32_t padded = PadToGroup(count);
+    m_CenterX.resize(padded, EMPTY);
+    m_CenterY.resize(padded, EMPTY);
+    m_CenterZ.resize(padded, EMPTY);
+    m_ExtentX.resize(padded, 0.0f);
+    m_ExtentY.resize(padded, 0.0f);
+    m_ExtentZ.resize(padded, 0.0f);
+    m_Radius.resize(padded, 0.0f);
+
+    // When shrinking, the tail of the last group may hold stale objects
+    std::fill(m_CenterX.begin() + count, m_CenterX.end(), EMPTY);
+
+    m_Visible.resize(padded);
+    m_BatchVisible.resize((count + BATCH_SIZE - 1) / BATCH_SIZE);
+    m_Count = count;
+}
+
+void FrustumCuller::SetBounds(uint32_t index, const glm::vec3& center, const glm::vec3& extents, float radius) {
+    m_CenterX[index] = center.x;
+    m_CenterY[index] = center.y;
+    m_CenterZ[index] = center.z;
+    m_ExtentX[index] = extents.x;
+    m_ExtentY[index] = extents.y;
+    m_ExtentZ[index] = extents.z;
+    m_Radius[index] = radius;
+}
+
+uint32_t FrustumCuller::CullRange(const Frustum& frustum, uint32_t begin, uint32_t end, uint32_t* out) const {
+    PlaneData planes = MakePlaneData(frustum);
+    BoundsView bounds{m_CenterX.data(), m_CenterY.data(), m_CenterZ.data(),
+                      m_ExtentX.data(), m_ExtentY.data(), m_ExtentZ.data(), m_Radius.data()};
+
+    switch (m_Path) {
+#if defined(JB_CULL_X86)
+        case Path::AVX2: return CullAVX2(planes, bounds, begin, end, out);
+        case Path::SSE: return CullSSE(planes, bounds, begin, end, out);
+#endif
+        default: return CullScalar(planes, bounds, begin, end, out);
+    }
+}
+
+std::span<const uint32_t> FrustumCuller::Cull(const Frustum& frustum, JobSystem& jobs) {
+    uint32_t padded = PadToGroup(m_Count);
+    uint32_t batchCount = static_cast<uint32_t>(m_BatchVisible.size());
+
+    // Each batch writes its visible indices at its own offset, then the
+    // batches are packed together in order
+    jobs.ParallelFor(batchCount, 1, [&](uint32_t first, uint32_t last) {
+        for (uint32_t batch = first; batch < last; batch++) {
+            uint32_t begin = batch * BATCH_SIZE;
+            uint32_t end = std::min(begin + BATCH_SIZE, padded);
+            m_BatchVisible[batch] = CullRange(frustum, begin, end, m_Visible.data() + begin);
+        }
+    });
+
+    uint32_t visibleCount = batchCount > 0 ? m_BatchVisible[0] : 0;
+    for (uint32_t batch = 1; batch < batchCount; batch++) {
+        const uint32_t* src = m_Visible.data() + batch * BATCH_SIZE;
+        std::copy(src, src + m_BatchVisible[batch], m_Visible.data() + visibleCount);
+        visibleCount += m_BatchVisible[batch];
+    }
+    return {m_Visible.data(), visibleCount};
+}
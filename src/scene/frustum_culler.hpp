@@ -0,0 +1,59 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class JobSystem;
+
+// Six inward-facing planes (xyz = unit normal, w = distance) extracted from
+// a view-projection matrix with Vulkan's [0, 1] clip depth
+struct Frustum {
+    enum { Left, Right, Bottom, Top, Near, Far, PLANE_COUNT };
+
+    glm::vec4 planes[PLANE_COUNT];
+
+    static Frustum FromMatrix(const glm::mat4& viewProjection);
+};
+
+// Object bounds stored as structure-of-arrays so the test runs 8 objects per
+// iteration (AVX2, or two SSE halves). Each object has a box (center plus
+// half extents) and an enclosing sphere radius; the test uses whichever of
+// the two is tighter along each plane normal, so pure spheres pass
+// extents = radius and pure boxes radius = length(extents).
+class FrustumCuller {
+public:
+    enum class Path { Scalar, SSE, AVX2 };
+
+    // Objects per culling job
+    static constexpr uint32_t BATCH_SIZE = 4096;
+
+    FrustumCuller();
+
+    // Keeps existing bounds; new objects start out empty (never visible)
+    void Resize(uint32_t count);
+    // Safe to call concurrently for different indices
+    void SetBounds(uint32_t index, const glm::vec3& center, const glm::vec3& extents, float radius);
+
+    // Returns the indices of visible objects in ascending order. The span
+    // stays valid until the next Cull or Resize.
+    std::span<const uint32_t> Cull(const Frustum& frustum, JobSystem& jobs);
+
+    uint32_t GetCount() const { return m_Count; }
+    Path GetPath() const { return m_Path; }
+    static const char* GetPathName(Path path);
+
+private:
+    Path m_Path;
+    uint32_t m_Count = 0;
+
+    // Padded to a multiple of 8 so the SIMD loops never need a tail
+    std::vector<float> m_CenterX, m_CenterY, m_CenterZ;
+    std::vector<float> m_ExtentX, m_ExtentY, m_ExtentZ;
+    std::vector<float> m_Radius;
+
+    std::vector<uint32_t> m_Visible;
+    std::vector<uint32_t> m_BatchVisible;
+
+    uint32_t CullRange(const Frustum& frustum, uint32_t begin, uint32_t end, uint32_t* out) const;
+};
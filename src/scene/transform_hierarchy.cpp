@@ -0,0 +1,264 @@
+#include "../stdafx.h"
+#include "transform_hierarchy.hpp"
+
+#include <algorithm>
+
+namespace {
+    constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+    template <typename T>
+    void Permute(std::vector<T>& values, const std::vector<uint32_t>& order) {
+        std::vector<T> sorted(values.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            sorted[i] = values[order[i]];
+        }
+        values.swap(sorted);
+    }
+}
+
+void TransformHierarchy::Reserve(uint32_t count) {
+    m_Positions.reserve(count);
+    m_Rotations.reserve(count);
+    m_Scales.reserve(count);
+    m_World.reserve(count);
+    m_Parents.reserve(count);
+    m_SubtreeSizes.reserve(count);
+    m_Dirty.reserve(count);
+    m_DirtyList.reserve(count);
+    m_NodeToIndex.reserve(count);
+    m_IndexToNode.reserve(count);
+}
+
+void TransformHierarchy::Clear() {
+    m_Positions.clear();
+    m_Rotations.clear();
+    m_Scales.clear();
+    m_World.clear();
+    m_Parents.clear();
+    m_SubtreeSizes.clear();
+    m_Dirty.clear();
+    m_DirtyList.clear();
+    m_NodeToIndex.clear();
+    m_IndexToNode.clear();
+    m_NeedsReorder = false;
+    m_Stats = Stats{};
+}
+
+TransformHierarchy::NodeId TransformHierarchy::CreateNode(NodeId parent) {
+    uint32_t index = GetNodeCount();
+    uint32_t parentIndex = parent == INVALID_NODE ? NO_PARENT : m_NodeToIndex.at(parent);
+
+    m_Positions.emplace_back(0.0f);
+    m_Rotations.emplace_back(1.0f, 0.0f, 0.0f, 0.0f);
+    m_Scales.emplace_back(1.0f);
+    m_World.emplace_back(1.0f);
+    m_Parents.push_back(parentIndex);
+    m_SubtreeSizes.push_back(1);
+    m_Dirty.push_back(0);
+
+    NodeId node = static_cast<NodeId>(m_NodeToIndex.size());
+    m_NodeToIndex.push_back(index);
+    m_IndexToNode.push_back(node);
+
+    // Appending to a subtree that already ends at the back of the arrays
+    // keeps depth-first order; only the ancestors' sizes change
+    if (parentIndex != NO_PARENT && !m_NeedsReorder) {
+        if (parentIndex + m_SubtreeSizes[parentIndex] == index) {
+            for (uint32_t ancestor = parentIndex; ancestor != NO_PARENT; ancestor = m_Parents[ancestor]) {
+                m_SubtreeSizes[ancestor]++;
+            }
+        } else {
+            m_NeedsReorder = true;
+        }
+    }
+
+    MarkDirty(index);
+    return node;
+}
+
+void TransformHierarchy::SetParent(NodeId node, NodeId parent) {
+    uint32_t index = m_NodeToIndex.at(node);
+    uint32_t parentIndex = parent == INVALID_NODE ? NO_PARENT : m_NodeToIndex.at(parent);
+
+    for (uint32_t ancestor = parentIndex; ancestor != NO_PARENT; ancestor = m_Parents[ancestor]) {
+        if (ancestor == index) {
+            throw std::runtime_error("Failed to reparent transform: parent is a descendant of the node");
+        }
+    }
+
+    if (m_Parents[index] != parentIndex) {
+        m_Parents[index] = parentIndex;
+        m_NeedsReorder = true;
+        MarkDirty(index);
+    }
+}
+
+TransformHierarchy::NodeId TransformHierarchy::GetParent(NodeId node) const {
+    uint32_t parentIndex = m_Parents[m_NodeToIndex[node]];
+    return parentIndex == NO_PARENT ? INVALID_NODE : m_IndexToNode[parentIndex];
+}
+
+void TransformHierarchy::SetLocal(NodeId node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+    uint32_t index = m_NodeToIndex[node];
+    m_Positions[index] = position;
+    m_Rotations[index] = rotation;
+    m_Scales[index] = scale;
+    MarkDirty(index);
+}
+
+void TransformHierarchy::SetPosition(NodeId node, const glm::vec3& position) {
+    uint32_t index = m_NodeToIndex[node];
+    m_Positions[index] = position;
+    MarkDirty(index);
+}
+
+void TransformHierarchy::SetRotation(NodeId node, const glm::quat& rotation) {
+    uint32_t index = m_NodeToIndex[node];
+    m_Rotations[index] = rotation;
+    MarkDirty(index);
+}
+
+void TransformHierarchy::SetScale(NodeId node, const glm::vec3& scale) {
+    uint32_t index = m_NodeToIndex[node];
+    m_Scales[index] = scale;
+    MarkDirty(index);
+}
+
+void TransformHierarchy::MarkDirty(uint32_t index) {
+    if (!m_Dirty[index]) {
+        m_Dirty[index] = 1;
+        m_DirtyList.push_back(index);
+    }
+}
+
+void TransformHierarchy::Update() {
+    m_Stats.nodeCount = GetNodeCount();
+    m_Stats.updatedCount = 0;
+    m_Stats.reordered = false;
+
+    for (uint32_t index : m_DirtyList) {
+        m_Dirty[index] = 0;
+    }
+
+    if (m_NeedsReorder) {
+        Reorder();
+        UpdateRange(0, GetNodeCount());
+        m_Stats.updatedCount = GetNodeCount();
+        m_Stats.reordered = true;
+        m_DirtyList.clear();
+        return;
+    }
+
+    // Parents sort before their descendants, so a dirty node inside a range
+    // that was just recomputed is already up to date
+    std::sort(m_DirtyList.begin(), m_DirtyList.end());
+
+    uint32_t updatedEnd = 0;
+    for (uint32_t index : m_DirtyList) {
+        if (index < updatedEnd) {
+            continue;
+        }
+        updatedEnd = index + m_SubtreeSizes[index];
+        UpdateRange(index, updatedEnd);
+        m_Stats.updatedCount += updatedEnd - index;
+    }
+    m_DirtyList.clear();
+}
+
+void TransformHierarchy::UpdateRange(uint32_t begin, uint32_t end) {
+    // Every parent is either earlier in this range or outside the subtree
+    // being updated, so its world matrix is final by the time it is read
+    for (uint32_t i = begin; i < end; i++) {
+        glm::mat3 rotation = glm::mat3_cast(m_Rotations[i]);
+        const glm::vec3& scale = m_Scales[i];
+        glm::vec3 axisX = rotation[0] * scale.x;
+        glm::vec3 axisY = rotation[1] * scale.y;
+        glm::vec3 axisZ = rotation[2] * scale.z;
+        const glm::vec3& position = m_Positions[i];
+
+        uint32_t parent = m_Parents[i];
+        glm::mat4& world = m_World[i];
+        if (parent == NO_PARENT) {
+            world[0] = glm::vec4(axisX, 0.0f);
+            world[1] = glm::vec4(axisY, 0.0f);
+            world[2] = glm::vec4(axisZ, 0.0f);
+            world[3] = glm::vec4(position, 1.0f);
+            continue;
+        }
+
+        // parent * local, skipping the terms of local's constant bottom row
+        const glm::mat4& p = m_World[parent];
+        world[0] = p[0] * axisX.x + p[1] * axisX.y + p[2] * axisX.z;
+        world[1] = p[0] * axisY.x + p[1] * axisY.y + p[2] * axisY.z;
+        world[2] = p[0] * axisZ.x + p[1] * axisZ.y + p[2] * axisZ.z;
+        world[3] = p[0] * position.x + p[1] * position.y + p[2] * position.z + p[3];
+    }
+}
+
+void TransformHierarchy::Reorder() {
+    uint32_t count = GetNodeCount();
+
+    // Child lists, built back to front so siblings keep their current order
+    std::vector<uint32_t> firstChild(count, NO_PARENT);
+    std::vector<uint32_t> nextSibling(count, NO_PARENT);
+    for (uint32_t i = count; i-- > 0;) {
+        uint32_t parent = m_Parents[i];
+        if (parent != NO_PARENT) {
+            nextSibling[i] = firstChild[parent];
+            firstChild[parent] = i;
+        }
+    }
+
+    // Pre-order walk of each root, using the parent links instead of a stack
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    for (uint32_t root = 0; root < count; root++) {
+        if (m_Parents[root] != NO_PARENT) {
+            continue;
+        }
+        uint32_t i = root;
+        for (;;) {
+            order.push_back(i);
+            if (firstChild[i] != NO_PARENT) {
+                i = firstChild[i];
+                continue;
+            }
+            while (i != root && nextSibling[i] == NO_PARENT) {
+                i = m_Parents[i];
+            }
+            if (i == root) {
+                break;
+            }
+            i = nextSibling[i];
+        }
+    }
+
+    std::vector<uint32_t> newIndex(count);
+    for (uint32_t i = 0; i < count; i++) {
+        newIndex[order[i]] = i;
+    }
+
+    Permute(m_Positions, order);
+    Permute(m_Rotations, order);
+    Permute(m_Scales, order);
+    Permute(m_IndexToNode, order);
+    Permute(m_Parents, order);
+    for (auto& parent : m_Parents) {
+        if (parent != NO_PARENT) {
+            parent = newIndex[parent];
+        }
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        m_NodeToIndex[m_IndexToNode[i]] = i;
+    }
+
+    // Children follow their parents, so sizes accumulate back to front
+    std::fill(m_SubtreeSizes.begin(), m_SubtreeSizes.end(), 1u);
+    for (uint32_t i = count; i-- > 0;) {
+        if (m_Parents[i] != NO_PARENT) {
+            m_SubtreeSizes[m_Parents[i]] += m_SubtreeSizes[i];
+        }
+    }
+
+    m_NeedsReorder = false;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstdint>
+#include <vector>
+
+// Parent/child transforms kept as structure-of-arrays in depth-first order,
+// so every node comes after its parent and each subtree is one contiguous
+// range. Setting a local transform marks the node dirty; Update sorts the
+// dirty nodes and recomputes world matrices for their subtrees in a single
+// forward pass, so the cost follows what moved rather than the scene size.
+// Nothing is allocated per frame once the arrays have grown.
+//
+// Node ids are stable handles. Adding a node anywhere but at the end of its
+// parent's subtree, or reparenting, reorders the arrays on the next Update.
+class TransformHierarchy {
+public:
+    using NodeId = uint32_t;
+    static constexpr NodeId INVALID_NODE = UINT32_MAX;
+
+    struct Stats {
+        uint32_t nodeCount = 0;
+        uint32_t updatedCount = 0;      // World matrices recomputed by the last Update
+        bool reordered = false;         // Whether the last Update rebuilt the order
+    };
+
+    void Reserve(uint32_t count);
+    void Clear();
+
+    NodeId CreateNode(NodeId parent = INVALID_NODE);
+    // Throws when parent is node itself or one of its descendants
+    void SetParent(NodeId node, NodeId parent);
+    NodeId GetParent(NodeId node) const;
+
+    void SetLocal(NodeId node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+    void SetPosition(NodeId node, const glm::vec3& position);
+    void SetRotation(NodeId node, const glm::quat& rotation);
+    void SetScale(NodeId node, const glm::vec3& scale);
+
+    const glm::vec3& GetPosition(NodeId node) const { return m_Positions[m_NodeToIndex[node]]; }
+    const glm::quat& GetRotation(NodeId node) const { return m_Rotations[m_NodeToIndex[node]]; }
+    const glm::vec3& GetScale(NodeId node) const { return m_Scales[m_NodeToIndex[node]]; }
+
+    void Update();
+
+    // Valid after Update
+    const glm::mat4& GetWorldMatrix(NodeId node) const { return m_World[m_NodeToIndex[node]]; }
+    // Dense, in depth-first order; GetIndex maps a node to its slot
+    const std::vector<glm::mat4>& GetWorldMatrices() const { return m_World; }
+    uint32_t GetIndex(NodeId node) const { return m_NodeToIndex[node]; }
+
+    uint32_t GetNodeCount() const { return static_cast<uint32_t>(m_Parents.size()); }
+    const Stats& GetStats() const { return m_Stats; }
+
+private:
+    // Dense arrays, indexed by position in depth-first order
+    std::vector<glm::vec3> m_Positions;
+    std::vector<glm::quat> m_Rotations;
+    std::vector<glm::vec3> m_Scales;
+    std::vector<glm::mat4> m_World;
+    std::vector<uint32_t> m_Parents;          // Dense index, UINT32_MAX for roots
+    std::vector<uint32_t> m_SubtreeSizes;     // Including the node itself
+    std::vector<uint8_t> m_Dirty;
+    std::vector<uint32_t> m_DirtyList;
+
+    std::vector<uint32_t> m_NodeToIndex;
+    std::vector<NodeId> m_IndexToNode;
+
+    bool m_NeedsReorder = false;
+    Stats m_Stats;
+
+    void MarkDirty(uint32_t index);
+    void Reorder();
+    void UpdateRange(uint32_t begin, uint32_t end);
+};
@@ -0,0 +1,23 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+// BindlessTable's set; the storage buffer array (binding 1) is unused here
+layout (set = 1, binding = 0) uniform texture2D textures[];
+layout (set = 1, binding = 2) uniform sampler textureSampler;
+
+layout (location = 0) in vec3 fragColor;
+layout (location = 1) in vec2 fragUV;
+layout (location = 2) flat in uint fragTexture;
+
+layout (location = 0) out vec4 outColor;
+
+void main ()
+{
+	vec3 color = fragColor;
+	// The handle varies across the instances of one draw
+	if (fragTexture != 0xFFFFFFFFu) {
+		color *= texture (sampler2D (textures[nonuniformEXT (fragTexture)], textureSampler), fragUV).rgb;
+	}
+	outColor = vec4 (color, 1.0);
+}
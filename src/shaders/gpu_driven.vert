@@ -0,0 +1,33 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout (set = 0, binding = 0) uniform CameraUniforms
+{
+	mat4 projection;
+	mat4 view;
+} camera;
+
+struct Object
+{
+	mat4 model;
+	vec4 sphere;
+	uint batch;
+	uint pad0;
+	uint pad1;
+	uint pad2;
+};
+
+layout (std430, set = 1, binding = 0) readonly buffer Objects { Object objects[]; };
+
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec3 inColor;
+
+layout (location = 0) out vec3 fragColor;
+
+void main ()
+{
+	// gpu_cull.comp stores the object index in the draw's firstInstance
+	mat4 model = objects[gl_InstanceIndex].model;
+	gl_Position = camera.projection * camera.view * model * vec4 (inPosition, 1.0);
+	fragColor = inColor;
+}
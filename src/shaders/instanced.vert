@@ -0,0 +1,30 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout (set = 0, binding = 0) uniform CameraUniforms
+{
+	mat4 projection;
+	mat4 view;
+} camera;
+
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec3 inColor;
+
+// Per instance (binding 1), see InstanceData
+layout (location = 2) in mat4 instanceModel;
+layout (location = 6) in vec4 instanceColor;
+layout (location = 7) in vec4 instanceCustom;
+layout (location = 8) in uint instanceTexture;
+
+layout (location = 0) out vec3 fragColor;
+// Read by bindless.frag only
+layout (location = 1) out vec2 fragUV;
+layout (location = 2) flat out uint fragTexture;
+
+void main ()
+{
+	gl_Position = camera.projection * camera.view * instanceModel * vec4 (inPosition, 1.0);
+	fragColor = inColor * instanceColor.rgb;
+	fragUV = inPosition.xy + 0.5;
+	fragTexture = instanceTexture;
+}
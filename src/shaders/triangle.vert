@@ -1,14 +1,24 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout (location = 0) out vec3 fragColor;
+layout (set = 0, binding = 0) uniform CameraUniforms
+{
+	mat4 projection;
+	mat4 view;
+} camera;
 
-vec2 positions[3] = vec2[](vec2 (0.0, -0.5), vec2 (0.5, 0.5), vec2 (-0.5, 0.5));
+layout (set = 0, binding = 1) uniform ObjectUniforms
+{
+	mat4 model;
+} object;
 
-vec3 colors[3] = vec3[](vec3 (1.0, 0.0, 0.0), vec3 (0.0, 1.0, 0.0), vec3 (0.0, 0.0, 1.0));
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec3 inColor;
+
+layout (location = 0) out vec3 fragColor;
 
 void main ()
 {
-	gl_Position = vec4 (positions[gl_VertexIndex], 0.0, 1.0);
-	fragColor = colors[gl_VertexIndex];
+	gl_Position = camera.projection * camera.view * object.model * vec4 (inPosition, 1.0);
+	fragColor = inColor;
 }
\ No newline at end of file